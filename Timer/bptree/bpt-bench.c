@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "bptree.h"
+#include "rbtree.h"
+#include "minheap.h"
+
+/*
+ * B+ 树 vs nginx 红黑树 vs min_heap_t，n 个定时器（默认 100 万，参数可改成 1000 万）：
+ *   - random：超时在 1~60000ms 内随机；
+ *   - fixed ：同一个超时、到期时间递增（连接空闲超时的常见形态），插入总在最右边；
+ * 每种负载依次：全部添加、随机取消一半、剩下的按到期顺序全部弹出，输出每个操作的平均耗时。
+ * 节点都预先分配好，只比较结构本身；B+ 树同时检查弹出顺序和个数。
+ */
+
+typedef struct { ngx_rbtree_node_t node; } rb_item_t;
+
+static double
+now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t *expires;
+static uint32_t *order;   // 取消顺序
+static size_t n, half;
+
+static void
+report(const char *name, double add, double del, double pop, double bytes) {
+    printf("  %-8s %10.1f %12.1f %10.1f %14.1f\n", name, add / n, del / half, pop / (n - half), bytes);
+}
+
+static int
+bench_bpt() {
+    bptree_t t;
+    size_t i;
+    int ok = 1;
+    bpt_init(&t);
+    double t0 = now_ns();
+    for (i = 0; i < n; i++) {
+        bpt_insert(&t, ((uint64_t)expires[i] << 32) | i, &expires[i]);
+    }
+    double add = now_ns() - t0;
+    double bytes = (double)t.nodes * BPT_NODE_SIZE / n;
+    t0 = now_ns();
+    for (i = 0; i < half; i++) {
+        uint32_t k = order[i];
+        ok = ok && bpt_delete(&t, ((uint64_t)expires[k] << 32) | k) == &expires[k];
+    }
+    double del = now_ns() - t0;
+    uint64_t key, last = 0;
+    size_t popped = 0;
+    t0 = now_ns();
+    while (bpt_pop_min(&t, &key)) {
+        ok = ok && key >= last;
+        last = key;
+        popped++;
+    }
+    double pop = now_ns() - t0;
+    ok = ok && popped == n - half && t.count == 0 && t.nodes == 0;
+    report("bptree", add, del, pop, bytes);
+    return ok;
+}
+
+static void
+bench_rbtree() {
+    ngx_rbtree_t rb;
+    ngx_rbtree_node_t sentinel;
+    rb_item_t *items = calloc(n, sizeof(*items));
+    size_t i;
+    ngx_rbtree_init(&rb, &sentinel, ngx_rbtree_insert_timer_value);
+    double t0 = now_ns();
+    for (i = 0; i < n; i++) {
+        items[i].node.key = expires[i];
+        ngx_rbtree_insert(&rb, &items[i].node);
+    }
+    double add = now_ns() - t0;
+    t0 = now_ns();
+    for (i = 0; i < half; i++) {
+        ngx_rbtree_delete(&rb, &items[order[i]].node);
+    }
+    double del = now_ns() - t0;
+    t0 = now_ns();
+    while (rb.root != rb.sentinel) {
+        ngx_rbtree_delete(&rb, ngx_rbtree_min(rb.root, rb.sentinel));
+    }
+    double pop = now_ns() - t0;
+    report("rbtree", add, del, pop, sizeof(rb_item_t));
+    free(items);
+}
+
+static void
+bench_minheap() {
+    min_heap_t mh;
+    timer_entry_t *items = calloc(n, sizeof(*items));
+    size_t i;
+    min_heap_ctor_(&mh);
+    double t0 = now_ns();
+    for (i = 0; i < n; i++) {
+        items[i].time = expires[i];
+        min_heap_push_(&mh, &items[i]);
+    }
+    double add = now_ns() - t0;
+    double bytes = sizeof(timer_entry_t) + (double)mh.a * sizeof(timer_entry_t *) / n;
+    t0 = now_ns();
+    for (i = 0; i < half; i++) {
+        min_heap_erase_(&mh, &items[order[i]]);
+    }
+    double del = now_ns() - t0;
+    t0 = now_ns();
+    while (min_heap_pop_(&mh)) {
+    }
+    double pop = now_ns() - t0;
+    report("minheap", add, del, pop, bytes);
+    min_heap_dtor_(&mh);
+    free(items);
+}
+
+int main(int argc, char *argv[]) {
+    size_t i;
+    int ok = 1, w;
+    n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    half = n / 2;
+    expires = malloc(n * sizeof(*expires));
+    order = malloc(n * sizeof(*order));
+    srand(12345);
+    for (i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    for (i = n - 1; i > 0; i--) {
+        size_t j = ((size_t)rand() << 16 ^ rand()) % (i + 1);
+        uint32_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    printf("timers = %zu, cancel %zu in random order, pop the rest\n", n, half);
+    for (w = 0; w < 2; w++) {
+        for (i = 0; i < n; i++) {
+            // fixed：每毫秒约 1000 个新定时器，超时都是 30s
+            expires[i] = w == 0 ? 1000 + 1 + rand() % 60000 : 1000 + 30000 + (uint32_t)(i / 1000);
+        }
+        printf("%s\n  %-8s %10s %12s %10s %14s\n", w == 0 ? "random" : "fixed",
+            "impl", "add ns", "cancel ns", "pop ns", "bytes/timer");
+        ok = bench_bpt() && ok;
+        bench_rbtree();
+        bench_minheap();
+    }
+    printf("bptree order and counts: %s\n", ok ? "ok" : "BAD");
+    free(expires);
+    free(order);
+    return ok ? 0 : 1;
+}
+
+// gcc -O2 bpt-bench.c bptree.c ../rbtree/rbtree.c ../minheap/minheap.c -o bpt-bench -I./ -I../rbtree -I../minheap
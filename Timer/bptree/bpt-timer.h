@@ -0,0 +1,142 @@
+#ifndef MARK_BPTREE_TIMER_H
+#define MARK_BPTREE_TIMER_H
+
+#if defined(__APPLE__)
+#include <AvailabilityMacros.h>
+#include <sys/time.h>
+#include <mach/task.h>
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bptree.h"
+#include "timer_handle.h"
+#include "timer_probe.h"
+#include "timer_expired.h"
+
+typedef struct timer_entry_s timer_entry_t;
+typedef void (*timer_handler_pt)(timer_entry_t *ev);
+
+struct timer_entry_s {
+    uint32_t time;
+    timer_handler_pt handler;
+    void *privdata;
+    timer_handle_t handle;  // 定时器句柄，见 timer_handle.h
+};
+
+// 句柄槽位下标在存活的定时器中唯一，拼在到期时间后面作为 B+ 树的 key
+#define bpt_timer_key(te) (((uint64_t)(te)->time << 32) | handle_index((te)->handle))
+
+static bptree_t bpt;
+static handle_table_t handles;
+
+static uint32_t
+current_time() {
+	uint32_t t;
+#if !defined(__APPLE__) || defined(AVAILABLE_MAC_OS_X_VERSION_10_12_AND_LATER)
+	struct timespec ti;
+	clock_gettime(CLOCK_MONOTONIC, &ti);
+	t = (uint32_t)ti.tv_sec * 1000;
+	t += ti.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	t = (uint32_t)tv.tv_sec * 1000;
+	t += tv.tv_usec / 1000;
+#endif
+	return t;
+}
+
+void init_timer() {
+    bpt_init(&bpt);
+    handle_table_init(&handles);
+}
+
+timer_handle_t add_timer(uint32_t msec, timer_handler_pt callback) {
+    timer_entry_t *te = (timer_entry_t *)malloc(sizeof(*te));
+    if (!te) {
+        return TIMER_HANDLE_INVALID;
+    }
+    memset(te, 0, sizeof(timer_entry_t));
+
+    te->handler = callback;
+    te->time = current_time() + msec;
+    te->handle = handle_alloc(&handles, te);
+    if (te->handle == TIMER_HANDLE_INVALID) {
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
+    if (0 != bpt_insert(&bpt, bpt_timer_key(te), te)) {
+        handle_release(&handles, te->handle);
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
+    TIMER_PROBE_ADD(te->handle, te->time, te->time - msec);
+    printf("add timer time = %u now = %u\n", te->time, current_time());
+    return te->handle;
+}
+
+// 句柄已失效（已触发或已取消）时直接返回 false
+bool del_timer(timer_handle_t h) {
+    timer_entry_t *te = (timer_entry_t *)handle_get(&handles, h);
+    if (!te) {
+        return false;
+    }
+    TIMER_PROBE_DEL(h, te->time);
+    // key 要在释放句柄前算出来
+    bpt_delete(&bpt, bpt_timer_key(te));
+    handle_release(&handles, h);
+    free(te);
+    return true;
+}
+
+int find_nearest_expire_timer() {
+    uint64_t key;
+    void *val;
+    if (bpt_min(&bpt, &key, &val) < 0) return -1;
+    int diff = (int)(uint32_t)(key >> 32) - (int)current_time();
+    return diff > 0 ? diff : 0;
+}
+
+void expire_timer() {
+    uint32_t cur = current_time();
+    uint64_t key;
+    void *val;
+    // 到期的定时器都在最左边的叶子里，顺序弹出
+    while (bpt_min(&bpt, &key, &val) == 0 && (uint32_t)(key >> 32) <= cur) {
+        timer_entry_t *te = (timer_entry_t *)bpt_pop_min(&bpt, &key);
+        handle_release(&handles, te->handle);
+        TIMER_PROBE_FIRE(te->handle, te->time, (int32_t)(cur - te->time));
+        if (te->handler) {
+            te->handler(te);
+        }
+        free(te);
+    }
+}
+
+// 不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+// 和 add_timer / del_timer 在同一个线程调用，跨线程取需要调用者自己加锁
+unsigned expire_into(timer_expired_t *out, unsigned max, uint32_t now) {
+    uint64_t key;
+    void *val;
+    unsigned n = 0;
+    while (n < max && bpt_min(&bpt, &key, &val) == 0 && (uint32_t)(key >> 32) <= now) {
+        timer_entry_t *te = (timer_entry_t *)bpt_pop_min(&bpt, &key);
+        handle_release(&handles, te->handle);
+        TIMER_PROBE_FIRE(te->handle, te->time, (int32_t)(now - te->time));
+        out[n].handle = te->handle;
+        out[n].expire = te->time;
+        free(te);
+        n++;
+    }
+    return n;
+}
+
+#endif
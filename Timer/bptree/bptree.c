@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bptree.h"
+
+#define BPT_MAX_HEIGHT 16  // 32 叉，16 层远超 2^64 个 key
+
+typedef struct bpt_path_s {
+    bpt_inner_t *node[BPT_MAX_HEIGHT];
+    uint32_t idx[BPT_MAX_HEIGHT];   // 走向的孩子下标
+    int depth;
+} bpt_path_t;
+
+#define is_leaf(p) (((bpt_leaf_t *)(p))->leaf)
+
+static void *
+node_alloc(bptree_t *t, int leaf) {
+    void *p = aligned_alloc(64, BPT_NODE_SIZE);
+    if (p) {
+        ((bpt_leaf_t *)p)->n = 0;
+        ((bpt_leaf_t *)p)->leaf = leaf;
+        t->nodes++;
+    }
+    return p;
+}
+
+static void
+node_free(bptree_t *t, void *p) {
+    free(p);
+    t->nodes--;
+}
+
+// 叶子里第一个 >= key 的位置
+static uint32_t
+leaf_lower_bound(const bpt_leaf_t *leaf, uint64_t key) {
+    uint32_t lo = 0, hi = leaf->n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) >> 1;
+        if (leaf->keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// key 所在的孩子：分隔 key 中 <= key 的个数
+static uint32_t
+inner_find(const bpt_inner_t *inner, uint64_t key) {
+    uint32_t lo = 0, hi = inner->n - 1;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) >> 1;
+        if (inner->keys[mid] <= key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// 二分查找的几次访问互相依赖，先把 key 所在的 4 个 cache line 一起取进来
+static inline void
+prefetch_keys(const void *node) {
+    const char *p = (const char *)node;
+    __builtin_prefetch(p + 64);
+    __builtin_prefetch(p + 128);
+    __builtin_prefetch(p + 192);
+}
+
+static bpt_leaf_t *
+descend(const bptree_t *t, uint64_t key, bpt_path_t *path) {
+    void *p = t->root;
+    path->depth = 0;
+    while (!is_leaf(p)) {
+        bpt_inner_t *inner = (bpt_inner_t *)p;
+        prefetch_keys(inner);
+        uint32_t i = inner_find(inner, key);
+        path->node[path->depth] = inner;
+        path->idx[path->depth] = i;
+        path->depth++;
+        p = inner->child[i];
+    }
+    return (bpt_leaf_t *)p;
+}
+
+void
+bpt_init(bptree_t *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+static void
+free_subtree(bptree_t *t, void *p) {
+    if (!is_leaf(p)) {
+        bpt_inner_t *inner = (bpt_inner_t *)p;
+        uint32_t i;
+        for (i = 0; i < inner->n; i++) {
+            free_subtree(t, inner->child[i]);
+        }
+    }
+    node_free(t, p);
+}
+
+void
+bpt_free(bptree_t *t) {
+    if (t->root) {
+        free_subtree(t, t->root);
+    }
+    bpt_init(t);
+}
+
+// 插入 (sep, child) 到内部节点第 i 个孩子之后，节点未满
+static void
+inner_insert(bpt_inner_t *inner, uint32_t i, uint64_t sep, void *child) {
+    memmove(&inner->keys[i + 1], &inner->keys[i], (inner->n - 1 - i) * sizeof(uint64_t));
+    memmove(&inner->child[i + 2], &inner->child[i + 1], (inner->n - 1 - i) * sizeof(void *));
+    inner->keys[i] = sep;
+    inner->child[i + 1] = child;
+    inner->n++;
+}
+
+int
+bpt_insert(bptree_t *t, uint64_t key, void *val) {
+    bpt_path_t path;
+    void *spare[BPT_MAX_HEIGHT + 1];
+    int nspare = 0, need, d;
+    bpt_leaf_t *leaf;
+    uint32_t pos;
+
+    if (!t->root) {
+        leaf = (bpt_leaf_t *)node_alloc(t, 1);
+        if (!leaf) {
+            return -1;
+        }
+        leaf->prev = leaf->next = NULL;
+        leaf->keys[0] = key;
+        leaf->vals[0] = val;
+        leaf->n = 1;
+        t->root = t->head = leaf;
+        t->height = 1;
+        t->count = 1;
+        return 0;
+    }
+
+    leaf = descend(t, key, &path);
+    pos = leaf_lower_bound(leaf, key);
+    if (leaf->n < BPT_LEAF_CAP) {
+        memmove(&leaf->keys[pos + 1], &leaf->keys[pos], (leaf->n - pos) * sizeof(uint64_t));
+        memmove(&leaf->vals[pos + 1], &leaf->vals[pos], (leaf->n - pos) * sizeof(void *));
+        leaf->keys[pos] = key;
+        leaf->vals[pos] = val;
+        leaf->n++;
+        t->count++;
+        return 0;
+    }
+
+    // 先把分裂需要的节点都分配好，中途失败不会留下半棵树
+    need = 1;
+    for (d = path.depth - 1; d >= 0 && path.node[d]->n == BPT_INNER_CAP; d--) {
+        need++;
+    }
+    if (d < 0) {
+        need++;  // 根也要分裂，再加一个新根
+    }
+    for (nspare = 0; nspare < need; nspare++) {
+        spare[nspare] = aligned_alloc(64, BPT_NODE_SIZE);
+        if (!spare[nspare]) {
+            while (nspare-- > 0) {
+                free(spare[nspare]);
+            }
+            return -1;
+        }
+    }
+    t->nodes += need;
+
+    // 插在最右叶子末尾时只把新 key 分出去，左边保持满（到期时间递增的常见情况）
+    int append = pos == BPT_LEAF_CAP && !leaf->next;
+    uint32_t split = append ? BPT_LEAF_CAP : BPT_LEAF_CAP / 2;
+    bpt_leaf_t *right = (bpt_leaf_t *)spare[--nspare];
+    right->leaf = 1;
+    right->n = BPT_LEAF_CAP - split;
+    memcpy(right->keys, &leaf->keys[split], right->n * sizeof(uint64_t));
+    memcpy(right->vals, &leaf->vals[split], right->n * sizeof(void *));
+    leaf->n = split;
+    bpt_leaf_t *dst = pos < split ? leaf : right;
+    uint32_t dpos = pos < split ? pos : pos - split;
+    memmove(&dst->keys[dpos + 1], &dst->keys[dpos], (dst->n - dpos) * sizeof(uint64_t));
+    memmove(&dst->vals[dpos + 1], &dst->vals[dpos], (dst->n - dpos) * sizeof(void *));
+    dst->keys[dpos] = key;
+    dst->vals[dpos] = val;
+    dst->n++;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) {
+        leaf->next->prev = right;
+    }
+    leaf->next = right;
+    t->count++;
+
+    uint64_t sep = right->keys[0];
+    void *child = right;
+    while (path.depth > 0) {
+        path.depth--;
+        bpt_inner_t *inner = path.node[path.depth];
+        uint32_t i = path.idx[path.depth];
+        if (inner->n < BPT_INNER_CAP) {
+            inner_insert(inner, i, sep, child);
+            return 0;
+        }
+        // 内部节点分裂：先拼成 33 个孩子，再一分为二，中间的 key 上移
+        uint64_t keys[BPT_INNER_CAP];
+        void *children[BPT_INNER_CAP + 1];
+        memcpy(keys, inner->keys, i * sizeof(uint64_t));
+        keys[i] = sep;
+        memcpy(&keys[i + 1], &inner->keys[i], (BPT_INNER_CAP - 1 - i) * sizeof(uint64_t));
+        memcpy(children, inner->child, (i + 1) * sizeof(void *));
+        children[i + 1] = child;
+        memcpy(&children[i + 2], &inner->child[i + 1], (BPT_INNER_CAP - 1 - i) * sizeof(void *));
+
+        uint32_t lc = append ? BPT_INNER_CAP : (BPT_INNER_CAP + 1) / 2;  // 左边保留的孩子数
+        bpt_inner_t *rnode = (bpt_inner_t *)spare[--nspare];
+        rnode->leaf = 0;
+        rnode->n = BPT_INNER_CAP + 1 - lc;
+        inner->n = lc;
+        memcpy(inner->keys, keys, (lc - 1) * sizeof(uint64_t));
+        memcpy(inner->child, children, lc * sizeof(void *));
+        memcpy(rnode->keys, &keys[lc], (rnode->n - 1) * sizeof(uint64_t));
+        memcpy(rnode->child, &children[lc], rnode->n * sizeof(void *));
+        sep = keys[lc - 1];
+        child = rnode;
+    }
+
+    // 根分裂，树长高一层
+    bpt_inner_t *root = (bpt_inner_t *)spare[--nspare];
+    root->leaf = 0;
+    root->n = 2;
+    root->keys[0] = sep;
+    root->child[0] = t->root;
+    root->child[1] = child;
+    t->root = root;
+    t->height++;
+    return 0;
+}
+
+// 叶子已空：从叶子链表和父节点中摘掉，父节点空了继续往上摘
+static void
+remove_empty_leaf(bptree_t *t, bpt_leaf_t *leaf, bpt_path_t *path) {
+    if (leaf->prev) {
+        leaf->prev->next = leaf->next;
+    }
+    if (leaf->next) {
+        leaf->next->prev = leaf->prev;
+    }
+    if (t->head == leaf) {
+        t->head = leaf->next;
+    }
+    node_free(t, leaf);
+
+    while (path->depth > 0) {
+        path->depth--;
+        bpt_inner_t *inner = path->node[path->depth];
+        uint32_t i = path->idx[path->depth];
+        if (inner->n > 1) {
+            // 去掉第 i 个孩子和它的下界；第 0 个孩子没有下界，去掉 child[1] 的下界
+            uint32_t k = i > 0 ? i - 1 : 0;
+            memmove(&inner->keys[k], &inner->keys[k + 1], (inner->n - 2 - k) * sizeof(uint64_t));
+            memmove(&inner->child[i], &inner->child[i + 1], (inner->n - 1 - i) * sizeof(void *));
+            inner->n--;
+            // 根只剩一个孩子时降低高度
+            while (t->height > 1 && ((bpt_inner_t *)t->root)->n == 1) {
+                bpt_inner_t *old = (bpt_inner_t *)t->root;
+                t->root = old->child[0];
+                node_free(t, old);
+                t->height--;
+            }
+            return;
+        }
+        node_free(t, inner);
+    }
+    // 整棵树空了
+    t->root = NULL;
+    t->head = NULL;
+    t->height = 0;
+}
+
+void *
+bpt_delete(bptree_t *t, uint64_t key) {
+    bpt_path_t path;
+    bpt_leaf_t *leaf;
+    uint32_t pos;
+    void *val;
+    if (!t->root) {
+        return NULL;
+    }
+    leaf = descend(t, key, &path);
+    pos = leaf_lower_bound(leaf, key);
+    if (pos >= leaf->n || leaf->keys[pos] != key) {
+        return NULL;
+    }
+    val = leaf->vals[pos];
+    t->count--;
+    if (leaf->n == 1) {
+        remove_empty_leaf(t, leaf, &path);
+        return val;
+    }
+    memmove(&leaf->keys[pos], &leaf->keys[pos + 1], (leaf->n - 1 - pos) * sizeof(uint64_t));
+    memmove(&leaf->vals[pos], &leaf->vals[pos + 1], (leaf->n - 1 - pos) * sizeof(void *));
+    leaf->n--;
+    return val;
+}
+
+void *
+bpt_pop_min(bptree_t *t, uint64_t *key) {
+    bpt_leaf_t *leaf = t->head;
+    void *val;
+    if (!leaf) {
+        return NULL;
+    }
+    *key = leaf->keys[0];
+    val = leaf->vals[0];
+    if (leaf->n == 1) {
+        // 最左叶子弹空了才需要从根走一遍
+        return bpt_delete(t, *key);
+    }
+    memmove(&leaf->keys[0], &leaf->keys[1], (leaf->n - 1) * sizeof(uint64_t));
+    memmove(&leaf->vals[0], &leaf->vals[1], (leaf->n - 1) * sizeof(void *));
+    leaf->n--;
+    t->count--;
+    return val;
+}
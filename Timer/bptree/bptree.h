@@ -0,0 +1,66 @@
+#ifndef MARK_BPTREE_H
+#define MARK_BPTREE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 定时器用的 B+ 树：
+ *   - 叶子和内部节点都是 512 字节（8 个 cache line），一个叶子放 30 个 (key, val)，
+ *     内部节点最多 32 个孩子，1000 万定时器只有 5 层，比红黑树少得多的依赖访存；
+ *   - 叶子双向链表串起来，head 指向最左叶子，取最小值 O(1)，到期时从最左叶子顺序弹出；
+ *   - key 由调用者保证唯一，定时器用 (到期时间 << 32 | 句柄槽位下标)，按 key 删除；
+ *   - 插入在最右叶子末尾（到期时间单调递增的常见情况）时只把新 key 分出去，叶子保持满；
+ *   - 删除不做合并，叶子 / 内部节点空了才摘掉（free-at-empty），定时器负载下足够紧凑。
+ */
+
+#define BPT_NODE_SIZE 512
+#define BPT_LEAF_CAP  30
+#define BPT_INNER_CAP 32   // 孩子个数上限，分隔 key 少一个
+
+typedef struct bpt_leaf_s bpt_leaf_t;
+
+struct bpt_leaf_s {
+    uint32_t n;
+    uint32_t leaf;          // 恒为 1，和内部节点区分
+    bpt_leaf_t *prev, *next;
+    uint64_t keys[BPT_LEAF_CAP];
+    void *vals[BPT_LEAF_CAP];
+};
+
+typedef struct bpt_inner_s {
+    uint32_t n;             // 孩子个数
+    uint32_t leaf;          // 恒为 0
+    uint64_t keys[BPT_INNER_CAP - 1];  // keys[i] 是 child[i + 1] 的下界
+    void *child[BPT_INNER_CAP];
+} bpt_inner_t;
+
+typedef struct bptree_s {
+    void *root;             // 空树为 NULL
+    bpt_leaf_t *head;       // 最左叶子
+    uint32_t height;        // 叶子为第 1 层
+    uint64_t count;
+    uint64_t nodes;         // 已分配的节点数，用于统计内存
+} bptree_t;
+
+void  bpt_init(bptree_t *t);
+// 释放所有节点，不释放 val
+void  bpt_free(bptree_t *t);
+// key 已存在时行为未定义；内存不足返回 -1
+int   bpt_insert(bptree_t *t, uint64_t key, void *val);
+// 返回被删除的 val，key 不存在返回 NULL
+void *bpt_delete(bptree_t *t, uint64_t key);
+// 最小 key，空树返回 -1
+static inline int
+bpt_min(const bptree_t *t, uint64_t *key, void **val) {
+    if (!t->head) {
+        return -1;
+    }
+    *key = t->head->keys[0];
+    *val = t->head->vals[0];
+    return 0;
+}
+// 弹出最小 key 对应的 val，空树返回 NULL
+void *bpt_pop_min(bptree_t *t, uint64_t *key);
+
+#endif // MARK_BPTREE_H
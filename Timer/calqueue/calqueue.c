@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+#include "calqueue.h"
+
+#define cq_node_of_link(l) ((cq_node_t *)(l))
+
+static inline uint32_t
+bucket_of(const calqueue_t *q, uint32_t t) {
+    return (t / q->width) & (q->nbuckets - 1);
+}
+
+// 把出队位置放到 t 所在的桶
+static void
+seek(calqueue_t *q, uint32_t t) {
+    q->last_bucket = bucket_of(q, t);
+    q->bucket_top = ((uint64_t)(t / q->width) + 1) * q->width;
+}
+
+static void
+buckets_init(cq_link_t *b, uint32_t n) {
+    uint32_t i;
+    for (i = 0; i < n; i++) {
+        b[i].prev = b[i].next = &b[i];
+    }
+}
+
+// 桶内按到期时间排序，从尾部往前找：新定时器一般比桶里已有的晚，相同到期时间先进先出
+static void
+bucket_insert(cq_link_t *head, cq_node_t *node) {
+    cq_link_t *pos = head->prev;
+    while (pos != head && cq_node_of_link(pos)->expire > node->expire) {
+        pos = pos->prev;
+    }
+    node->link.prev = pos;
+    node->link.next = pos->next;
+    pos->next->prev = &node->link;
+    pos->next = &node->link;
+}
+
+static void
+unlink_node(cq_node_t *node) {
+    node->link.prev->next = node->link.next;
+    node->link.next->prev = node->link.prev;
+    node->link.prev = node->link.next = NULL;
+}
+
+static void resize(calqueue_t *q, uint32_t nbuckets);
+
+int
+cq_init(calqueue_t *q, uint32_t now) {
+    memset(q, 0, sizeof(*q));
+    q->nbuckets = CQ_MIN_BUCKETS;
+    q->width = 1;
+    q->buckets = (cq_link_t *)malloc(q->nbuckets * sizeof(cq_link_t));
+    if (!q->buckets) {
+        return -1;
+    }
+    buckets_init(q->buckets, q->nbuckets);
+    seek(q, now);
+    q->resize_enabled = 1;
+    return 0;
+}
+
+void
+cq_free(calqueue_t *q) {
+    free(q->buckets);
+    q->buckets = NULL;
+    q->count = 0;
+}
+
+void
+cq_add(calqueue_t *q, cq_node_t *node, uint32_t expire) {
+    node->expire = expire;
+    // 比出队位置还早（已经过期的定时器），把位置挪回来
+    if ((uint64_t)expire + q->width < q->bucket_top) {
+        seek(q, expire);
+    }
+    bucket_insert(&q->buckets[bucket_of(q, expire)], node);
+    q->count++;
+    if (q->resize_enabled && q->count > 2 * q->nbuckets) {
+        resize(q, q->nbuckets * 2);
+    }
+}
+
+void
+cq_del(calqueue_t *q, cq_node_t *node) {
+    unlink_node(node);
+    q->count--;
+    if (q->resize_enabled && q->nbuckets > CQ_MIN_BUCKETS && q->count < q->nbuckets / 2) {
+        resize(q, q->nbuckets / 2);
+    }
+}
+
+cq_node_t *
+cq_peek(calqueue_t *q) {
+    uint32_t i, n, mask = q->nbuckets - 1;
+    uint64_t top = q->bucket_top;
+    cq_node_t *best = NULL;
+    if (!q->count) {
+        return NULL;
+    }
+    // 从出队位置往后扫一年，桶里第一个节点落在当前这一年就是最小值
+    for (i = q->last_bucket, n = 0; n < q->nbuckets; n++) {
+        cq_link_t *head = &q->buckets[i];
+        if (head->next != head && cq_node_of_link(head->next)->expire < top) {
+            q->last_bucket = i;
+            q->bucket_top = top;
+            return cq_node_of_link(head->next);
+        }
+        i = (i + 1) & mask;
+        top += q->width;
+    }
+    // 一年内都没有（定时器很稀疏），直接比较所有桶的第一个节点
+    for (i = 0; i < q->nbuckets; i++) {
+        cq_link_t *head = &q->buckets[i];
+        if (head->next != head && (!best || cq_node_of_link(head->next)->expire < best->expire)) {
+            best = cq_node_of_link(head->next);
+        }
+    }
+    seek(q, best->expire);
+    return best;
+}
+
+cq_node_t *
+cq_pop_expired(calqueue_t *q, uint32_t now) {
+    cq_node_t *node = cq_peek(q);
+    if (!node || node->expire > now) {
+        return NULL;
+    }
+    cq_del(q, node);
+    return node;
+}
+
+// 取队首最多 CQ_SAMPLES 个节点，平均间隔去掉大于两倍均值的离群值后乘 3
+static uint32_t
+new_width(calqueue_t *q) {
+    cq_node_t *samples[CQ_SAMPLES];
+    uint32_t k = 0, i, cnt = 0;
+    uint64_t sum, width;
+    if (q->count < 2) {
+        return q->width;
+    }
+    while (k < CQ_SAMPLES && q->count) {
+        samples[k] = cq_peek(q);
+        unlink_node(samples[k]);
+        q->count--;
+        k++;
+    }
+    sum = samples[k - 1]->expire - samples[0]->expire;
+    width = 0;
+    for (i = 1; i < k; i++) {
+        uint32_t gap = samples[i]->expire - samples[i - 1]->expire;
+        if ((uint64_t)gap * (k - 1) <= 2 * sum) {
+            width += gap;
+            cnt++;
+        }
+    }
+    for (i = 0; i < k; i++) {
+        cq_add(q, samples[i], samples[i]->expire);
+    }
+    width = cnt ? 3 * width / cnt : 0;
+    return width ? (uint32_t)width : 1;
+}
+
+// 按新的桶数和宽度重建，整体 O(n)，均摊到每次增删是 O(1)
+static void
+resize(calqueue_t *q, uint32_t nbuckets) {
+    cq_link_t *old = q->buckets, *b;
+    uint32_t oldn = q->nbuckets, i;
+    uint64_t start = q->bucket_top - q->width;  // 所有节点都不早于它
+    q->resize_enabled = 0;
+    uint32_t width = new_width(q);
+    b = (cq_link_t *)malloc(nbuckets * sizeof(cq_link_t));
+    if (!b) {
+        q->resize_enabled = 1;
+        return;  // 内存不足就保持原样，只是慢一些
+    }
+    buckets_init(b, nbuckets);
+    q->buckets = b;
+    q->nbuckets = nbuckets;
+    q->width = width;
+    for (i = 0; i < oldn; i++) {
+        cq_link_t *head = &old[i];
+        while (head->next != head) {
+            cq_node_t *node = cq_node_of_link(head->next);
+            unlink_node(node);
+            bucket_insert(&q->buckets[bucket_of(q, node->expire)], node);
+        }
+    }
+    free(old);
+    seek(q, (uint32_t)start);
+    q->resizes++;
+    q->resize_enabled = 1;
+}
@@ -0,0 +1,56 @@
+#ifndef MARK_CALQUEUE_H
+#define MARK_CALQUEUE_H
+
+#include <stdint.h>
+
+/*
+ * 日历队列（Brown 1988）：nbuckets 个桶，每个桶覆盖 width 毫秒，一"年"为 nbuckets * width，
+ * 到期时间 t 落在第 (t / width) % nbuckets 个桶，桶内是按到期时间排序的双向链表。
+ *   - 出队从上次的位置往后扫，只取落在当前桶这一年内的节点，桶数和宽度合适时均摊 O(1)；
+ *   - 节点数超过 2 * nbuckets 时桶数翻倍，低于 nbuckets / 2 时减半，
+ *     同时取队首若干个节点的平均间隔（去掉离群值）乘 3 作为新的桶宽度，
+ *     所以不依赖固定的刻度和超时分布，时间轮那样的 8/6 位分层只适合毫秒刻度；
+ *   - 取消只是从桶链表里摘下，O(1)。
+ */
+
+#define CQ_MIN_BUCKETS 16
+#define CQ_SAMPLES     25   // 估算桶宽度时取样的节点数
+
+typedef struct cq_link_s cq_link_t;
+typedef struct cq_node_s cq_node_t;
+typedef void (*cq_handler_pt)(cq_node_t *node);
+
+struct cq_link_s {
+    cq_link_t *prev;
+    cq_link_t *next;
+};
+
+struct cq_node_s {
+    cq_link_t link;         // 必须是第一个成员
+    uint32_t expire;
+    cq_handler_pt handler;
+    void *privdata;
+    uint64_t handle;        // 定时器句柄，见 timer_handle.h
+};
+
+typedef struct calqueue_s {
+    cq_link_t *buckets;     // 每个桶是带哨兵的环形链表
+    uint32_t nbuckets;      // 2 的幂
+    uint32_t width;         // 桶宽度（ms）
+    uint32_t last_bucket;   // 出队位置
+    uint64_t bucket_top;    // 出队位置所在桶这一年的上界（不含），所有节点都不早于 bucket_top - width
+    uint32_t count;
+    int resize_enabled;     // 重建过程中关闭
+    uint64_t resizes;       // 累计重建次数
+} calqueue_t;
+
+int        cq_init(calqueue_t *q, uint32_t now);
+void       cq_free(calqueue_t *q);
+void       cq_add(calqueue_t *q, cq_node_t *node, uint32_t expire);
+void       cq_del(calqueue_t *q, cq_node_t *node);
+// 最近到期的节点，不出队；为空返回 NULL
+cq_node_t *cq_peek(calqueue_t *q);
+// 取出一个到期时间 <= now 的节点，没有返回 NULL
+cq_node_t *cq_pop_expired(calqueue_t *q, uint32_t now);
+
+#endif // MARK_CALQUEUE_H
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "calqueue.h"
+#include "rbtree.h"
+#include "minheap.h"
+
+/*
+ * 稳态负载：模拟时间逐毫秒推进，每毫秒添加 RATE 个定时器、随机取消 CANCEL 个存活的定时器，
+ * 再弹出所有到期的定时器。三种超时分布：
+ *   - skewed ：90% 1~100ms，9% 100ms~5s，1% 5s~60s；
+ *   - uniform：1ms~60s 均匀；
+ *   - bimodal：95% 50~500ms，5% 30s~60min。
+ * 分别跑日历队列、红黑树、最小堆，输出每个操作的平均耗时，日历队列同时检查弹出顺序。
+ */
+
+#define RATE     50
+#define CANCEL   15
+#define SIM_MS   60000
+#define MAX_LIVE (RATE * 3600 * 1000 / 20)
+
+typedef struct bench_ops_s {
+    const char *name;
+    void  (*init)(uint32_t now);
+    void *(*add)(uint32_t expire, int id);
+    void  (*del)(void *node);
+    int   (*pop)(uint32_t now);          // 返回到期定时器的 id，没有返回 -1
+    void  (*stat)(void);                 // 可以为 NULL
+    void  (*fini)(void);
+} bench_ops_t;
+
+/* ---------------- 日历队列 ---------------- */
+typedef struct { cq_node_t node; int id; } cq_item_t;
+static calqueue_t cq;
+static uint32_t cq_last;
+static int cq_in_order;
+static void cq_binit(uint32_t now) { cq_init(&cq, now); cq_last = 0; cq_in_order = 1; }
+static void *cq_badd(uint32_t expire, int id) {
+    cq_item_t *it = malloc(sizeof(*it));
+    it->id = id;
+    cq_add(&cq, &it->node, expire);
+    return it;
+}
+static void cq_bdel(void *p) { cq_del(&cq, &((cq_item_t *)p)->node); free(p); }
+static int cq_bpop(uint32_t now) {
+    cq_node_t *n = cq_pop_expired(&cq, now);
+    if (!n) return -1;
+    cq_in_order = cq_in_order && n->expire >= cq_last;
+    cq_last = n->expire;
+    int id = ((cq_item_t *)n)->id;
+    free(n);
+    return id;
+}
+static void cq_bstat(void) {
+    printf("  calqueue buckets = %u width = %ums resizes = %llu order %s\n", cq.nbuckets, cq.width,
+        (unsigned long long)cq.resizes, cq_in_order ? "ok" : "BAD");
+}
+static void cq_bfini(void) { cq_free(&cq); }
+
+/* ---------------- 红黑树 ---------------- */
+typedef struct { ngx_rbtree_node_t node; int id; } rb_item_t;
+static ngx_rbtree_t rb;
+static ngx_rbtree_node_t rb_sentinel;
+static void rb_init(uint32_t now) { ngx_rbtree_init(&rb, &rb_sentinel, ngx_rbtree_insert_timer_value); }
+static void *rb_add(uint32_t expire, int id) {
+    rb_item_t *it = malloc(sizeof(*it));
+    it->id = id;
+    it->node.key = expire;
+    ngx_rbtree_insert(&rb, &it->node);
+    return it;
+}
+static void rb_del(void *p) { ngx_rbtree_delete(&rb, &((rb_item_t *)p)->node); free(p); }
+static int rb_pop(uint32_t now) {
+    if (rb.root == rb.sentinel) return -1;
+    ngx_rbtree_node_t *n = ngx_rbtree_min(rb.root, rb.sentinel);
+    if ((int32_t)(n->key - now) > 0) return -1;
+    ngx_rbtree_delete(&rb, n);
+    int id = ((rb_item_t *)n)->id;
+    free(n);
+    return id;
+}
+static void rb_fini(void) {}
+
+/* ---------------- 最小堆 ---------------- */
+static min_heap_t mh;
+static void mh_init(uint32_t now) { min_heap_ctor_(&mh); }
+static void *mh_add(uint32_t expire, int id) {
+    timer_entry_t *te = malloc(sizeof(*te));
+    te->time = expire;
+    te->privdata = (void *)(intptr_t)id;
+    min_heap_push_(&mh, te);
+    return te;
+}
+static void mh_del(void *p) { min_heap_erase_(&mh, p); free(p); }
+static int mh_pop(uint32_t now) {
+    timer_entry_t *te = min_heap_top_(&mh);
+    if (!te || te->time > now) return -1;
+    min_heap_pop_(&mh);
+    int id = (int)(intptr_t)te->privdata;
+    free(te);
+    return id;
+}
+static void mh_fini(void) { min_heap_dtor_(&mh); }
+
+static const bench_ops_t backends[] = {
+    { "calqueue", cq_binit, cq_badd, cq_bdel, cq_bpop, cq_bstat, cq_bfini },
+    { "rbtree",   rb_init,  rb_add,  rb_del,  rb_pop,  NULL,     rb_fini },
+    { "minheap",  mh_init,  mh_add,  mh_del,  mh_pop,  NULL,     mh_fini },
+};
+
+/* ---------------- 负载 ---------------- */
+static void *nodes[MAX_LIVE];
+static int live[MAX_LIVE];       // 存活定时器的 id，取消时随机挑
+static int live_pos[MAX_LIVE];   // id 在 live 中的下标
+static int free_ids[MAX_LIVE];
+static int nlive, nfree;
+
+static uint32_t
+rnd() {
+    return (uint32_t)rand() << 16 ^ (uint32_t)rand();
+}
+
+static uint32_t
+timeout(int mix) {
+    uint32_t r = rnd() % 100;
+    switch (mix) {
+    case 0:
+        if (r < 90) return 1 + rnd() % 100;
+        if (r < 99) return 100 + rnd() % 4900;
+        return 5000 + rnd() % 55000;
+    case 1:
+        return 1 + rnd() % 60000;
+    default:
+        if (r < 95) return 50 + rnd() % 450;
+        return 30000 + rnd() % 3570000;
+    }
+}
+
+static void
+live_remove(int id) {
+    int last = live[--nlive];
+    live[live_pos[id]] = last;
+    live_pos[last] = live_pos[id];
+    nodes[id] = NULL;
+    free_ids[nfree++] = id;
+}
+
+static double
+now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+run(const bench_ops_t *ops, int mix) {
+    uint32_t now = 1000;
+    uint64_t ops_done = 0;
+    int i;
+
+    srand(12345);
+    nlive = 0;
+    nfree = 0;
+    for (i = MAX_LIVE - 1; i >= 0; i--) {
+        free_ids[nfree++] = i;
+    }
+    ops->init(now);
+    double start = now_sec();
+    for (; now < 1000 + SIM_MS; now++) {
+        for (i = 0; i < RATE && nfree > 0; i++) {
+            int id = free_ids[--nfree];
+            nodes[id] = ops->add(now + timeout(mix), id);
+            live_pos[id] = nlive;
+            live[nlive++] = id;
+        }
+        for (i = 0; i < CANCEL && nlive > 0; i++) {
+            int id = live[rnd() % nlive];
+            ops->del(nodes[id]);
+            live_remove(id);
+        }
+        int id;
+        while ((id = ops->pop(now)) != -1) {
+            live_remove(id);
+            ops_done++;
+        }
+        ops_done += RATE + CANCEL;
+    }
+    double cost = now_sec() - start;
+    printf("  %-8s %8.3f s  live = %d  %.1f ns/op\n", ops->name, cost, nlive, cost * 1e9 / ops_done);
+    if (ops->stat) {
+        ops->stat();
+    }
+    // 清理剩下的
+    for (i = 0; i < nlive; i++) {
+        ops->del(nodes[live[i]]);
+    }
+    ops->fini();
+}
+
+int main() {
+    static const char *mixes[] = { "skewed", "uniform", "bimodal" };
+    size_t i;
+    int mix;
+    for (mix = 0; mix < 3; mix++) {
+        printf("%s\n", mixes[mix]);
+        for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+            run(&backends[i], mix);
+        }
+    }
+    return 0;
+}
+
+// gcc -O2 cq-bench.c calqueue.c ../rbtree/rbtree.c ../minheap/minheap.c -o cq-bench -I./ -I../rbtree -I../minheap
@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <sys/epoll.h>
+#include "cq-timer.h"
+
+void hello_world(timer_entry_t *te) {
+    printf("hello world time = %u\n", te->expire);
+}
+
+int main() {
+    init_timer();
+
+    add_timer(200, hello_world);
+    add_timer(1000, hello_world);
+    add_timer(3000, hello_world);
+    // 超过 2 * 16 个定时器时桶数翻倍，并按队首的到期间隔重新估算桶宽度
+    for (int i = 0; i < 40; i++) {
+        add_timer(1500 + i * 50, hello_world);
+    }
+    timer_handle_t h = add_timer(2500, hello_world);
+    del_timer(h);
+    del_timer(h);  // 句柄已失效，重复取消是空操作
+
+    int epfd = epoll_create(1);
+    struct epoll_event events[512];
+
+    for (;;) {
+        int nearest = find_nearest_expire_timer();
+        int n = epoll_wait(epfd, events, 512, nearest);
+        for (int i=0; i < n; i++) {
+            //
+        }
+        expire_timer();
+    }
+    return 0;
+}
+
+// gcc cq-timer.c calqueue.c -o cq -I./ -I../common
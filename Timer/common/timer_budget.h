@@ -0,0 +1,48 @@
+#ifndef MARK_TIMER_BUDGET_H
+#define MARK_TIMER_BUDGET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * 每次 expire_timer 的触发预算：最多触发 max_count 个，或最多占用 max_usec 微秒，0 表示不限。
+ * 预算用完时剩下的已到期定时器原样留在结构里（仍按到期时间排序），
+ * find_nearest_expire_timer 对它们返回 0，事件循环处理完 I/O 后会马上再来取。
+ */
+
+typedef struct timer_budget_s {
+    uint32_t max_count;
+    uint32_t max_usec;
+} timer_budget_t;
+
+typedef struct timer_budget_stat_s {
+    uint64_t fired;            // 累计触发个数
+    uint64_t exhausted;        // 因预算用完而提前返回的次数
+    uint32_t backlog_lag_ms;   // 最近一次返回时，积压中最早的定时器已超时多少毫秒
+    bool backlog;              // 最近一次返回时是否还有已到期未触发的定时器
+} timer_budget_stat_t;
+
+#define TIMER_BUDGET_CLOCK_EVERY 16  // 每触发这么多个才读一次时钟
+
+static inline uint64_t
+timer_budget_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 本次已触发 fired 个，开始于 start_us，预算是否已用完
+static inline bool
+timer_budget_exhausted(const timer_budget_t *b, uint32_t fired, uint64_t start_us) {
+    if (b->max_count && fired >= b->max_count) {
+        return true;
+    }
+    if (b->max_usec && fired && fired % TIMER_BUDGET_CLOCK_EVERY == 0
+        && timer_budget_now_us() - start_us >= b->max_usec) {
+        return true;
+    }
+    return false;
+}
+
+#endif // MARK_TIMER_BUDGET_H
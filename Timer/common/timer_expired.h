@@ -0,0 +1,19 @@
+#ifndef MARK_TIMER_EXPIRED_H
+#define MARK_TIMER_EXPIRED_H
+
+#include <stdint.h>
+#include "timer_handle.h"
+
+/*
+ * 批量取出到期定时器（expire_into）时写给调用者的记录，不经过回调。
+ * 句柄在取出时已经失效，只用来和调用者自己保存的句柄对应，
+ * 比如一次取出所有到期的保活定时器，找到对应连接后用一次 sendmmsg 发出去。
+ * 只用来批量取的定时器可以用 NULL 回调添加，expire_timer 会跳过它们的回调。
+ */
+
+typedef struct timer_expired_s {
+    timer_handle_t handle;
+    uint32_t expire;    // 到期时间（ms），和取出时的当前时间相减就是延迟
+} timer_expired_t;
+
+#endif // MARK_TIMER_EXPIRED_H
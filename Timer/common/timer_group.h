@@ -0,0 +1,79 @@
+#ifndef MARK_TIMER_GROUP_H
+#define MARK_TIMER_GROUP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 定时器组：一个连接上的空闲、写超时、保活、重传等定时器在添加时挂到同一个组里，
+ * 关闭连接时 cancel_group 沿组内的双向链表逐个摘除，不用再按句柄一个个查找。
+ * 组对象由调用方持有（通常嵌在连接对象里），定时器触发或被单独取消时自动离开组。
+ * 链表节点嵌在各后端的定时器节点里，组本身不分配内存。
+ */
+
+typedef struct timer_group_s timer_group_t;
+
+typedef struct timer_group_link_s {
+    struct timer_group_link_s *prev, *next;
+    timer_group_t *group;   // 不在任何组里时为 NULL
+} timer_group_link_t;
+
+struct timer_group_s {
+    timer_group_link_t head;  // 哨兵
+    uint32_t count;
+};
+
+#define timer_group_entry(link, type, member) \
+    ((type *)((char *)(link) - offsetof(type, member)))
+
+static inline void
+timer_group_init(timer_group_t *g) {
+    g->head.prev = g->head.next = &g->head;
+    g->head.group = g;
+    g->count = 0;
+}
+
+static inline void
+timer_group_link_init(timer_group_link_t *l) {
+    l->prev = l->next = NULL;
+    l->group = NULL;
+}
+
+// g 为 NULL 时不加入任何组
+static inline void
+timer_group_attach(timer_group_t *g, timer_group_link_t *l) {
+    if (!g) {
+        timer_group_link_init(l);
+        return;
+    }
+    l->prev = g->head.prev;
+    l->next = &g->head;
+    g->head.prev->next = l;
+    g->head.prev = l;
+    l->group = g;
+    g->count++;
+}
+
+static inline void
+timer_group_detach(timer_group_link_t *l) {
+    if (!l->group) {
+        return;
+    }
+    l->prev->next = l->next;
+    l->next->prev = l->prev;
+    l->group->count--;
+    timer_group_link_init(l);
+}
+
+// 摘下组里的第一个成员，组为空返回 NULL
+static inline timer_group_link_t *
+timer_group_pop(timer_group_t *g) {
+    timer_group_link_t *l = g->head.next;
+    if (l == &g->head) {
+        return NULL;
+    }
+    timer_group_detach(l);
+    return l;
+}
+
+#endif // MARK_TIMER_GROUP_H
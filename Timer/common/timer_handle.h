@@ -0,0 +1,142 @@
+#ifndef MARK_TIMER_HANDLE_H
+#define MARK_TIMER_HANDLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * 定时器句柄：低 32 位为槽位下标，高 32 位为代数（generation）。
+ * 槽位表由定时器实例持有，节点释放时槽位代数加一，之前发出的句柄随即失效，
+ * 用失效句柄取消定时器是 O(1) 的空操作，不会再访问已释放的节点。
+ */
+
+typedef uint64_t timer_handle_t;
+
+#define TIMER_HANDLE_INVALID 0
+#define handle_index(h) ((uint32_t)(h))
+#define handle_gen(h)   ((uint32_t)((h) >> 32))
+
+typedef struct handle_slot_s {
+    void *ptr;          // 存活时指向节点，空闲时为 NULL
+    uint32_t gen;
+    uint32_t next;      // 空闲链表中的下一个槽位
+} handle_slot_t;
+
+typedef struct handle_table_s {
+    handle_slot_t *slots;
+    uint32_t n, a;      // n 为已使用过的槽位数  a 为容量
+    uint32_t free_head; // UINT32_MAX 表示没有空闲槽位
+} handle_table_t;
+
+static inline void
+handle_table_init(handle_table_t *t) {
+    t->slots = NULL;
+    t->n = t->a = 0;
+    t->free_head = UINT32_MAX;
+}
+
+static inline void
+handle_table_free(handle_table_t *t) {
+    free(t->slots);
+    handle_table_init(t);
+}
+
+// 为节点分配句柄，内存不足返回 TIMER_HANDLE_INVALID
+static inline timer_handle_t
+handle_alloc(handle_table_t *t, void *ptr) {
+    uint32_t idx;
+    handle_slot_t *s;
+    if (t->free_head != UINT32_MAX) {
+        idx = t->free_head;
+        t->free_head = t->slots[idx].next;
+    } else {
+        if (t->n == t->a) {
+            uint32_t a = t->a ? t->a * 2 : 64;
+            handle_slot_t *slots = (handle_slot_t *)realloc(t->slots, a * sizeof(*slots));
+            if (!slots) {
+                return TIMER_HANDLE_INVALID;
+            }
+            t->slots = slots;
+            t->a = a;
+        }
+        idx = t->n++;
+        t->slots[idx].gen = 1;
+    }
+    s = &t->slots[idx];
+    s->ptr = ptr;
+    return ((timer_handle_t)s->gen << 32) | idx;
+}
+
+// 句柄仍然有效时返回节点，否则返回 NULL
+static inline void *
+handle_get(const handle_table_t *t, timer_handle_t h) {
+    uint32_t idx = handle_index(h);
+    if (idx >= t->n || t->slots[idx].gen != handle_gen(h)) {
+        return NULL;
+    }
+    return t->slots[idx].ptr;
+}
+
+// 释放句柄并返回对应节点；句柄已失效时返回 NULL
+static inline void *
+handle_release(handle_table_t *t, timer_handle_t h) {
+    void *ptr = handle_get(t, h);
+    uint32_t idx = handle_index(h);
+    if (!ptr) {
+        return NULL;
+    }
+    handle_slot_t *s = &t->slots[idx];
+    s->ptr = NULL;
+    if (++s->gen == 0) {
+        s->gen = 1;  // 代数 0 保留给 TIMER_HANDLE_INVALID
+    }
+    s->next = t->free_head;
+    t->free_head = idx;
+    return ptr;
+}
+
+// 恢复快照时按原句柄放回节点，槽位已被占用返回 -1；全部放回后调用 handle_table_relink
+static inline int
+handle_restore(handle_table_t *t, timer_handle_t h, void *ptr) {
+    uint32_t idx = handle_index(h);
+    if (h == TIMER_HANDLE_INVALID || idx == UINT32_MAX) {
+        return -1;
+    }
+    if (idx >= t->a) {
+        uint32_t a = t->a ? t->a : 64;
+        while (a <= idx) {
+            a *= 2;
+        }
+        handle_slot_t *slots = (handle_slot_t *)realloc(t->slots, a * sizeof(*slots));
+        if (!slots) {
+            return -1;
+        }
+        t->slots = slots;
+        t->a = a;
+    }
+    for (; t->n <= idx; t->n++) {
+        t->slots[t->n].ptr = NULL;
+        t->slots[t->n].gen = 1;
+    }
+    if (t->slots[idx].ptr) {
+        return -1;
+    }
+    t->slots[idx].ptr = ptr;
+    t->slots[idx].gen = handle_gen(h);
+    return 0;
+}
+
+// 把没有放回节点的槽位串成空闲链表
+static inline void
+handle_table_relink(handle_table_t *t) {
+    uint32_t i = t->n;
+    t->free_head = UINT32_MAX;
+    while (i-- > 0) {
+        if (!t->slots[i].ptr) {
+            t->slots[i].next = t->free_head;
+            t->free_head = i;
+        }
+    }
+}
+
+#endif // MARK_TIMER_HANDLE_H
@@ -0,0 +1,96 @@
+#ifndef MARK_TIMER_IDLE_H
+#define MARK_TIMER_IDLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 按 fd 的空闲超时（惰性刷新）：连接每收发一次数据只记一下最近活动时间，不动定时器。
+ * 每个 fd 底层只挂一个定时器，到期时看最近活动时间：期间有过活动就按剩余时间重新挂上，
+ * 真的空闲满 timeout 才回调。每秒几千个包的连接，每个 timeout 周期最多一次定时器操作。
+ * 表按 fd 下标直接索引，由定时器实例持有；挂定时器、回调由各后端的定时器层完成。
+ */
+
+typedef void (*timer_idle_handler_pt)(int fd, void *ud);
+
+typedef struct timer_idle_s {
+    uint32_t last_active;   // 最近一次活动的时间（ms）
+    uint32_t timeout;       // 空闲多久算超时，0 表示没有在监视
+    uint64_t timer;         // 底层定时器的句柄
+    timer_idle_handler_pt handler;
+    void *ud;
+} timer_idle_t;
+
+typedef struct timer_idle_stat_s {
+    uint64_t touched;       // 记录活动的次数
+    uint64_t rearmed;       // 到期时发现有活动、按剩余时间重挂的次数
+    uint64_t fired;         // 真正空闲超时回调的次数
+} timer_idle_stat_t;
+
+typedef struct timer_idle_table_s {
+    timer_idle_t *slots;
+    int cap;
+    timer_idle_stat_t stat;
+} timer_idle_table_t;
+
+static inline void
+timer_idle_table_init(timer_idle_table_t *t) {
+    memset(t, 0, sizeof(*t));
+}
+
+static inline void
+timer_idle_table_free(timer_idle_table_t *t) {
+    free(t->slots);
+    timer_idle_table_init(t);
+}
+
+// 取 fd 的槽位，不够时按倍数扩容，内存不足返回 NULL
+static inline timer_idle_t *
+timer_idle_slot(timer_idle_table_t *t, int fd) {
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fd >= t->cap) {
+        int cap = t->cap ? t->cap : 64;
+        while (cap <= fd) {
+            cap *= 2;
+        }
+        timer_idle_t *slots = (timer_idle_t *)realloc(t->slots, cap * sizeof(*slots));
+        if (!slots) {
+            return NULL;
+        }
+        memset(slots + t->cap, 0, (cap - t->cap) * sizeof(*slots));
+        t->slots = slots;
+        t->cap = cap;
+    }
+    return &t->slots[fd];
+}
+
+// 正在监视的 fd 的槽位，否则返回 NULL
+static inline timer_idle_t *
+timer_idle_find(timer_idle_table_t *t, int fd) {
+    if (fd < 0 || fd >= t->cap || !t->slots[fd].timeout) {
+        return NULL;
+    }
+    return &t->slots[fd];
+}
+
+// 收发数据时调用，只写一个时间戳；没有监视的 fd 忽略，也不计入 touched
+static inline void
+timer_idle_touch(timer_idle_table_t *t, int fd, uint32_t now) {
+    timer_idle_t *s = timer_idle_find(t, fd);
+    if (s) {
+        s->last_active = now;
+        t->stat.touched++;
+    }
+}
+
+// 定时器到期时调用：还要再等多少毫秒，0 表示已经空闲满 timeout（时间回绕安全）
+static inline uint32_t
+timer_idle_remain(const timer_idle_t *s, uint32_t now) {
+    uint32_t idle = now - s->last_active;
+    return idle >= s->timeout ? 0 : s->timeout - idle;
+}
+
+#endif // MARK_TIMER_IDLE_H
@@ -0,0 +1,66 @@
+#ifndef MARK_TIMER_PROBE_H
+#define MARK_TIMER_PROBE_H
+
+/*
+ * USDT 静态探针，provider 为 timer，线上不用重新编译、不用停进程就能用 perf / bpftrace 看定时器：
+ *   timer:add      (handle, deadline, now)    添加，deadline 和 now 同一时间基准（ms 或时间轮刻度）
+ *   timer:del      (handle, deadline)         取消（包括 cancel_group 逐个取消）
+ *   timer:fire     (handle, deadline, lag)    触发或被 expire_into 取出，lag = 实际处理时间 - deadline
+ *   timer:cascade  (level, slot, count)       时间轮高层槽位下移，count 为搬动的节点个数
+ * 探针点编译成一条 nop，没有挂上时只多了准备参数的几条指令，参数都是手头已有的值，不额外读时钟。
+ * 没有 sys/sdt.h（systemtap-sdt-dev / systemtap-sdt-devel）或定义了 TIMER_NO_PROBES 时全部展开为空。
+ * 定义 TIMER_TRACE 时探针点同时录制定时器操作（timer_trace.h），cascade 不录制。
+ *
+ *   readelf -n ./mh | grep -A2 stapsdt        # 列出探针
+ *   bpftrace -p $(pidof mh) ../probes/timer-lag.bt
+ */
+
+#include <stdint.h>
+
+#if !defined(TIMER_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TIMER_HAVE_PROBES 1
+#endif
+#endif
+
+#ifdef TIMER_HAVE_PROBES
+#define TIMER_USDT_ADD(handle, deadline, now) \
+    DTRACE_PROBE3(timer, add, (uint64_t)(handle), (int64_t)(deadline), (int64_t)(now))
+#define TIMER_USDT_DEL(handle, deadline) \
+    DTRACE_PROBE2(timer, del, (uint64_t)(handle), (int64_t)(deadline))
+#define TIMER_USDT_FIRE(handle, deadline, lag) \
+    DTRACE_PROBE3(timer, fire, (uint64_t)(handle), (int64_t)(deadline), (int64_t)(lag))
+#define TIMER_USDT_CASCADE(level, slot, count) \
+    DTRACE_PROBE3(timer, cascade, (int)(level), (int)(slot), (uint32_t)(count))
+#else
+// 参数仍然求值一次（都是没有副作用的表达式），避免只给探针用的变量报 unused 警告
+#define TIMER_USDT_ADD(handle, deadline, now)  ((void)(handle), (void)(deadline), (void)(now))
+#define TIMER_USDT_DEL(handle, deadline)       ((void)(handle), (void)(deadline))
+#define TIMER_USDT_FIRE(handle, deadline, lag) ((void)(handle), (void)(deadline), (void)(lag))
+#define TIMER_USDT_CASCADE(level, slot, count) ((void)(level), (void)(slot), (void)(count))
+#endif
+
+// 定义了 TIMER_TRACE 时，同一批探针点顺带写录制文件，见 timer_trace.h
+#ifdef TIMER_TRACE
+#include "timer_trace.h"
+#define TIMER_TRACE_HOOK(op, handle, timeout) timer_trace_record(op, (uint64_t)(handle), (uint32_t)(timeout))
+#else
+#define TIMER_TRACE_HOOK(op, handle, timeout) ((void)0)
+#endif
+
+#define TIMER_PROBE_ADD(handle, deadline, now) do { \
+    TIMER_USDT_ADD(handle, deadline, now); \
+    TIMER_TRACE_HOOK(TIMER_TRACE_ADD, handle, (deadline) - (now)); \
+} while (0)
+#define TIMER_PROBE_DEL(handle, deadline) do { \
+    TIMER_USDT_DEL(handle, deadline); \
+    TIMER_TRACE_HOOK(TIMER_TRACE_DEL, handle, 0); \
+} while (0)
+#define TIMER_PROBE_FIRE(handle, deadline, lag) do { \
+    TIMER_USDT_FIRE(handle, deadline, lag); \
+    TIMER_TRACE_HOOK(TIMER_TRACE_FIRE, handle, 0); \
+} while (0)
+#define TIMER_PROBE_CASCADE(level, slot, count) TIMER_USDT_CASCADE(level, slot, count)
+
+#endif // MARK_TIMER_PROBE_H
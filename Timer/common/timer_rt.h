@@ -0,0 +1,89 @@
+#ifndef MARK_TIMER_RT_H
+#define MARK_TIMER_RT_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+/*
+ * 低延迟模式的辅助函数（Linux）：
+ *   - timer_rt_pin / timer_rt_fifo：驱动线程绑核、切到 SCHED_FIFO（没有权限时返回 -1，照常运行）；
+ *   - timer_rt_lock_memory：mlockall 并预先触碰一段栈，运行期不再缺页；
+ *   - timer_rt_wait_until：先 clock_nanosleep 睡到截止时间前 spin_ns，最后一段忙等，
+ *     绕开 epoll_wait 毫秒级超时和调度唤醒的抖动。
+ */
+
+#define TIMER_RT_SPIN_NS      50000   // 默认最后 50us 忙等
+#define TIMER_RT_STACK_PREFAULT (256 * 1024)
+
+// 低延迟模式中没能生效的项
+#define TIMER_RT_NO_MLOCK 0x1
+#define TIMER_RT_NO_PIN   0x2
+#define TIMER_RT_NO_FIFO  0x4
+
+static inline uint64_t
+timer_rt_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline int
+timer_rt_pin(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+}
+
+static inline int
+timer_rt_fifo(int prio) {
+    struct sched_param sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = prio;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0 ? 0 : -1;
+}
+
+static inline void
+timer_rt_prefault_stack() {
+    volatile unsigned char buf[TIMER_RT_STACK_PREFAULT];
+    size_t i;
+    for (i = 0; i < sizeof(buf); i += 4096) {
+        buf[i] = 0;
+    }
+}
+
+static inline int
+timer_rt_lock_memory() {
+    int ret = mlockall(MCL_CURRENT | MCL_FUTURE);
+    timer_rt_prefault_stack();
+    return ret == 0 ? 0 : -1;
+}
+
+// 等到单调时钟到达 deadline_ns
+static inline void
+timer_rt_wait_until(uint64_t deadline_ns, uint64_t spin_ns) {
+    uint64_t now = timer_rt_now_ns();
+    if (deadline_ns > now + spin_ns) {
+        uint64_t wake = deadline_ns - spin_ns;
+        struct timespec ts;
+        ts.tv_sec = wake / 1000000000ull;
+        ts.tv_nsec = wake % 1000000000ull;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+    }
+    while (timer_rt_now_ns() < deadline_ns) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+#endif // MARK_TIMER_RT_H
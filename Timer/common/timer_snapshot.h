@@ -0,0 +1,156 @@
+#ifndef MARK_TIMER_SNAPSHOT_H
+#define MARK_TIMER_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * 定时器快照：头部 + 定长记录数组，整个文件 mmap 读写，没有逐条的序列化开销。
+ * 记录保存的是剩余毫秒数而不是单调时钟读数（重启后单调时钟没有可比性），
+ * 头部记下保存时的墙上时间，恢复时再扣掉停机期间流逝的时间，挂到新的单调时钟上。
+ */
+
+#define TIMER_SNAPSHOT_MAGIC   0x4e534d54u  // "TMSN"
+#define TIMER_SNAPSHOT_VERSION 1
+#define TIMER_SNAPSHOT_SORTED  0x1          // 记录已按剩余时间升序排列
+
+typedef struct timer_snapshot_hdr_s {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t entry_size;
+    uint64_t count;
+    uint64_t saved_wall;    // 保存时的 CLOCK_REALTIME 毫秒数
+} timer_snapshot_hdr_t;
+
+typedef struct timer_snapshot_entry_s {
+    int64_t  remain;        // 保存时距离到期的毫秒数，已到期的记为 0
+    uint64_t handle;
+    uint64_t payload;
+} timer_snapshot_entry_t;
+
+typedef struct timer_snapshot_s {
+    timer_snapshot_hdr_t *hdr;
+    timer_snapshot_entry_t *e;
+    size_t size;
+    char tmp[256];          // 写入时先写临时文件，关闭时 rename，避免留下半个快照
+    const char *path;
+} timer_snapshot_t;
+
+static inline uint64_t
+timer_snapshot_wall_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 映射后关闭 fd，失败时也关闭
+static inline int
+timer_snapshot_map(timer_snapshot_t *s, int fd, int prot) {
+    void *p = mmap(NULL, s->size, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+    s->hdr = (timer_snapshot_hdr_t *)p;
+    s->e = (timer_snapshot_entry_t *)(s->hdr + 1);
+    return 0;
+}
+
+// 创建可容纳 count 条记录的快照，填完 s->e[0..count) 后调用 timer_snapshot_close
+static inline int
+timer_snapshot_create(timer_snapshot_t *s, const char *path, uint64_t count, uint32_t flags) {
+    memset(s, 0, sizeof(*s));
+    snprintf(s->tmp, sizeof(s->tmp), "%s.tmp", path);
+    s->path = path;
+    s->size = sizeof(timer_snapshot_hdr_t) + count * sizeof(timer_snapshot_entry_t);
+    int fd = open(s->tmp, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, s->size) < 0) {
+        close(fd);
+        unlink(s->tmp);
+        return -1;
+    }
+    // timer_snapshot_map 无论成败都会关闭 fd
+    if (timer_snapshot_map(s, fd, PROT_READ | PROT_WRITE) < 0) {
+        unlink(s->tmp);
+        return -1;
+    }
+    s->hdr->magic = TIMER_SNAPSHOT_MAGIC;
+    s->hdr->version = TIMER_SNAPSHOT_VERSION;
+    s->hdr->flags = flags;
+    s->hdr->entry_size = sizeof(timer_snapshot_entry_t);
+    s->hdr->count = count;
+    s->hdr->saved_wall = timer_snapshot_wall_ms();
+    return 0;
+}
+
+// 只读打开快照，校验失败返回 -1
+static inline int
+timer_snapshot_open(timer_snapshot_t *s, const char *path) {
+    struct stat st;
+    memset(s, 0, sizeof(*s));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(timer_snapshot_hdr_t)) {
+        close(fd);
+        return -1;
+    }
+    s->size = st.st_size;
+    if (timer_snapshot_map(s, fd, PROT_READ) < 0) {
+        return -1;
+    }
+    if (s->hdr->magic != TIMER_SNAPSHOT_MAGIC || s->hdr->version != TIMER_SNAPSHOT_VERSION
+        || s->hdr->entry_size != sizeof(timer_snapshot_entry_t)
+        || s->hdr->count > (s->size - sizeof(timer_snapshot_hdr_t)) / sizeof(timer_snapshot_entry_t)) {
+        munmap(s->hdr, s->size);
+        return -1;
+    }
+    // 顺序读取，让内核提前预读
+    madvise(s->hdr, s->size, MADV_SEQUENTIAL | MADV_WILLNEED);
+    return 0;
+}
+
+// 停机期间流逝的毫秒数，墙上时间被往回调时按 0 处理
+static inline int64_t
+timer_snapshot_elapsed(const timer_snapshot_t *s) {
+    int64_t d = (int64_t)(timer_snapshot_wall_ms() - s->hdr->saved_wall);
+    return d > 0 ? d : 0;
+}
+
+// 把一条记录挂到新的单调时钟 now 上
+static inline uint32_t
+timer_snapshot_rebase(const timer_snapshot_entry_t *e, int64_t elapsed, uint32_t now) {
+    int64_t remain = e->remain - elapsed;
+    return now + (uint32_t)(remain > 0 ? remain : 0);
+}
+
+// 写入的快照在这里落盘并替换旧文件，返回 -1 表示落盘失败
+static inline int
+timer_snapshot_close(timer_snapshot_t *s) {
+    int ret = 0;
+    if (s->path) {
+        ret = msync(s->hdr, s->size, MS_SYNC);
+    }
+    munmap(s->hdr, s->size);
+    if (s->path) {
+        if (ret == 0) {
+            ret = rename(s->tmp, s->path);
+        } else {
+            unlink(s->tmp);
+        }
+    }
+    return ret;
+}
+
+#endif // MARK_TIMER_SNAPSHOT_H
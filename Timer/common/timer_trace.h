@@ -0,0 +1,176 @@
+#ifndef MARK_TIMER_TRACE_H
+#define MARK_TIMER_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * 定时器操作录制：16 字节头部 + 16 字节定长记录，按发生顺序追加。
+ * 记录的是相对第一条记录的毫秒数、操作类型、句柄和超时时间（只有 ADD 有），
+ * 回放时在模拟时间里驱动任意实现，见 replay/trace-replay.cc。
+ *
+ * 编译时定义 TIMER_TRACE，timer_probe.h 的探针点会同时写录制文件，各实现不用改代码：
+ *   gcc -DTIMER_TRACE mh-timer.c minheap.c -o mh -I./ -I../common
+ *   TIMER_TRACE_FILE=/tmp/mh.trace ./mh
+ * 文件在第一次记录时打开（默认 timer.trace），进程退出时刷盘；进程被杀掉时
+ * 最多丢掉 stdio 缓冲里的一段，回放按文件长度计算条数，不依赖头部。
+ */
+
+#define TIMER_TRACE_MAGIC   0x52544d54u  // "TMTR"
+#define TIMER_TRACE_VERSION 1
+
+#define TIMER_TRACE_ADD  0
+#define TIMER_TRACE_DEL  1
+#define TIMER_TRACE_FIRE 2
+
+#define TIMER_TRACE_TS_MASK 0x3fffffffu  // 低 30 位是毫秒数，够录 12 天
+
+typedef struct timer_trace_hdr_s {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rec_size;
+    uint64_t start_ms;      // 第一条记录时的 CLOCK_MONOTONIC 毫秒数
+} timer_trace_hdr_t;
+
+typedef struct timer_trace_rec_s {
+    uint32_t ts_op;         // 高 2 位操作类型，低 30 位相对时间（ms）
+    uint32_t timeout;       // ADD 的超时（ms），其余为 0
+    uint64_t handle;        // 录制时实现返回的句柄，回放时只用来对应 ADD / DEL / FIRE
+} timer_trace_rec_t;
+
+#define timer_trace_op(r) ((r)->ts_op >> 30)
+#define timer_trace_ts(r) ((r)->ts_op & TIMER_TRACE_TS_MASK)
+
+/* ---------------- 录制 ---------------- */
+
+typedef struct timer_trace_writer_s {
+    FILE *fp;
+    uint64_t start_ms;
+    int failed;             // 打开失败后不再重试
+    int registered;         // 已注册 atexit
+    char lock;              // 时间轮可以多线程添加，记录时用 __atomic 自旋
+} timer_trace_writer_t;
+
+static timer_trace_writer_t timer_trace_w;
+
+static inline uint64_t
+timer_trace_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline void
+timer_trace_close() {
+    timer_trace_writer_t *w = &timer_trace_w;
+    if (w->fp) {
+        fclose(w->fp);
+        w->fp = NULL;
+    }
+}
+
+// 显式指定文件；不调用时第一次记录按 TIMER_TRACE_FILE 环境变量打开
+static inline int
+timer_trace_open(const char *path) {
+    timer_trace_writer_t *w = &timer_trace_w;
+    timer_trace_hdr_t hdr;
+    timer_trace_close();
+    w->fp = fopen(path, "wb");
+    if (!w->fp) {
+        w->failed = 1;
+        return -1;
+    }
+    setvbuf(w->fp, NULL, _IOFBF, 1 << 20);
+    w->start_ms = timer_trace_now_ms();
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TIMER_TRACE_MAGIC;
+    hdr.version = TIMER_TRACE_VERSION;
+    hdr.rec_size = sizeof(timer_trace_rec_t);
+    hdr.start_ms = w->start_ms;
+    fwrite(&hdr, sizeof(hdr), 1, w->fp);
+    if (!w->registered) {
+        w->registered = 1;
+        atexit(timer_trace_close);
+    }
+    return 0;
+}
+
+// 按给定的相对时间写一条记录，合成录制文件时直接调用
+static inline void
+timer_trace_write(int op, uint32_t ts, uint64_t handle, uint32_t timeout) {
+    timer_trace_rec_t r;
+    r.ts_op = ((uint32_t)op << 30) | (ts & TIMER_TRACE_TS_MASK);
+    r.timeout = timeout;
+    r.handle = handle;
+    fwrite(&r, sizeof(r), 1, timer_trace_w.fp);
+}
+
+// 探针点调用：读时钟、加锁、追加一条记录
+static inline void
+timer_trace_record(int op, uint64_t handle, uint32_t timeout) {
+    timer_trace_writer_t *w = &timer_trace_w;
+    while (__atomic_test_and_set(&w->lock, __ATOMIC_ACQUIRE)) {
+    }
+    if (!w->fp && !w->failed) {
+        const char *path = getenv("TIMER_TRACE_FILE");
+        timer_trace_open(path ? path : "timer.trace");
+    }
+    if (w->fp) {
+        timer_trace_write(op, (uint32_t)(timer_trace_now_ms() - w->start_ms), handle, timeout);
+    }
+    __atomic_clear(&w->lock, __ATOMIC_RELEASE);
+}
+
+/* ---------------- 读取 ---------------- */
+
+typedef struct timer_trace_s {
+    const timer_trace_hdr_t *hdr;
+    const timer_trace_rec_t *r;
+    uint64_t count;
+    size_t size;
+} timer_trace_t;
+
+// 只读映射整个文件，校验失败返回 -1
+static inline int
+timer_trace_load(timer_trace_t *t, const char *path) {
+    struct stat st;
+    memset(t, 0, sizeof(*t));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(timer_trace_hdr_t)) {
+        close(fd);
+        return -1;
+    }
+    t->size = st.st_size;
+    void *p = mmap(NULL, t->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+    t->hdr = (const timer_trace_hdr_t *)p;
+    if (t->hdr->magic != TIMER_TRACE_MAGIC || t->hdr->version != TIMER_TRACE_VERSION
+        || t->hdr->rec_size != sizeof(timer_trace_rec_t)) {
+        munmap(p, t->size);
+        return -1;
+    }
+    t->r = (const timer_trace_rec_t *)(t->hdr + 1);
+    t->count = (t->size - sizeof(timer_trace_hdr_t)) / sizeof(timer_trace_rec_t);
+    madvise(p, t->size, MADV_SEQUENTIAL | MADV_WILLNEED);
+    return 0;
+}
+
+static inline void
+timer_trace_unload(timer_trace_t *t) {
+    munmap((void *)t->hdr, t->size);
+}
+
+#endif // MARK_TIMER_TRACE_H
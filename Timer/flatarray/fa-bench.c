@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "flatarray.h"
+#include "minheap.h"
+
+/*
+ * 经典 hold 模型：容器中保持 N 个定时器，每次取出最早的一个，再插入一个更晚的，
+ * 另外每 4 次操作随机取消并重新添加一个。对比扁平数组和 min_heap_t 的单次操作耗时，
+ * 找出两者的交叉点。
+ */
+
+#define OPS 2000000
+
+static double
+now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+bench_flat(unsigned n) {
+    flat_array_t s;
+    flat_entry_t *nodes = calloc(n, sizeof(*nodes));
+    unsigned i;
+    flat_ctor_(&s);
+    srand(n);
+    for (i = 0; i < n; i++) {
+        nodes[i].time = rand() % 1000;
+        flat_push_(&s, &nodes[i]);
+    }
+    double start = now_sec();
+    for (i = 0; i < OPS; i++) {
+        flat_entry_t *e = flat_top_(&s);
+        flat_erase_(&s, e);
+        e->time += 1 + rand() % 1000;
+        flat_push_(&s, e);
+        if ((i & 3) == 0) {
+            e = &nodes[rand() % n];
+            flat_erase_(&s, e);
+            e->time += rand() % 1000;
+            flat_push_(&s, e);
+        }
+    }
+    double cost = now_sec() - start;
+    flat_dtor_(&s);
+    free(nodes);
+    return cost * 1e9 / OPS;
+}
+
+static double
+bench_heap(unsigned n) {
+    min_heap_t s;
+    timer_entry_t *nodes = calloc(n, sizeof(*nodes));
+    unsigned i;
+    min_heap_ctor_(&s);
+    srand(n);
+    for (i = 0; i < n; i++) {
+        nodes[i].time = rand() % 1000;
+        min_heap_push_(&s, &nodes[i]);
+    }
+    double start = now_sec();
+    for (i = 0; i < OPS; i++) {
+        timer_entry_t *e = min_heap_pop_(&s);
+        e->time += 1 + rand() % 1000;
+        min_heap_push_(&s, e);
+        if ((i & 3) == 0) {
+            e = &nodes[rand() % n];
+            min_heap_erase_(&s, e);
+            e->time += rand() % 1000;
+            min_heap_push_(&s, e);
+        }
+    }
+    double cost = now_sec() - start;
+    min_heap_dtor_(&s);
+    free(nodes);
+    return cost * 1e9 / OPS;
+}
+
+int main() {
+    unsigned sizes[] = { 4, 8, 16, 32, 48, 64, 96, 128, 256, 512, 1024 };
+    unsigned i;
+#if defined(__AVX2__)
+    printf("flat array scan: AVX2\n");
+#elif defined(__SSE4_1__)
+    printf("flat array scan: SSE4.1\n");
+#else
+    printf("flat array scan: scalar\n");
+#endif
+    printf("%8s %14s %14s\n", "N", "flat ns/op", "minheap ns/op");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        printf("%8u %14.1f %14.1f\n", sizes[i], bench_flat(sizes[i]), bench_heap(sizes[i]));
+    }
+    return 0;
+}
+
+// gcc -O2 -mavx2 fa-bench.c flatarray.c ../minheap/minheap.c -o fa-bench -I./ -I../minheap
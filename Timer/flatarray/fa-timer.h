@@ -0,0 +1,136 @@
+#ifndef MARK_FLATARRAY_TIMER_H
+#define MARK_FLATARRAY_TIMER_H
+
+#if defined(__APPLE__)
+#include <AvailabilityMacros.h>
+#include <sys/time.h>
+#include <mach/task.h>
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "flatarray.h"
+#include "timer_handle.h"
+#include "timer_probe.h"
+#include "timer_expired.h"
+
+typedef flat_entry_t timer_entry_t;
+typedef flat_handler_pt timer_handler_pt;
+
+static flat_array_t flat_array;
+static handle_table_t handles;
+
+static uint32_t
+current_time() {
+	uint32_t t;
+#if !defined(__APPLE__) || defined(AVAILABLE_MAC_OS_X_VERSION_10_12_AND_LATER)
+	struct timespec ti;
+	clock_gettime(CLOCK_MONOTONIC, &ti);
+	t = (uint32_t)ti.tv_sec * 1000;
+	t += ti.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	t = (uint32_t)tv.tv_sec * 1000;
+	t += tv.tv_usec / 1000;
+#endif
+	return t;
+}
+
+void init_timer(){
+    flat_ctor_(&flat_array);
+    handle_table_init(&handles);
+}
+
+timer_handle_t add_timer(uint32_t msec, timer_handler_pt callback) {
+    timer_entry_t *te = (timer_entry_t *)malloc(sizeof(*te));
+    if (!te) {
+        return TIMER_HANDLE_INVALID;
+    }
+    memset(te, 0, sizeof(timer_entry_t));
+
+    te->handler = callback;
+    te->handle = handle_alloc(&handles, te);
+    if (te->handle == TIMER_HANDLE_INVALID) {
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
+    te->time = current_time() + msec;
+
+    if (0 != flat_push_(&flat_array, te)) {
+        handle_release(&handles, te->handle);
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
+    TIMER_PROBE_ADD(te->handle, te->time, te->time - msec);
+    printf("add timer time = %u now = %u\n", te->time, current_time());
+    return te->handle;
+}
+
+// 句柄已失效（已触发或已取消）时直接返回 false
+bool del_timer(timer_handle_t h) {
+    timer_entry_t *e = (timer_entry_t *)handle_release(&handles, h);
+    if (!e) {
+        return false;
+    }
+    TIMER_PROBE_DEL(h, e->time);
+    flat_erase_(&flat_array, e);
+    free(e);
+    return true;
+}
+
+int find_nearest_expire_timer() {
+    timer_entry_t *te = flat_top_(&flat_array);
+    if (!te) return -1;
+    int diff = (int) te->time - (int)current_time();
+    return diff > 0 ? diff : 0;
+}
+
+void expire_timer() {
+    timer_entry_t *batch[64];
+    uint32_t cur = current_time();
+    int n, i;
+    // 一次比较扫描取出一批到期项，再按到期顺序回调
+    while ((n = flat_pop_expired_(&flat_array, cur, batch, 64)) > 0) {
+        for (i = 0; i < n; i++) {
+            handle_release(&handles, batch[i]->handle);
+        }
+        for (i = 0; i < n; i++) {
+            TIMER_PROBE_FIRE(batch[i]->handle, batch[i]->time, (int32_t)(cur - batch[i]->time));
+            if (batch[i]->handler) {
+                batch[i]->handler(batch[i]);
+            }
+            free(batch[i]);
+        }
+    }
+}
+
+// 不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+// 和 add_timer / del_timer 在同一个线程调用，跨线程取需要调用者自己加锁
+unsigned expire_into(timer_expired_t *out, unsigned max, uint32_t now) {
+    timer_entry_t *batch[64];
+    unsigned n = 0;
+    int k, i;
+    // 取满 max 为止，每次扫描最多取 64 个，flat_pop_expired_ 保证取的是最早的那些
+    while (n < max && (k = flat_pop_expired_(&flat_array, now, batch,
+            max - n < 64 ? (int)(max - n) : 64)) > 0) {
+        for (i = 0; i < k; i++) {
+            handle_release(&handles, batch[i]->handle);
+            TIMER_PROBE_FIRE(batch[i]->handle, batch[i]->time, (int32_t)(now - batch[i]->time));
+            out[n].handle = batch[i]->handle;
+            out[n].expire = batch[i]->time;
+            free(batch[i]);
+            n++;
+        }
+    }
+    return n;
+}
+
+#endif
\ No newline at end of file
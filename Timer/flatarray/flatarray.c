@@ -0,0 +1,199 @@
+#include <string.h>
+#include "flatarray.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#define flat_round_up(n) (((n) + FLAT_LANES - 1) & ~(FLAT_LANES - 1))
+
+void flat_ctor_(flat_array_t* s) { s->expire = 0; s->e = 0; s->n = 0; s->a = 0; }
+void flat_dtor_(flat_array_t* s) { if (s->expire) free(s->expire); if (s->e) free(s->e); }
+void flat_elem_init_(flat_entry_t* e) { e->flat_idx = -1; }
+int flat_empty_(flat_array_t* s) { return 0u == s->n; }
+unsigned flat_size_(flat_array_t* s) { return s->n; }
+
+int flat_reserve_(flat_array_t* s, unsigned n)
+{
+    if (s->a < n)
+    {
+        uint32_t *expire;
+        flat_entry_t **e;
+        unsigned a = s->a ? s->a * 2 : FLAT_LANES * 4;
+        if (a < n)
+            a = flat_round_up(n);
+        // realloc 不保证对齐，只能重新分配再拷贝
+        if (posix_memalign((void **)&expire, FLAT_ALIGN, a * sizeof *expire))
+            return -1;
+        if (!(e = (flat_entry_t**)realloc(s->e, a * sizeof *e))) {
+            free(expire);
+            return -1;
+        }
+        if (s->n)
+            memcpy(expire, s->expire, s->n * sizeof *expire);
+        memset(expire + s->n, 0xff, (a - s->n) * sizeof *expire);
+        free(s->expire);
+        s->expire = expire;
+        s->e = e;
+        s->a = a;
+    }
+    return 0;
+}
+
+int flat_push_(flat_array_t* s, flat_entry_t* e)
+{
+    if (flat_reserve_(s, s->n + 1))
+        return -1;
+    s->expire[s->n] = e->time;
+    s->e[s->n] = e;
+    e->flat_idx = s->n++;
+    return 0;
+}
+
+static void flat_remove_at_(flat_array_t* s, uint32_t idx)
+{
+    uint32_t last = --s->n;
+    s->e[idx]->flat_idx = -1;
+    if (idx != last) {
+        s->expire[idx] = s->expire[last];
+        (s->e[idx] = s->e[last])->flat_idx = idx;
+    }
+    s->expire[last] = UINT32_MAX;
+}
+
+int flat_erase_(flat_array_t* s, flat_entry_t* e)
+{
+    if (e->flat_idx == (uint32_t)-1)
+        return -1;
+    flat_remove_at_(s, e->flat_idx);
+    return 0;
+}
+
+// 最小到期时间所在的下标，数组为空时结果无意义
+static uint32_t flat_min_index_(const flat_array_t* s)
+{
+    const uint32_t *a = s->expire;
+    uint32_t n = flat_round_up(s->n), i, min;
+#if defined(__AVX2__)
+    __m256i m = _mm256_set1_epi32(-1);
+    for (i = 0; i < n; i += 8)
+        m = _mm256_min_epu32(m, _mm256_load_si256((const __m256i *)(a + i)));
+    __m128i x = _mm_min_epu32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+    x = _mm_min_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_min_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    min = (uint32_t)_mm_cvtsi128_si32(x);
+    __m256i v = _mm256_set1_epi32((int)min);
+    for (i = 0; i < n; i += 8) {
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+            _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *)(a + i)), v)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return 0;
+#elif defined(__SSE4_1__)
+    __m128i m = _mm_set1_epi32(-1);
+    for (i = 0; i < n; i += 4)
+        m = _mm_min_epu32(m, _mm_load_si128((const __m128i *)(a + i)));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    min = (uint32_t)_mm_cvtsi128_si32(m);
+    __m128i v = _mm_set1_epi32((int)min);
+    for (i = 0; i < n; i += 4) {
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(
+            _mm_cmpeq_epi32(_mm_load_si128((const __m128i *)(a + i)), v)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return 0;
+#else
+    uint32_t idx = 0;
+    (void)n;
+    min = a[0];
+    for (i = 1; i < s->n; i++) {
+        if (a[i] < min) {
+            min = a[i];
+            idx = i;
+        }
+    }
+    return idx;
+#endif
+}
+
+// 把 [i, i+8) 中 time <= now 的位置作为位掩码返回
+static inline unsigned flat_expired_mask_(const uint32_t *a, uint32_t i, uint32_t now)
+{
+#if defined(__AVX2__)
+    __m256i d = _mm256_load_si256((const __m256i *)(a + i));
+    __m256i le = _mm256_cmpeq_epi32(_mm256_min_epu32(d, _mm256_set1_epi32((int)now)), d);
+    return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(le));
+#elif defined(__SSE4_1__)
+    __m128i vn = _mm_set1_epi32((int)now);
+    __m128i d0 = _mm_load_si128((const __m128i *)(a + i));
+    __m128i d1 = _mm_load_si128((const __m128i *)(a + i + 4));
+    unsigned lo = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_min_epu32(d0, vn), d0)));
+    unsigned hi = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_min_epu32(d1, vn), d1)));
+    return lo | (hi << 4);
+#else
+    unsigned mask = 0, j;
+    for (j = 0; j < FLAT_LANES; j++)
+        mask |= (unsigned)(a[i + j] <= now) << j;
+    return mask;
+#endif
+}
+
+// [i, i+8) 中下标小于 s->n 的位置；补齐的位置是 UINT32_MAX，now == UINT32_MAX（毫秒时钟回绕前的那 1ms）时也会被算成到期
+static inline unsigned flat_live_mask_(const flat_array_t* s, uint32_t i)
+{
+    return s->n - i >= FLAT_LANES ? (1u << FLAT_LANES) - 1 : (1u << (s->n - i)) - 1;
+}
+
+flat_entry_t* flat_top_(flat_array_t* s)
+{
+    return s->n ? s->e[flat_min_index_(s)] : 0;
+}
+
+int flat_pop_expired_(flat_array_t* s, uint32_t now, flat_entry_t** out, int max)
+{
+    uint32_t n = flat_round_up(s->n), i, count = 0;
+    int k, j;
+
+    if (!s->n || max <= 0)
+        return 0;
+    for (i = 0; i < n; i += FLAT_LANES)
+        count += __builtin_popcount(flat_expired_mask_(s->expire, i, now) & flat_live_mask_(s, i));
+    if (!count)
+        return 0;
+
+    if (count > (uint32_t)max) {
+        // 到期的比 max 多，只取最早的 max 个
+        for (k = 0; k < max; k++) {
+            uint32_t idx = flat_min_index_(s);
+            out[k] = s->e[idx];
+            flat_remove_at_(s, idx);
+        }
+        return max;
+    }
+
+    // 一次扫描收集全部到期项；按下标从大到小删除，交换进来的尾部元素不会是未处理的到期项
+    k = 0;
+    for (i = 0; i < n; i += FLAT_LANES) {
+        unsigned mask = flat_expired_mask_(s->expire, i, now) & flat_live_mask_(s, i);
+        while (mask) {
+            out[k++] = s->e[i + __builtin_ctz(mask)];
+            mask &= mask - 1;
+        }
+    }
+    for (j = k - 1; j >= 0; j--)
+        flat_remove_at_(s, out[j]->flat_idx);
+    // 数量很少，插入排序恢复到期顺序
+    for (j = 1; j < k; j++) {
+        flat_entry_t *e = out[j];
+        int h = j - 1;
+        while (h >= 0 && out[h]->time > e->time) {
+            out[h + 1] = out[h];
+            h--;
+        }
+        out[h + 1] = e;
+    }
+    return k;
+}
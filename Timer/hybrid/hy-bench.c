@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "hybrid.h"
+#include "minheap.h"
+
+/*
+ * 双峰负载对比：大量 50~500ms 的短定时器（95% 在到期前被取消）
+ * 加少量 30 秒~60 分钟的长定时器（到期后重新添加），模拟时间驱动，逐毫秒推进。
+ * 分别跑混合结构、纯红黑树、纯最小堆，输出总耗时。
+ */
+
+#define SHORT_PER_MS   200
+#define LONG_TIMERS    100000
+#define SIM_MS         60000
+#define CANCEL_RING    512
+
+typedef struct bench_ops_s {
+    const char *name;
+    void  (*init)(uint32_t now);
+    void *(*add)(uint32_t expire, int id);
+    void  (*del)(void *node);
+    int   (*pop)(uint32_t now);          // 返回到期定时器的 id，没有返回 -1
+} bench_ops_t;
+
+/* ---------------- 混合结构 ---------------- */
+typedef struct { hybrid_node_t node; int id; } hy_item_t;
+static hybrid_t hy;
+static void hy_init(uint32_t now) { hybrid_init(&hy, now); }
+static void *hy_add(uint32_t expire, int id) {
+    hy_item_t *it = malloc(sizeof(*it));
+    it->id = id;
+    hybrid_add(&hy, &it->node, expire);
+    return it;
+}
+static void hy_del(void *p) { hybrid_del(&hy, &((hy_item_t *)p)->node); free(p); }
+static int hy_pop(uint32_t now) {
+    hybrid_node_t *n = hybrid_pop_expired(&hy, now);
+    if (!n) return -1;
+    int id = ((hy_item_t *)n)->id;
+    free(n);
+    return id;
+}
+
+/* ---------------- 纯红黑树 ---------------- */
+typedef struct { ngx_rbtree_node_t node; int id; } rb_item_t;
+static ngx_rbtree_t rb;
+static ngx_rbtree_node_t rb_sentinel;
+static void rb_init(uint32_t now) { ngx_rbtree_init(&rb, &rb_sentinel, ngx_rbtree_insert_timer_value); }
+static void *rb_add(uint32_t expire, int id) {
+    rb_item_t *it = malloc(sizeof(*it));
+    it->id = id;
+    it->node.key = expire;
+    ngx_rbtree_insert(&rb, &it->node);
+    return it;
+}
+static void rb_del(void *p) { ngx_rbtree_delete(&rb, &((rb_item_t *)p)->node); free(p); }
+static int rb_pop(uint32_t now) {
+    if (rb.root == rb.sentinel) return -1;
+    ngx_rbtree_node_t *n = ngx_rbtree_min(rb.root, rb.sentinel);
+    if ((int32_t)(n->key - now) > 0) return -1;
+    ngx_rbtree_delete(&rb, n);
+    int id = ((rb_item_t *)n)->id;
+    free(n);
+    return id;
+}
+
+/* ---------------- 纯最小堆 ---------------- */
+static min_heap_t mh;
+static void mh_init(uint32_t now) { min_heap_ctor_(&mh); }
+static void *mh_add(uint32_t expire, int id) {
+    timer_entry_t *te = malloc(sizeof(*te));
+    te->time = expire;
+    te->privdata = (void *)(intptr_t)id;
+    min_heap_push_(&mh, te);
+    return te;
+}
+static void mh_del(void *p) { min_heap_erase_(&mh, p); free(p); }
+static int mh_pop(uint32_t now) {
+    timer_entry_t *te = min_heap_top_(&mh);
+    if (!te || te->time > now) return -1;
+    min_heap_pop_(&mh);
+    int id = (int)(intptr_t)te->privdata;
+    free(te);
+    return id;
+}
+
+static const bench_ops_t backends[] = {
+    { "hybrid",  hy_init, hy_add, hy_del, hy_pop },
+    { "rbtree",  rb_init, rb_add, rb_del, rb_pop },
+    { "minheap", mh_init, mh_add, mh_del, mh_pop },
+};
+
+/* ---------------- 负载 ---------------- */
+#define SHORT_IDS (SHORT_PER_MS * CANCEL_RING)
+#define LONG_ID   SHORT_IDS
+
+static void *short_nodes[SHORT_IDS];
+static int cancel_ring[CANCEL_RING][SHORT_PER_MS * 4];
+static int cancel_cnt[CANCEL_RING];
+
+static double
+now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+run(const bench_ops_t *ops) {
+    uint32_t now = 1000;  // 模拟时间（ms）
+    uint64_t fired = 0, cancelled = 0;
+    int i, next_id = 0;
+
+    srand(12345);
+    memset(short_nodes, 0, sizeof(short_nodes));
+    memset(cancel_cnt, 0, sizeof(cancel_cnt));
+    ops->init(now);
+    for (i = 0; i < LONG_TIMERS; i++) {
+        ops->add(now + 30000 + rand() % 3570000, LONG_ID);
+    }
+
+    double start = now_sec();
+    for (; now < 1000 + SIM_MS; now++) {
+        // 到了取消时刻的短定时器
+        int slot = now % CANCEL_RING;
+        for (i = 0; i < cancel_cnt[slot]; i++) {
+            int id = cancel_ring[slot][i];
+            if (short_nodes[id]) {
+                ops->del(short_nodes[id]);
+                short_nodes[id] = NULL;
+                cancelled++;
+            }
+        }
+        cancel_cnt[slot] = 0;
+        // 新的短定时器，95% 会在 1~49ms 后取消
+        for (i = 0; i < SHORT_PER_MS; i++) {
+            int id = next_id;
+            next_id = (next_id + 1) % SHORT_IDS;
+            if (short_nodes[id]) {
+                ops->del(short_nodes[id]);
+                cancelled++;
+            }
+            short_nodes[id] = ops->add(now + 50 + rand() % 450, id);
+            if (rand() % 100 < 95) {
+                int cslot = (now + 1 + rand() % 49) % CANCEL_RING;
+                cancel_ring[cslot][cancel_cnt[cslot]++] = id;
+            }
+        }
+        int id;
+        while ((id = ops->pop(now)) != -1) {
+            fired++;
+            if (id != LONG_ID) {
+                short_nodes[id] = NULL;
+            } else {
+                ops->add(now + 30000 + rand() % 3570000, LONG_ID);
+            }
+        }
+    }
+    double cost = now_sec() - start;
+    printf("%-8s %8.3f s  fired = %llu cancelled = %llu  %.1f ns/op\n", ops->name, cost,
+        (unsigned long long)fired, (unsigned long long)cancelled,
+        cost * 1e9 / ((double)SIM_MS * SHORT_PER_MS * 2));
+}
+
+int main() {
+    size_t i;
+    for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        run(&backends[i]);
+    }
+    printf("hybrid migrated = %llu\n", (unsigned long long)hy.migrated);
+    return 0;
+}
+
+// gcc -O2 hy-bench.c hybrid.c ../rbtree/rbtree.c ../minheap/minheap.c -o hy-bench -I./ -I../rbtree -I../minheap -I../common
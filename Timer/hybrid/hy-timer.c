@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <sys/epoll.h>
+#include "hy-timer.h"
+
+void hello_world(timer_entry_t *te) {
+    printf("hello world time = %u\n", te->expire);
+}
+
+int main() {
+    init_timer();
+
+    add_timer(200, hello_world);
+    add_timer(1000, hello_world);
+    add_timer(3000, hello_world);  // 远层，接近到期时迁移到时间轮
+    timer_handle_t h = add_timer(2500, hello_world);
+    del_timer(h);
+    del_timer(h);  // 句柄已失效，重复取消是空操作
+
+    int epfd = epoll_create(1);
+    struct epoll_event events[512];
+
+    for (;;) {
+        int nearest = find_nearest_expire_timer();
+        int n = epoll_wait(epfd, events, 512, nearest);
+        for (int i=0; i < n; i++) {
+            //
+        }
+        expire_timer();
+    }
+    return 0;
+}
+
+// gcc hy-timer.c hybrid.c ../rbtree/rbtree.c -o hy -I./ -I../rbtree -I../common
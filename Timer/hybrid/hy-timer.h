@@ -0,0 +1,120 @@
+#ifndef MARK_HYBRID_TIMER_H
+#define MARK_HYBRID_TIMER_H
+
+#if defined(__APPLE__)
+#include <AvailabilityMacros.h>
+#include <sys/time.h>
+#include <mach/task.h>
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hybrid.h"
+#include "timer_handle.h"
+#include "timer_probe.h"
+#include "timer_expired.h"
+
+typedef hybrid_node_t timer_entry_t;
+typedef hybrid_handler_pt timer_handler_pt;
+
+static hybrid_t hybrid;
+static handle_table_t handles;
+
+static uint32_t
+current_time() {
+	uint32_t t;
+#if !defined(__APPLE__) || defined(AVAILABLE_MAC_OS_X_VERSION_10_12_AND_LATER)
+	struct timespec ti;
+	clock_gettime(CLOCK_MONOTONIC, &ti);
+	t = (uint32_t)ti.tv_sec * 1000;
+	t += ti.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	t = (uint32_t)tv.tv_sec * 1000;
+	t += tv.tv_usec / 1000;
+#endif
+	return t;
+}
+
+void init_timer() {
+    hybrid_init(&hybrid, current_time());
+    handle_table_init(&handles);
+}
+
+timer_handle_t add_timer(uint32_t msec, timer_handler_pt callback) {
+    timer_entry_t *te = (timer_entry_t *)malloc(sizeof(*te));
+    if (!te) {
+        return TIMER_HANDLE_INVALID;
+    }
+    memset(te, 0, sizeof(timer_entry_t));
+
+    te->handler = callback;
+    te->handle = handle_alloc(&handles, te);
+    if (te->handle == TIMER_HANDLE_INVALID) {
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
+    hybrid_add(&hybrid, te, current_time() + msec);
+    TIMER_PROBE_ADD(te->handle, te->expire, te->expire - msec);
+    printf("add timer time = %u now = %u tier = %s\n", te->expire, current_time(),
+        te->tier == HYBRID_TIER_NEAR ? "near" : "far");
+    return te->handle;
+}
+
+// 句柄已失效（已触发或已取消）时直接返回 false
+bool del_timer(timer_handle_t h) {
+    timer_entry_t *te = (timer_entry_t *)handle_release(&handles, h);
+    if (!te) {
+        return false;
+    }
+    TIMER_PROBE_DEL(h, te->expire);
+    hybrid_del(&hybrid, te);
+    free(te);
+    return true;
+}
+
+int find_nearest_expire_timer() {
+    uint32_t expire;
+    if (hybrid_nearest(&hybrid, &expire) < 0) return -1;
+    int diff = (int) expire - (int)current_time();
+    return diff > 0 ? diff : 0;
+}
+
+void expire_timer() {
+    timer_entry_t *te;
+    uint32_t now = current_time();
+    while ((te = hybrid_pop_expired(&hybrid, now)) != NULL) {
+        handle_release(&handles, te->handle);
+        TIMER_PROBE_FIRE(te->handle, te->expire, (int32_t)(now - te->expire));
+        if (te->handler) {
+            te->handler(te);
+        }
+        free(te);
+    }
+}
+
+// 不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+// 和 add_timer / del_timer 在同一个线程调用，跨线程取需要调用者自己加锁
+unsigned expire_into(timer_expired_t *out, unsigned max, uint32_t now) {
+    timer_entry_t *te;
+    unsigned n = 0;
+    while (n < max && (te = hybrid_pop_expired(&hybrid, now)) != NULL) {
+        handle_release(&handles, te->handle);
+        TIMER_PROBE_FIRE(te->handle, te->expire, (int32_t)(now - te->expire));
+        out[n].handle = te->handle;
+        out[n].expire = te->expire;
+        free(te);
+        n++;
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include <string.h>
+#include <stddef.h>
+#include "hybrid.h"
+#include "timer_probe.h"
+
+#define hybrid_node_of_link(l) \
+    ((hybrid_node_t *) ((char *) (l) - offsetof(hybrid_node_t, link)))
+#define hybrid_node_of_rbnode(n) \
+    ((hybrid_node_t *) ((char *) (n) - offsetof(hybrid_node_t, rbnode)))
+
+static void
+bitmap_set(hybrid_t *h, uint32_t slot) {
+    h->bitmap[slot >> 6] |= (uint64_t)1 << (slot & 63);
+}
+
+static void
+bitmap_clear(hybrid_t *h, uint32_t slot) {
+    h->bitmap[slot >> 6] &= ~((uint64_t)1 << (slot & 63));
+}
+
+// 从 slot 开始（含）环形查找下一个非空槽，返回距离，没有返回 -1
+static int
+bitmap_next(hybrid_t *h, uint32_t slot) {
+    uint32_t word = slot >> 6;
+    uint64_t bits = h->bitmap[word] & (~(uint64_t)0 << (slot & 63));
+    int i;
+    for (i = 0; i <= HYBRID_BITMAP_WORDS; i++) {
+        if (bits) {
+            uint32_t found = (word << 6) + __builtin_ctzll(bits);
+            return (int)((found - slot) & HYBRID_NEAR_MASK);
+        }
+        word = (word + 1) % HYBRID_BITMAP_WORDS;
+        bits = h->bitmap[word];
+    }
+    return -1;
+}
+
+static void
+near_link(hybrid_t *h, hybrid_node_t *node, uint32_t slot) {
+    hybrid_link_t *head = &h->near[slot];
+    node->link.prev = head->prev;
+    node->link.next = head;
+    head->prev->next = &node->link;
+    head->prev = &node->link;
+    node->tier = HYBRID_TIER_NEAR;
+    bitmap_set(h, slot);
+    h->near_count++;
+}
+
+static void
+near_unlink(hybrid_t *h, hybrid_node_t *node) {
+    hybrid_link_t *prev = node->link.prev, *next = node->link.next;
+    prev->next = next;
+    next->prev = prev;
+    // 前后都是槽位头，说明槽位已空
+    if (prev == next) {
+        bitmap_clear(h, (uint32_t)(prev - h->near));
+    }
+    node->link.prev = node->link.next = NULL;
+    node->tier = HYBRID_TIER_NONE;
+    h->near_count--;
+}
+
+static void
+near_add(hybrid_t *h, hybrid_node_t *node) {
+    // 已经过期的定时器放在当前刻度，下一次推进时立即触发
+    if ((int32_t)(node->expire - h->time) < 0) {
+        near_link(h, node, h->time & HYBRID_NEAR_MASK);
+    } else {
+        near_link(h, node, node->expire & HYBRID_NEAR_MASK);
+    }
+}
+
+void
+hybrid_init(hybrid_t *h, uint32_t now) {
+    int i;
+    memset(h, 0, sizeof(*h));
+    for (i = 0; i < HYBRID_NEAR; i++) {
+        h->near[i].prev = h->near[i].next = &h->near[i];
+    }
+    ngx_rbtree_init(&h->far, &h->sentinel, ngx_rbtree_insert_timer_value);
+    h->time = now;
+}
+
+void
+hybrid_add(hybrid_t *h, hybrid_node_t *node, uint32_t expire) {
+    node->expire = expire;
+    if ((int32_t)(expire - h->time) < HYBRID_NEAR) {
+        near_add(h, node);
+        return;
+    }
+    node->rbnode.key = expire;
+    ngx_rbtree_insert(&h->far, &node->rbnode);
+    node->tier = HYBRID_TIER_FAR;
+    h->far_count++;
+}
+
+void
+hybrid_del(hybrid_t *h, hybrid_node_t *node) {
+    if (node->tier == HYBRID_TIER_NEAR) {
+        near_unlink(h, node);
+    } else if (node->tier == HYBRID_TIER_FAR) {
+        ngx_rbtree_delete(&h->far, &node->rbnode);
+        node->tier = HYBRID_TIER_NONE;
+        h->far_count--;
+    }
+}
+
+static hybrid_node_t *
+far_min(hybrid_t *h) {
+    if (h->far.root == h->far.sentinel) {
+        return NULL;
+    }
+    return hybrid_node_of_rbnode(ngx_rbtree_min(h->far.root, h->far.sentinel));
+}
+
+// 把远层中进入近层范围的定时器迁移到时间轮
+static void
+hybrid_migrate(hybrid_t *h) {
+    hybrid_node_t *node;
+    uint32_t count = 0;
+    while ((node = far_min(h)) != NULL
+           && (int32_t)(node->expire - h->time) < HYBRID_NEAR) {
+        ngx_rbtree_delete(&h->far, &node->rbnode);
+        h->far_count--;
+        near_add(h, node);
+        h->migrated++;
+        count++;
+    }
+    // 每个刻度都会调用，只在真的搬了节点时触发探针；远层记为第 0 层
+    if (count) {
+        TIMER_PROBE_CASCADE(0, h->time & HYBRID_NEAR_MASK, count);
+    }
+}
+
+int
+hybrid_nearest(hybrid_t *h, uint32_t *expire) {
+    hybrid_node_t *node;
+    if (h->near_count) {
+        *expire = h->time + bitmap_next(h, h->time & HYBRID_NEAR_MASK);
+        return 0;
+    }
+    node = far_min(h);
+    if (!node) {
+        return -1;
+    }
+    *expire = node->expire;
+    return 0;
+}
+
+hybrid_node_t *
+hybrid_pop_expired(hybrid_t *h, uint32_t now) {
+    hybrid_link_t *head;
+    hybrid_node_t *node;
+    uint32_t next;
+    int d;
+
+    while ((int32_t)(now - h->time) >= 0) {
+        hybrid_migrate(h);
+        head = &h->near[h->time & HYBRID_NEAR_MASK];
+        if (head->next != head) {
+            node = hybrid_node_of_link(head->next);
+            near_unlink(h, node);
+            return node;
+        }
+        // 当前刻度已空，直接跳到下一个需要处理的刻度，避免空转
+        next = now + 1;
+        if (h->near_count) {
+            d = bitmap_next(h, h->time & HYBRID_NEAR_MASK);
+            if ((int32_t)(h->time + d - next) < 0) {
+                next = h->time + d;
+            }
+        }
+        if ((node = far_min(h)) != NULL) {
+            uint32_t enter = node->expire - HYBRID_NEAR + 1;
+            if ((int32_t)(enter - next) < 0) {
+                next = enter;
+            }
+        }
+        if ((int32_t)(next - h->time) <= 0) {
+            next = h->time + 1;
+        }
+        h->time = next;
+    }
+    return NULL;
+}
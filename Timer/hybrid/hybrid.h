@@ -0,0 +1,61 @@
+#ifndef _MARK_HYBRID_
+#define _MARK_HYBRID_
+
+#include <stdint.h>
+#include "rbtree.h"
+
+/*
+ * 两级混合定时器：
+ *   近层：单层时间轮，1ms 一格，覆盖 [time, time + HYBRID_NEAR) 的定时器，O(1) 增删；
+ *   远层：nginx 红黑树，存放超出近层范围的长定时器，不会像多层时间轮那样反复 cascade。
+ * 时间推进时，远层中即将进入近层范围的定时器被迁移到时间轮。
+ */
+
+#define HYBRID_NEAR_SHIFT 10
+#define HYBRID_NEAR (1 << HYBRID_NEAR_SHIFT)   // 近层范围 1024ms
+#define HYBRID_NEAR_MASK (HYBRID_NEAR - 1)
+#define HYBRID_BITMAP_WORDS (HYBRID_NEAR / 64)
+
+#define HYBRID_TIER_NONE 0
+#define HYBRID_TIER_NEAR 1
+#define HYBRID_TIER_FAR  2
+
+typedef struct hybrid_link_s hybrid_link_t;
+typedef struct hybrid_node_s hybrid_node_t;
+typedef void (*hybrid_handler_pt)(hybrid_node_t *node);
+
+struct hybrid_link_s {
+    hybrid_link_t *prev;
+    hybrid_link_t *next;
+};
+
+struct hybrid_node_s {
+    ngx_rbtree_node_t rbnode;   // 远层节点，rbnode.key 即到期时间
+    hybrid_link_t link;         // 近层槽位的双向链表
+    uint32_t expire;
+    uint8_t tier;
+    hybrid_handler_pt handler;
+    void *privdata;
+    uint64_t handle;            // 定时器句柄，见 timer_handle.h
+};
+
+typedef struct hybrid_s {
+    hybrid_link_t near[HYBRID_NEAR];
+    uint64_t bitmap[HYBRID_BITMAP_WORDS];  // 非空槽位位图，用于快速找到下一个到期槽
+    ngx_rbtree_t far;
+    ngx_rbtree_node_t sentinel;
+    uint32_t time;                         // 时间轮当前刻度（下一个待处理的毫秒）
+    uint32_t near_count;
+    uint32_t far_count;
+    uint64_t migrated;                     // 远层迁移到近层的累计次数
+} hybrid_t;
+
+void hybrid_init(hybrid_t *h, uint32_t now);
+void hybrid_add(hybrid_t *h, hybrid_node_t *node, uint32_t expire);
+void hybrid_del(hybrid_t *h, hybrid_node_t *node);
+// 最近到期时间，返回 0 表示有定时器，-1 表示为空
+int hybrid_nearest(hybrid_t *h, uint32_t *expire);
+// 推进到 now，逐个取出到期节点；返回 NULL 表示没有到期节点
+hybrid_node_t *hybrid_pop_expired(hybrid_t *h, uint32_t now);
+
+#endif
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "lfskiplist.h"
+#include "timewheel.h"
+
+/*
+ * 扩展性对比：1~64 个线程并发添加定时器（1~1000ms），其中 90% 随后被取消，
+ * 同时一个消费线程不断弹出到期定时器。分别跑无锁跳表和自旋锁保护的多层时间轮，
+ * 输出生产线程的总吞吐（Mops/s）。
+ */
+
+#define OPS_PER_THREAD 200000
+#define MAX_THREADS    64
+
+static lfskiplist_t *list;
+static volatile int stop_consumer;
+
+static double
+now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t
+now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void lfs_noop(lfs_node_t *node) { (void)node; }
+static void tw_noop(timer_node_t *node) { (void)node; }
+
+static void *
+lfs_producer(void *p) {
+    unsigned seed = (unsigned)(long)p;
+    timer_handle_t prev = TIMER_HANDLE_INVALID;
+    int i;
+    for (i = 0; i < OPS_PER_THREAD; i++) {
+        timer_handle_t h = lfs_insert(list, now_ms() + 1 + rand_r(&seed) % 1000, lfs_noop, NULL);
+        if (prev != TIMER_HANDLE_INVALID) {
+            lfs_cancel(list, prev);
+        }
+        prev = rand_r(&seed) % 10 ? h : TIMER_HANDLE_INVALID;
+    }
+    lfs_thread_exit();
+    return NULL;
+}
+
+static void *
+lfs_consumer(void *p) {
+    lfs_node_t *node;
+    while (!stop_consumer) {
+        while ((node = lfs_pop_expired(list, now_ms())) != NULL) {
+            lfs_node_release(node);
+        }
+        usleep(100);
+    }
+    lfs_thread_exit();
+    return NULL;
+}
+
+static void *
+tw_producer(void *p) {
+    unsigned seed = (unsigned)(long)p;
+    timer_handle_t prev = TIMER_HANDLE_INVALID;
+    int i;
+    for (i = 0; i < OPS_PER_THREAD; i++) {
+        timer_handle_t h = add_timer(1 + rand_r(&seed) % 1000, tw_noop, 0);
+        if (prev != TIMER_HANDLE_INVALID) {
+            del_timer(prev);
+        }
+        prev = rand_r(&seed) % 10 ? h : TIMER_HANDLE_INVALID;
+    }
+    return NULL;
+}
+
+static void *
+tw_consumer(void *p) {
+    while (!stop_consumer) {
+        expire_timer();
+        usleep(100);
+    }
+    return NULL;
+}
+
+static double
+run(int nthreads, void *(*producer)(void *), void *(*consumer)(void *)) {
+    pthread_t pid[MAX_THREADS], cid;
+    long i;
+    stop_consumer = 0;
+    pthread_create(&cid, NULL, consumer, NULL);
+    double start = now_sec();
+    for (i = 0; i < nthreads; i++) {
+        pthread_create(&pid[i], NULL, producer, (void *)(i + 1));
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(pid[i], NULL);
+    }
+    double cost = now_sec() - start;
+    stop_consumer = 1;
+    pthread_join(cid, NULL);
+    return (double)nthreads * OPS_PER_THREAD / cost / 1e6;
+}
+
+int main() {
+    int n;
+    list = lfs_create();
+    init_timer();
+    printf("%8s %18s %18s\n", "threads", "lfskiplist Mops/s", "timewheel Mops/s");
+    for (n = 1; n <= MAX_THREADS; n *= 2) {
+        double a = run(n, lfs_producer, lfs_consumer);
+        double b = run(n, tw_producer, tw_consumer);
+        printf("%8d %18.2f %18.2f\n", n, a, b);
+    }
+    clear_timer();
+    lfs_free(list);
+    return 0;
+}
+
+// gcc -O2 lfs-bench.c lfskiplist.c ../timewheel/timewheel.c -o lfs-bench -I./ -I../common -I../timewheel -lpthread
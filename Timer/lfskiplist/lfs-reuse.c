@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "lfskiplist.h"
+
+/*
+ * EBR 槽位复用的回归检查：线程 A 添加一个 expire=100 的定时器后退出，槽位交给线程 B；
+ * B 再添加一个 expire=100 的定时器，取消 A 的那个，然后做 5000 次 expire=10 的添加 / 取消。
+ * 插入序号曾经是线程局部的，B 会生成和 A 相同的键，取消时摘错节点，被回收复用的节点还挂在表里。
+ * 最后沿第 0 层检查键严格递增、个数和 length 一致，再按顺序弹出。
+ * 另外在同一线程里反复 create → 5000 次添加 / 取消 → free（不调 lfs_thread_exit）：
+ * lfs_free 曾经不清本线程 limbo 和缓存里的节点，下一轮回收时写进已释放的节点池（用 -fsanitize=address 编译能看到）。
+ */
+
+#define WALK_MAX 100000
+
+static lfskiplist_t *list;
+static timer_handle_t a_handle;
+
+static void noop(lfs_node_t *node) { (void)node; }
+
+static void *
+thread_a(void *p) {
+    (void)p;
+    a_handle = lfs_insert(list, 100, noop, NULL);
+    lfs_thread_exit();
+    return NULL;
+}
+
+static void *
+thread_b(void *p) {
+    int i;
+    (void)p;
+    lfs_insert(list, 100, noop, NULL);
+    lfs_cancel(list, a_handle);
+    for (i = 0; i < 5000; i++) {
+        lfs_cancel(list, lfs_insert(list, 10, noop, NULL));
+    }
+    lfs_thread_exit();
+    return NULL;
+}
+
+int main() {
+    pthread_t t;
+    lfs_node_t *prev = NULL, *node;
+    uint64_t n = 0, steps = 0;
+    int ok = 1, i, round;
+
+    list = lfs_create();
+    pthread_create(&t, NULL, thread_a, NULL);
+    pthread_join(t, NULL);
+    pthread_create(&t, NULL, thread_b, NULL);
+    pthread_join(t, NULL);
+
+    // 表坏掉时第 0 层可能成环，最多走 WALK_MAX 步
+    for (node = (lfs_node_t *)(atomic_load(&list->head.next[0]) & ~(uintptr_t)1); node && steps++ < WALK_MAX;
+            node = (lfs_node_t *)(atomic_load(&node->next[0]) & ~(uintptr_t)1)) {
+        if (atomic_load(&node->next[0]) & 1) {
+            continue;   // 已标记删除、还没摘掉的
+        }
+        if (prev && (node->expire < prev->expire || (node->expire == prev->expire && node->seq <= prev->seq))) {
+            if (ok) {
+                printf("level 0 out of order: %llu after %llu\n",
+                    (unsigned long long)node->expire, (unsigned long long)prev->expire);
+            }
+            ok = 0;
+        }
+        prev = node;
+        n++;
+    }
+    ok = ok && n == 1 && atomic_load(&list->length) == 1;
+    printf("level 0: %llu live nodes, length %llu\n", (unsigned long long)n,
+        (unsigned long long)atomic_load(&list->length));
+
+    if (!ok) {
+        printf("check FAILED\n");
+        return 1;   // 表已损坏，不再弹出和释放
+    }
+    node = lfs_pop_expired(list, 1000);
+    ok = ok && node && node->expire == 100 && !lfs_pop_expired(list, 1000);
+    if (node) {
+        lfs_node_release(node);
+    }
+    lfs_thread_exit();
+    lfs_free(list);
+
+    for (round = 0; round < 3; round++) {
+        list = lfs_create();
+        for (i = 0; i < 5000; i++) {
+            lfs_cancel(list, lfs_insert(list, 10, noop, NULL));
+        }
+        ok = ok && atomic_load(&list->length) == 0;
+        lfs_free(list);
+    }
+    printf("create / free rounds: done\n");
+    lfs_thread_exit();
+    printf(ok ? "check ok\n" : "check FAILED\n");
+    return !ok;
+}
+
+// gcc -O2 lfs-reuse.c lfskiplist.c -o lfs-reuse -I./ -I../common -lpthread
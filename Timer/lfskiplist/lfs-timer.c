@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "lfs-timer.h"
+
+static lfskiplist_t *T;
+static volatile int quit;
+
+void print_hello(lfs_node_t *node) {
+    printf("hello world time = %lu thread = %ld\n", (unsigned long)node->expire, (long)node->privdata);
+}
+
+void do_quit(lfs_node_t *node) {
+    quit = 1;
+}
+
+void* thread_worker(void *p) {
+    long id = (long)p;
+    int i;
+    for (i = 0; i < 5; i++) {
+        lfs_insert(T, current_time() + 500 * (i + 1), print_hello, (void *)id);
+        // 添加后马上取消，旧句柄再取消一次是空操作
+        timer_handle_t h = add_timer(T, 1000, print_hello);
+        del_timer(T, h);
+        del_timer(T, h);
+    }
+    lfs_thread_exit();
+    return NULL;
+}
+
+int main() {
+    pthread_t pid[4];
+    long i;
+
+    T = init_timer();
+    add_timer(T, 3000, do_quit);
+    for (i = 0; i < 4; i++) {
+        pthread_create(&pid[i], NULL, thread_worker, (void *)i);
+    }
+    while (!quit) {
+        expire_timer(T);
+        usleep(1000);
+    }
+    for (i = 0; i < 4; i++) {
+        pthread_join(pid[i], NULL);
+    }
+    lfs_free(T);
+    return 0;
+}
+
+// gcc lfs-timer.c lfskiplist.c -o lfs -I./ -I../common -lpthread
@@ -0,0 +1,89 @@
+#ifndef MARK_LFSKIPLIST_TIMER_H
+#define MARK_LFSKIPLIST_TIMER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+#include <AvailabilityMacros.h>
+#include <sys/time.h>
+#include <mach/task.h>
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+#include "lfskiplist.h"
+#include "timer_probe.h"
+#include "timer_expired.h"
+
+static uint64_t
+current_time() {
+	uint64_t t;
+#if !defined(__APPLE__) || defined(AVAILABLE_MAC_OS_X_VERSION_10_12_AND_LATER)
+	struct timespec ti;
+	clock_gettime(CLOCK_MONOTONIC, &ti);
+	t = (uint64_t)ti.tv_sec * 1000;
+	t += ti.tv_nsec / 1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	t = (uint64_t)tv.tv_sec * 1000;
+	t += tv.tv_usec / 1000;
+#endif
+	return t;
+}
+
+lfskiplist_t *init_timer() {
+    return lfs_create();
+}
+
+// 任意线程都可以调用；取消和触发的探针在 lfskiplist.c 里，那里才拿得到节点的代数
+timer_handle_t add_timer(lfskiplist_t *T, uint32_t msec, lfs_handler_pt func) {
+    uint64_t now = current_time();
+    timer_handle_t h = lfs_insert(T, now + msec, func, NULL);
+    TIMER_PROBE_ADD(h, now + msec, now);
+    return h;
+}
+
+// 任意线程都可以调用；句柄已失效时返回 false
+bool del_timer(lfskiplist_t *T, timer_handle_t h) {
+    return lfs_cancel(T, h);
+}
+
+int find_nearest_expire_timer(lfskiplist_t *T) {
+    uint64_t expire;
+    if (lfs_nearest(T, &expire) < 0) return -1;
+    int64_t diff = (int64_t)expire - (int64_t)current_time();
+    return diff > 0 ? (int)diff : 0;
+}
+
+// 只能由一个线程调用
+void expire_timer(lfskiplist_t *T) {
+    lfs_node_t *node;
+    uint64_t now = current_time();
+    while ((node = lfs_pop_expired(T, now)) != NULL) {
+        if (node->handler) {
+            node->handler(node);
+        }
+        lfs_node_release(node);
+    }
+}
+
+// 不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+// 和 expire_timer 一样只能有一个消费者，但可以是任意线程，添加 / 取消的线程不用加锁
+unsigned expire_into(lfskiplist_t *T, timer_expired_t *out, unsigned max, uint64_t now) {
+    lfs_node_t *node;
+    unsigned n = 0;
+    while (n < max && (node = lfs_pop_expired(T, now)) != NULL) {
+        out[n].handle = lfs_node_handle(node);
+        out[n].expire = (uint32_t)node->expire;
+        lfs_node_release(node);
+        n++;
+    }
+    return n;
+}
+
+#endif
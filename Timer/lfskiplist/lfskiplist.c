@@ -0,0 +1,594 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "lfskiplist.h"
+#include "timer_probe.h"
+
+#define LFS_NODE_FREE    0
+#define LFS_NODE_LIVE    1
+#define LFS_NODE_CLAIMED 2
+
+#define LFS_CACHE        64     // 每个线程缓存的空闲节点数
+#define LFS_RETIRE_SCAN  64     // 每延迟回收这么多节点尝试推进一次 epoch
+
+#define is_marked(p)   ((p) & 1)
+#define get_ptr(p)     ((lfs_node_t *)((p) & ~(uintptr_t)1))
+#define state_gen(s)   ((uint32_t)((s) >> 2))
+#define state_of(s)    ((uint32_t)((s) & 3))
+
+/* ---------------- EBR：基于 epoch 的延迟回收 ---------------- */
+
+typedef struct ebr_rec_s {
+    _Atomic uint64_t local;      // epoch << 1 | 是否在临界区
+    _Atomic int used;
+    _Atomic int busy;            // 操作 limbo / 空闲缓存时持有，平时只有本线程拿，lfs_free 清理时才会竞争
+    lfs_node_t *limbo[3];        // 按 epoch % 3 分桶的待回收节点
+    uint64_t limbo_epoch[3];
+    unsigned retired;
+    uint64_t seq;                // 插入序号，跟着槽位走：槽位交给新线程后接着递增，键不会和旧线程的重复
+    // 空闲节点缓存放在记录里而不是线程局部变量里，lfs_free 才找得到绑定到它的缓存
+    lfskiplist_t *cache_list;
+    uint32_t cache_n;
+    uint32_t cache_idx[LFS_CACHE];
+} __attribute__((aligned(64))) ebr_rec_t;
+
+static ebr_rec_t ebr_recs[LFS_MAX_THREADS];
+static _Atomic uint64_t ebr_global = 1;
+static __thread ebr_rec_t *ebr_self;
+
+// 线程局部：层数随机数状态
+static __thread uint64_t lfs_rand_state;
+
+static ebr_rec_t *
+ebr_rec(void) {
+    int i;
+    if (ebr_self) {
+        return ebr_self;
+    }
+    for (;;) {
+        for (i = 0; i < LFS_MAX_THREADS; i++) {
+            int expected = 0;
+            if (atomic_compare_exchange_strong(&ebr_recs[i].used, &expected, 1)) {
+                ebr_self = &ebr_recs[i];
+                lfs_rand_state = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+                return ebr_self;
+            }
+        }
+        sched_yield();
+    }
+}
+
+static inline void
+ebr_lock(ebr_rec_t *r) {
+    while (atomic_exchange_explicit(&r->busy, 1, memory_order_acquire)) {
+        sched_yield();
+    }
+}
+
+static inline void
+ebr_unlock(ebr_rec_t *r) {
+    atomic_store_explicit(&r->busy, 0, memory_order_release);
+}
+
+// 临界区内持有本线程记录的 busy，limbo 和空闲缓存只在临界区内改动
+static inline void
+ebr_enter(void) {
+    ebr_rec_t *r = ebr_rec();
+    uint64_t e = atomic_load(&ebr_global);
+    ebr_lock(r);
+    atomic_store(&r->local, (e << 1) | 1);
+}
+
+static inline void
+ebr_exit(void) {
+    atomic_store_explicit(&ebr_self->local, 0, memory_order_release);
+    ebr_unlock(ebr_self);
+}
+
+// 所有在临界区的线程都已看到当前 epoch 时推进一次
+static void
+ebr_try_advance(void) {
+    uint64_t g = atomic_load(&ebr_global);
+    int i;
+    for (i = 0; i < LFS_MAX_THREADS; i++) {
+        if (!atomic_load_explicit(&ebr_recs[i].used, memory_order_relaxed)) {
+            continue;
+        }
+        uint64_t l = atomic_load(&ebr_recs[i].local);
+        if ((l & 1) && (l >> 1) != g) {
+            return;
+        }
+    }
+    atomic_compare_exchange_strong(&ebr_global, &g, g + 1);
+}
+
+static void node_recycle(ebr_rec_t *r, lfs_node_t *node);
+
+static void
+ebr_reclaim_bucket(ebr_rec_t *r, int b) {
+    lfs_node_t *node = r->limbo[b], *next;
+    r->limbo[b] = NULL;
+    while (node) {
+        next = node->retire_next;
+        node_recycle(r, node);
+        node = next;
+    }
+}
+
+// 回收已经过去两个 epoch 的桶
+static void
+ebr_reclaim(ebr_rec_t *r) {
+    uint64_t g = atomic_load(&ebr_global);
+    int b;
+    for (b = 0; b < 3; b++) {
+        if (r->limbo[b] && r->limbo_epoch[b] + 2 <= g) {
+            ebr_reclaim_bucket(r, b);
+        }
+    }
+}
+
+static void
+ebr_retire(lfs_node_t *node) {
+    ebr_rec_t *r = ebr_rec();
+    uint64_t g = atomic_load(&ebr_global);
+    int b = (int)(g % 3);
+    if (r->limbo_epoch[b] != g) {
+        // 桶里是至少三个 epoch 之前的节点，已经安全
+        if (r->limbo[b]) {
+            ebr_reclaim_bucket(r, b);
+        }
+        r->limbo_epoch[b] = g;
+    }
+    node->retire_next = r->limbo[b];
+    r->limbo[b] = node;
+    if (++r->retired % LFS_RETIRE_SCAN == 0) {
+        ebr_try_advance();
+        ebr_reclaim(r);
+    }
+}
+
+/* ---------------- 节点池 ---------------- */
+
+static inline lfs_node_t *
+node_at(lfskiplist_t *list, uint32_t idx) {
+    return &list->chunks[idx >> LFS_CHUNK_SHIFT][idx & (LFS_CHUNK_SIZE - 1)];
+}
+
+// 把 first..last（已经用 free_next 串好）整体压入全局空闲栈
+static void
+free_push_batch(lfskiplist_t *list, lfs_node_t *first, lfs_node_t *last) {
+    uint64_t top = atomic_load(&list->free_top), nt;
+    do {
+        atomic_store_explicit(&last->free_next, (uint32_t)top, memory_order_relaxed);
+        nt = ((top >> 32) + 1) << 32 | (first->idx + 1);
+    } while (!atomic_compare_exchange_weak(&list->free_top, &top, nt));
+}
+
+static void
+cache_flush(ebr_rec_t *r) {
+    uint32_t i;
+    lfskiplist_t *list = r->cache_list;
+    if (!list || !r->cache_n) {
+        return;
+    }
+    for (i = 0; i + 1 < r->cache_n; i++) {
+        atomic_store_explicit(&node_at(list, r->cache_idx[i])->free_next,
+            r->cache_idx[i + 1] + 1, memory_order_relaxed);
+    }
+    free_push_batch(list, node_at(list, r->cache_idx[0]),
+        node_at(list, r->cache_idx[r->cache_n - 1]));
+    r->cache_n = 0;
+}
+
+static void
+cache_bind(ebr_rec_t *r, lfskiplist_t *list) {
+    if (r->cache_list != list) {
+        cache_flush(r);
+        r->cache_list = list;
+    }
+}
+
+static int
+pool_grow(lfskiplist_t *list) {
+    uint32_t cap, i;
+    lfs_node_t *chunk;
+    pthread_mutex_lock(&list->grow_lock);
+    // 别的线程可能刚扩容完
+    if ((uint32_t)atomic_load(&list->free_top)) {
+        pthread_mutex_unlock(&list->grow_lock);
+        return 0;
+    }
+    cap = atomic_load(&list->capacity);
+    if ((cap >> LFS_CHUNK_SHIFT) >= LFS_MAX_CHUNKS
+        || !(chunk = calloc(LFS_CHUNK_SIZE, sizeof(lfs_node_t)))) {
+        pthread_mutex_unlock(&list->grow_lock);
+        return -1;
+    }
+    for (i = 0; i < LFS_CHUNK_SIZE; i++) {
+        chunk[i].idx = cap + i;
+        chunk[i].list = list;
+        atomic_init(&chunk[i].state, (uint64_t)1 << 2 | LFS_NODE_FREE);
+        atomic_init(&chunk[i].free_next, i + 1 < LFS_CHUNK_SIZE ? cap + i + 2 : 0);
+    }
+    list->chunks[cap >> LFS_CHUNK_SHIFT] = chunk;
+    atomic_store(&list->capacity, cap + LFS_CHUNK_SIZE);
+    free_push_batch(list, &chunk[0], &chunk[LFS_CHUNK_SIZE - 1]);
+    pthread_mutex_unlock(&list->grow_lock);
+    return 0;
+}
+
+// Treiber 栈弹出一个空闲下标；节点内存类型稳定，读到过期的 free_next 也只会让带标签的 CAS 失败
+static uint32_t
+free_pop(lfskiplist_t *list) {
+    uint64_t top = atomic_load(&list->free_top), nt;
+    uint32_t next;
+    do {
+        if (!(uint32_t)top) {
+            return 0;
+        }
+        next = atomic_load_explicit(&node_at(list, (uint32_t)top - 1)->free_next, memory_order_relaxed);
+        nt = ((top >> 32) + 1) << 32 | next;
+    } while (!atomic_compare_exchange_weak(&list->free_top, &top, nt));
+    return (uint32_t)top;
+}
+
+static lfs_node_t *
+node_alloc(ebr_rec_t *r, lfskiplist_t *list) {
+    uint32_t idx;
+
+    cache_bind(r, list);
+    while (!r->cache_n) {
+        // 一次取一批到本线程缓存，减少全局栈上的 CAS 竞争
+        while (r->cache_n < LFS_CACHE / 2 && (idx = free_pop(list)) != 0) {
+            r->cache_idx[r->cache_n++] = idx - 1;
+        }
+        if (!r->cache_n && pool_grow(list) < 0) {
+            return NULL;
+        }
+    }
+    return node_at(list, r->cache_idx[--r->cache_n]);
+}
+
+// 宽限期已过：代数加一，旧句柄从此失效，节点回到空闲池
+static void
+node_recycle(ebr_rec_t *r, lfs_node_t *node) {
+    uint64_t s = atomic_load(&node->state);
+    uint32_t gen = state_gen(s) + 1;
+    if (gen == 0) {
+        gen = 1;
+    }
+    atomic_store(&node->state, (uint64_t)gen << 2 | LFS_NODE_FREE);
+    cache_bind(r, node->list);
+    if (r->cache_n == LFS_CACHE) {
+        cache_flush(r);
+    }
+    r->cache_idx[r->cache_n++] = node->idx;
+}
+
+/* ---------------- 跳表 ---------------- */
+
+static inline int
+random_level(void) {
+    uint64_t x = lfs_rand_state;
+    int level = 1;
+    // xorshift64*
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    lfs_rand_state = x;
+    x *= 0x2545F4914F6CDD1DULL;
+    while ((x & 3) == 0 && level < LFS_MAXLEVEL) {  // 每层 1/4 的概率
+        level++;
+        x >>= 2;
+    }
+    return level;
+}
+
+static inline bool
+key_less(const lfs_node_t *node, uint64_t expire, uint64_t seq) {
+    return node->expire < expire || (node->expire == expire && node->seq < seq);
+}
+
+/*
+ * 找到每一层 key 的前驱和后继，沿途摘除已打标记的节点。
+ * 返回 true 表示第 0 层的后继就是 key 对应的节点。
+ */
+static bool
+lfs_find(lfskiplist_t *list, uint64_t expire, uint64_t seq,
+         lfs_node_t **preds, lfs_node_t **succs) {
+    lfs_node_t *pred, *curr, *succ;
+    uintptr_t raw;
+    int level;
+
+retry:
+    pred = &list->head;
+    for (level = LFS_MAXLEVEL - 1; level >= 0; level--) {
+        curr = get_ptr(atomic_load(&pred->next[level]));
+        while (curr) {
+            raw = atomic_load(&curr->next[level]);
+            while (is_marked(raw)) {
+                uintptr_t expected = (uintptr_t)curr;
+                succ = get_ptr(raw);
+                if (!atomic_compare_exchange_strong(&pred->next[level], &expected, (uintptr_t)succ)) {
+                    goto retry;
+                }
+                curr = succ;
+                if (!curr) {
+                    break;
+                }
+                raw = atomic_load(&curr->next[level]);
+            }
+            if (curr && key_less(curr, expire, seq)) {
+                pred = curr;
+                curr = get_ptr(raw);
+            } else {
+                break;
+            }
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+    return succs[0] && succs[0]->expire == expire && succs[0]->seq == seq;
+}
+
+static void
+node_put(lfs_node_t *node) {
+    if (atomic_fetch_sub(&node->owners, 1) == 1) {
+        ebr_retire(node);
+    }
+}
+
+// 逻辑删除：先从高层往下打标记，最后标记第 0 层，再 find 一次完成物理摘除
+static void
+node_mark(lfskiplist_t *list, lfs_node_t *node) {
+    lfs_node_t *preds[LFS_MAXLEVEL], *succs[LFS_MAXLEVEL];
+    uintptr_t succ;
+    int level;
+    for (level = node->level - 1; level >= 0; level--) {
+        succ = atomic_load(&node->next[level]);
+        while (!is_marked(succ)) {
+            if (atomic_compare_exchange_weak(&node->next[level], &succ, succ | 1)) {
+                break;
+            }
+        }
+    }
+    lfs_find(list, node->expire, node->seq, preds, succs);
+    atomic_fetch_sub(&list->length, 1);
+}
+
+lfskiplist_t *
+lfs_create(void) {
+    lfskiplist_t *list = calloc(1, sizeof(*list));
+    if (!list) {
+        return NULL;
+    }
+    pthread_mutex_init(&list->grow_lock, NULL);
+    list->head.level = LFS_MAXLEVEL;
+    return list;
+}
+
+// 丢掉 r 里属于 list 的待回收节点和绑定到 list 的空闲缓存，它们随节点池一起释放
+static void
+ebr_forget(ebr_rec_t *r, lfskiplist_t *list) {
+    lfs_node_t **pp;
+    int b;
+    for (b = 0; b < 3; b++) {
+        pp = &r->limbo[b];
+        while (*pp) {
+            if ((*pp)->list == list) {
+                *pp = (*pp)->retire_next;
+            } else {
+                pp = &(*pp)->retire_next;
+            }
+        }
+    }
+    if (r->cache_list == list) {
+        r->cache_list = NULL;
+        r->cache_n = 0;
+    }
+}
+
+void
+lfs_free(lfskiplist_t *list) {
+    uint32_t i, cap = atomic_load(&list->capacity);
+    // 每个线程的 limbo 和缓存里都可能还有这个表的节点，不清掉的话之后回收会写进已释放的节点池
+    for (i = 0; i < LFS_MAX_THREADS; i++) {
+        ebr_lock(&ebr_recs[i]);
+        ebr_forget(&ebr_recs[i], list);
+        ebr_unlock(&ebr_recs[i]);
+    }
+    for (i = 0; i < (cap >> LFS_CHUNK_SHIFT); i++) {
+        free(list->chunks[i]);
+    }
+    pthread_mutex_destroy(&list->grow_lock);
+    free(list);
+}
+
+timer_handle_t
+lfs_insert(lfskiplist_t *list, uint64_t expire, lfs_handler_pt func, void *privdata) {
+    lfs_node_t *preds[LFS_MAXLEVEL], *succs[LFS_MAXLEVEL];
+    lfs_node_t *node, *pred, *succ;
+    uintptr_t cur, expected;
+    uint64_t s;
+    int level;
+
+    ebr_enter();
+    node = node_alloc(ebr_self, list);
+    if (!node) {
+        ebr_exit();
+        return TIMER_HANDLE_INVALID;
+    }
+    s = atomic_load(&node->state);
+    node->expire = expire;
+    // EBR 槽位 + 槽位内序号，不同线程之间没有共享计数器
+    node->seq = ((uint64_t)(ebr_self - ebr_recs) << 48) | ++ebr_self->seq;
+    node->handler = func;
+    node->privdata = privdata;
+    node->level = random_level();
+    atomic_store(&node->owners, 2);
+    atomic_store(&node->state, (s & ~(uint64_t)3) | LFS_NODE_LIVE);
+
+    for (;;) {
+        lfs_find(list, node->expire, node->seq, preds, succs);
+        for (level = 0; level < node->level; level++) {
+            atomic_store_explicit(&node->next[level], (uintptr_t)succs[level], memory_order_relaxed);
+        }
+        expected = (uintptr_t)succs[0];
+        if (atomic_compare_exchange_strong(&preds[0]->next[0], &expected, (uintptr_t)node)) {
+            break;
+        }
+    }
+    atomic_fetch_add(&list->length, 1);
+
+    for (level = 1; level < node->level; level++) {
+        for (;;) {
+            pred = preds[level];
+            succ = succs[level];
+            cur = atomic_load(&node->next[level]);
+            if (is_marked(cur)) {
+                goto done;   // 已被删除，不再往上挂
+            }
+            if (get_ptr(cur) != succ
+                && !atomic_compare_exchange_strong(&node->next[level], &cur, (uintptr_t)succ)) {
+                goto done;
+            }
+            expected = (uintptr_t)succ;
+            if (atomic_compare_exchange_strong(&pred->next[level], &expected, (uintptr_t)node)) {
+                break;
+            }
+            if (is_marked(atomic_load(&node->next[0]))) {
+                goto done;
+            }
+            lfs_find(list, node->expire, node->seq, preds, succs);
+        }
+    }
+done:
+    // 挂链过程中被删除了，帮忙摘掉刚挂上去的高层
+    if (is_marked(atomic_load(&node->next[0]))) {
+        lfs_find(list, node->expire, node->seq, preds, succs);
+    }
+    s = atomic_load(&node->state);
+    node_put(node);
+    ebr_exit();
+    return ((timer_handle_t)state_gen(s) << 32) | node->idx;
+}
+
+// 把节点从 LIVE 抢到 CLAIMED，取消和弹出互斥，只有一方能成功
+static bool
+node_claim(lfs_node_t *node, uint32_t gen) {
+    uint64_t s = atomic_load(&node->state);
+    if (state_gen(s) != gen || state_of(s) != LFS_NODE_LIVE) {
+        return false;
+    }
+    return atomic_compare_exchange_strong(&node->state, &s, (s & ~(uint64_t)3) | LFS_NODE_CLAIMED);
+}
+
+bool
+lfs_cancel(lfskiplist_t *list, timer_handle_t handle) {
+    uint32_t idx = handle_index(handle);
+    lfs_node_t *node;
+    if (handle == TIMER_HANDLE_INVALID || idx >= atomic_load(&list->capacity)) {
+        return false;
+    }
+    // 节点池的内存不会归还，旧句柄读到的只是代数不同的节点
+    node = node_at(list, idx);
+    ebr_enter();
+    if (!node_claim(node, handle_gen(handle))) {
+        ebr_exit();
+        return false;
+    }
+    TIMER_PROBE_DEL(handle, node->expire);
+    node_mark(list, node);
+    node_put(node);
+    ebr_exit();
+    return true;
+}
+
+int
+lfs_nearest(lfskiplist_t *list, uint64_t *expire) {
+    lfs_node_t *curr;
+    uintptr_t raw;
+    int ret = -1;
+    ebr_enter();
+    curr = get_ptr(atomic_load(&list->head.next[0]));
+    while (curr) {
+        raw = atomic_load(&curr->next[0]);
+        if (!is_marked(raw)) {
+            *expire = curr->expire;
+            ret = 0;
+            break;
+        }
+        curr = get_ptr(raw);
+    }
+    ebr_exit();
+    return ret;
+}
+
+lfs_node_t *
+lfs_pop_expired(lfskiplist_t *list, uint64_t now) {
+    lfs_node_t *curr;
+    uintptr_t raw;
+    ebr_enter();
+    curr = get_ptr(atomic_load(&list->head.next[0]));
+    while (curr) {
+        raw = atomic_load(&curr->next[0]);
+        if (!is_marked(raw)) {
+            if (curr->expire > now) {
+                break;
+            }
+            uint64_t s = atomic_load(&curr->state);
+            if (node_claim(curr, state_gen(s))) {
+                TIMER_PROBE_FIRE(((timer_handle_t)state_gen(s) << 32) | curr->idx, curr->expire,
+                    (int64_t)(now - curr->expire));
+                node_mark(list, curr);
+                ebr_exit();
+                return curr;
+            }
+        }
+        curr = get_ptr(raw);
+    }
+    ebr_exit();
+    return NULL;
+}
+
+timer_handle_t
+lfs_node_handle(lfs_node_t *node) {
+    return ((timer_handle_t)state_gen(atomic_load(&node->state)) << 32) | node->idx;
+}
+
+void
+lfs_node_release(lfs_node_t *node) {
+    // 可能进入 ebr_retire，要在临界区里改 limbo
+    ebr_enter();
+    node_put(node);
+    ebr_exit();
+}
+
+void
+lfs_thread_exit(void) {
+    ebr_rec_t *r = ebr_self;
+    int b;
+    if (!r) {
+        return;
+    }
+    for (;;) {
+        ebr_try_advance();
+        ebr_lock(r);
+        ebr_reclaim(r);
+        if (!r->limbo[0] && !r->limbo[1] && !r->limbo[2]) {
+            break;
+        }
+        ebr_unlock(r);
+        sched_yield();
+    }
+    cache_flush(r);
+    r->cache_list = NULL;
+    for (b = 0; b < 3; b++) {
+        r->limbo_epoch[b] = 0;
+    }
+    r->retired = 0;
+    atomic_store(&r->local, 0);
+    ebr_unlock(r);
+    ebr_self = NULL;
+    atomic_store(&r->used, 0);
+}
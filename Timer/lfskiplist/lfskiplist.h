@@ -0,0 +1,72 @@
+#ifndef _MARK_LFSKIPLIST_
+#define _MARK_LFSKIPLIST_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "timer_handle.h"
+
+/*
+ * 无锁并发跳表（Herlihy-Shavit），多个线程并发插入 / 取消，单个线程弹出最小值。
+ *   - 插入：先 CAS 挂到第 0 层，再逐层向上挂；
+ *   - 删除：先在 next 指针最低位打标记（逻辑删除），再由 find 顺手摘除（物理删除）；
+ *   - 层数：线程局部 xorshift，不再走 rand() 的全局锁；
+ *   - 回收：基于 epoch 的延迟回收（EBR），节点来自类型稳定的节点池，
+ *     句柄 = 池下标 + 代数，旧句柄取消是 O(1) 空操作。
+ */
+
+#define LFS_MAXLEVEL     16       // p = 1/4 时足够 4^16 个元素
+#define LFS_CHUNK_SHIFT  12
+#define LFS_CHUNK_SIZE   (1 << LFS_CHUNK_SHIFT)
+#define LFS_MAX_CHUNKS   4096     // 最多 16M 个节点
+#define LFS_MAX_THREADS  256      // 同时参与 EBR 的线程数上限
+
+typedef struct lfs_node_s lfs_node_t;
+typedef struct lfskiplist_s lfskiplist_t;
+typedef void (*lfs_handler_pt)(lfs_node_t *node);
+
+struct lfs_node_s {
+    uint64_t expire;             // 到期时间（ms）
+    uint64_t seq;                // 同一到期时间下的次序，保证键唯一
+    lfs_handler_pt handler;
+    void *privdata;
+    lfskiplist_t *list;
+    lfs_node_t *retire_next;     // EBR 待回收链表
+    _Atomic uint64_t state;      // 代数 << 2 | LFS_NODE_FREE / LIVE / CLAIMED
+    _Atomic int owners;          // 插入线程和删除方各持有一份，归零后进入回收
+    _Atomic uint32_t free_next;  // 空闲栈中的下一个下标 + 1
+    uint32_t idx;                // 在节点池中的下标
+    int level;
+    _Atomic uintptr_t next[LFS_MAXLEVEL];  // 最低位为删除标记
+};
+
+struct lfskiplist_s {
+    lfs_node_t head;
+    lfs_node_t *chunks[LFS_MAX_CHUNKS];
+    _Atomic uint32_t capacity;   // 已分配的节点数
+    pthread_mutex_t grow_lock;   // 只在扩容节点池时使用
+    _Atomic uint64_t free_top;   // 空闲栈：标签 << 32 | (下标 + 1)
+    _Atomic uint64_t length;
+};
+
+lfskiplist_t *lfs_create(void);
+// 调用时不能再有线程在操作这个表；各线程 EBR 里还没回收的、缓存着的本表节点一并丢弃
+void lfs_free(lfskiplist_t *list);
+
+// 以下函数可在任意线程并发调用
+timer_handle_t lfs_insert(lfskiplist_t *list, uint64_t expire, lfs_handler_pt func, void *privdata);
+bool lfs_cancel(lfskiplist_t *list, timer_handle_t handle);
+// 最近的到期时间，空表返回 -1
+int lfs_nearest(lfskiplist_t *list, uint64_t *expire);
+
+// 单消费者：取出一个 expire <= now 的最小节点，处理完后必须调用 lfs_node_release
+lfs_node_t *lfs_pop_expired(lfskiplist_t *list, uint64_t now);
+// 弹出的节点对应的句柄（已经失效），在 lfs_node_release 之前调用
+timer_handle_t lfs_node_handle(lfs_node_t *node);
+void lfs_node_release(lfs_node_t *node);
+
+// 线程退出前调用，等待本线程延迟回收的节点全部归还后释放 EBR 记录
+void lfs_thread_exit(void);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "minheap.h"
+
+/*
+ * 堆数组扩容的代价：逐个 push n 个定时器（默认 2000 万，参数可改），报告
+ *   push   平均耗时；触发扩容的那些 push 的次数、合计和最慢一次（连续数组时是 realloc，分段时是分配一段）
+ *   pop / erase  平均耗时，看分段后多一次查段目录的代价
+ *   峰值 RSS（连续数组扩容时新旧两块同时存在）
+ * 同一份源码编两次对比，顺带检查 pop 顺序和 min_heap_idx：
+ *   gcc -O2 mh-grow-bench.c minheap.c -o mh-grow-bench -I./
+ *   gcc -O2 -DMIN_HEAP_SEGMENTED mh-grow-bench.c minheap.c -o mh-grow-bench-seg -I./
+ */
+
+static double
+now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 20000000;
+    timer_entry_t *es = malloc(n * sizeof(*es));
+    min_heap_t heap;
+    size_t i, erased = 0;
+    double t0, t, grow_worst = 0, grow_total = 0, t_push, t_erase, t_pop;
+    unsigned grows = 0, cap;
+    uint32_t last = 0;
+    int ok = 1;
+    struct rusage ru;
+
+    srand(1);
+    for (i = 0; i < n; i++) {
+        min_heap_elem_init_(&es[i]);
+        es[i].time = 1 + rand() % 3600000;
+    }
+    min_heap_ctor_(&heap);
+
+    t0 = now_ns();
+    for (i = 0; i < n; i++) {
+        cap = heap.a;
+        t = now_ns();
+        min_heap_push_(&heap, &es[i]);
+        t = now_ns() - t;
+        if (heap.a != cap) {
+            grows++;
+            grow_total += t;
+            grow_worst = t > grow_worst ? t : grow_worst;
+        }
+    }
+    t_push = now_ns() - t0;
+
+    // 取消一半，顺带检查 min_heap_idx 指回自己
+    t0 = now_ns();
+    for (i = 0; i < n; i += 2) {
+        ok = ok && min_heap_at(&heap, es[i].min_heap_idx) == &es[i];
+        min_heap_erase_(&heap, &es[i]);
+        erased++;
+    }
+    t_erase = now_ns() - t0;
+
+    t0 = now_ns();
+    for (i = 0; i < n - erased; i++) {
+        timer_entry_t *te = min_heap_pop_(&heap);
+        ok = ok && te && te->time >= last && te->min_heap_idx == -1;
+        last = te ? te->time : last;
+    }
+    t_pop = now_ns() - t0;
+    ok = ok && min_heap_empty_(&heap);
+
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef MIN_HEAP_SEGMENTED
+    printf("segmented (%u entries/segment), %zu timers\n", MIN_HEAP_SEG_SIZE, n);
+#else
+    printf("contiguous (realloc x2), %zu timers\n", n);
+#endif
+    printf("  push   %6.1f ns/op  %u growing pushes, total %.3f ms, worst %.3f ms\n",
+        t_push / n, grows, grow_total / 1e6, grow_worst / 1e6);
+    printf("  erase  %6.1f ns/op\n", t_erase / erased);
+    printf("  pop    %6.1f ns/op\n", t_pop / (n - erased));
+    printf("  peak rss %ld MB (timer entries %zu MB)\n", ru.ru_maxrss / 1024, n * sizeof(*es) >> 20);
+
+    min_heap_dtor_(&heap);
+    free(es);
+    printf(ok ? "check ok\n" : "check FAILED\n");
+    return !ok;
+}
+
+// gcc -O2 mh-grow-bench.c minheap.c -o mh-grow-bench -I./
@@ -1,5 +1,6 @@
 
 #include <stdio.h>
+#include <unistd.h>
 #include <sys/epoll.h>
 #include "mh-timer.h"
 
@@ -7,6 +8,23 @@ void hello_world(timer_entry_t *te) {
     printf("hello world time = %u\n", te->time);
 }
 
+static int pipefd[2];
+
+// 模拟对端发数据
+void peer_send(timer_entry_t *te) {
+    (void)te;
+    if (write(pipefd[1], "x", 1) < 0) {
+        perror("write");
+    }
+}
+
+void idle_close(int fd, void *ud) {
+    const timer_idle_stat_t *st = idle_stat();
+    printf("fd %d idle, close (touched %llu, rearmed %llu)\n", fd,
+        (unsigned long long)st->touched, (unsigned long long)st->rearmed);
+    close(fd);
+}
+
 int main() {
     init_timer();
 
@@ -14,18 +32,45 @@ int main() {
     add_timer(2000, hello_world);
     add_timer(3000, hello_world);
 
+    timer_handle_t h = add_timer(1500, hello_world);
+    del_timer(h);
+    del_timer(h);  // 句柄已失效，重复取消是空操作
+
+    // 一个连接的空闲、写超时、保活定时器放在同一组，关闭连接时一次取消
+    timer_group_t conn;
+    timer_group_init(&conn);
+    add_group_timer(1200, hello_world, &conn);
+    add_group_timer(1800, hello_world, &conn);
+    add_group_timer(2500, hello_world, &conn);
+    printf("cancel_group: %u timers\n", cancel_group(&conn));
+
     int epfd = epoll_create(1);
     struct epoll_event events[512];
 
+    // 连接 1000ms 没有数据就关闭；对端在 300/600/900ms 各发一次，
+    // 收包只记时间，1000ms 时定时器发现有活动，按剩余的 900ms 重挂一次，1900ms 关闭
+    if (pipe(pipefd) == 0) {
+        struct epoll_event ev = {.events = EPOLLIN, .data.fd = pipefd[0]};
+        epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &ev);
+        idle_watch(pipefd[0], 1000, idle_close, NULL);
+        add_timer(300, peer_send);
+        add_timer(600, peer_send);
+        add_timer(900, peer_send);
+    }
+
     for (;;) {
         int nearest = find_nearest_expire_timer();
         int n = epoll_wait(epfd, events, 512, nearest);
         for (int i=0; i < n; i++) {
-            // 
+            char buf[64];
+            int fd = events[i].data.fd;
+            if (read(fd, buf, sizeof(buf)) > 0) {
+                idle_touch(fd);
+            }
         }
         expire_timer();
     }
     return 0;
 }
 
-// gcc mh-timer.c minheap.c -o mh -I./
\ No newline at end of file
+// gcc mh-timer.c minheap.c -o mh -I./ -I../common
\ No newline at end of file
@@ -17,8 +17,27 @@
 #include <stdint.h>
 
 #include "minheap.h"
+#include "timer_handle.h"
+#include "timer_snapshot.h"
+#include "timer_budget.h"
+#include "timer_group.h"
+#include "timer_expired.h"
+#include "timer_probe.h"
+#include "timer_idle.h"
+
+// 堆里存的是 timer_entry_t，组链表放在外面一层，minheap.h 不用知道定时器组
+typedef struct mh_timer_s {
+    timer_entry_t entry;        // 必须是第一个成员，回调拿到的 timer_entry_t * 就是它
+    timer_group_link_t group;
+} mh_timer_t;
+
+#define mh_timer_of(te) ((mh_timer_t *)(te))
 
 static min_heap_t min_heap;
+static handle_table_t handles;
+static timer_budget_t budget;          // 默认不限
+static timer_budget_stat_t budget_stat;
+static timer_idle_table_t idle_table;
 
 static uint32_t
 current_time() {
@@ -39,30 +58,71 @@ current_time() {
 
 void init_timer(){
     min_heap_ctor_(&min_heap);
+    handle_table_init(&handles);
+    timer_idle_table_init(&idle_table);
 }
 
-timer_entry_t * add_timer(uint32_t msec, timer_handler_pt callback) {
-    timer_entry_t *te = (timer_entry_t *)malloc(sizeof(*te));
-    if (!te) {
-        return NULL;
+// 添加定时器并挂到组 g 里（g 为 NULL 不入组），关闭连接时用 cancel_group 一次取消整组
+timer_handle_t add_group_timer(uint32_t msec, timer_handler_pt callback, timer_group_t *g) {
+    mh_timer_t *mt = (mh_timer_t *)malloc(sizeof(*mt));
+    if (!mt) {
+        return TIMER_HANDLE_INVALID;
     }
-    memset(te, 0, sizeof(timer_entry_t));
+    memset(mt, 0, sizeof(*mt));
+    timer_entry_t *te = &mt->entry;
 
     te->handler = callback;
     te->time = current_time() + msec;
+    te->handle = handle_alloc(&handles, te);
+    if (te->handle == TIMER_HANDLE_INVALID) {
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
 
     if (0 != min_heap_push_(&min_heap, te)) {
+        handle_release(&handles, te->handle);
         free(te);
-        return NULL;
+        return TIMER_HANDLE_INVALID;
     }
+    timer_group_attach(g, &mt->group);
+    TIMER_PROBE_ADD(te->handle, te->time, te->time - msec);
     printf("add timer time = %u now = %u\n", te->time, current_time());
-    return te;
+    return te->handle;
+}
+
+timer_handle_t add_timer(uint32_t msec, timer_handler_pt callback) {
+    return add_group_timer(msec, callback, NULL);
+}
+
+// 句柄已失效（已触发或已取消）时直接返回 false
+bool del_timer(timer_handle_t h) {
+    timer_entry_t *e = (timer_entry_t *)handle_release(&handles, h);
+    if (!e) {
+        return false;
+    }
+    TIMER_PROBE_DEL(h, e->time);
+    timer_group_detach(&mh_timer_of(e)->group);
+    min_heap_erase_(&min_heap, e);
+    free(e);
+    return true;
 }
 
-bool del_timer(timer_entry_t *e) {
-    return 0 == min_heap_erase_(&min_heap, e);
+// 沿组链表逐个摘除，不按句柄查找；返回取消的个数，组在返回后为空，可以继续使用
+unsigned cancel_group(timer_group_t *g) {
+    timer_group_link_t *l;
+    unsigned n = 0;
+    while ((l = timer_group_pop(g)) != NULL) {
+        mh_timer_t *mt = timer_group_entry(l, mh_timer_t, group);
+        handle_release(&handles, mt->entry.handle);
+        TIMER_PROBE_DEL(mt->entry.handle, mt->entry.time);
+        min_heap_erase_(&min_heap, &mt->entry);
+        free(mt);
+        n++;
+    }
+    return n;
 }
 
+// 有积压（已到期但受预算限制还没触发）时返回 0
 int find_nearest_expire_timer() {
     timer_entry_t *te = min_heap_top_(&min_heap);
     if (!te) return -1;
@@ -70,16 +130,211 @@ int find_nearest_expire_timer() {
     return diff > 0 ? diff : 0;
 }
 
+// 每次 expire_timer 最多触发 max_count 个 / 最多占用 max_usec 微秒，0 表示不限
+void set_expire_budget(uint32_t max_count, uint32_t max_usec) {
+    budget.max_count = max_count;
+    budget.max_usec = max_usec;
+}
+
+const timer_budget_stat_t *expire_budget_stat() {
+    return &budget_stat;
+}
+
 void expire_timer() {
     uint32_t cur = current_time();
+    uint32_t fired = 0;
+    uint64_t start = budget.max_usec ? timer_budget_now_us() : 0;
+    budget_stat.backlog = false;
     for (;;) {
         timer_entry_t *te = min_heap_top_(&min_heap);
         if (!te) break;
         if (te->time > cur) break;
-        te->handler(te);
+        if (timer_budget_exhausted(&budget, fired, start)) {
+            // 剩下的留在堆里，下一轮 epoll_wait 立即返回后继续
+            budget_stat.exhausted++;
+            budget_stat.backlog = true;
+            budget_stat.backlog_lag_ms = cur - te->time;
+            break;
+        }
         min_heap_pop_(&min_heap);
+        handle_release(&handles, te->handle);
+        // 先离开组，回调里 cancel_group 不会再碰到它
+        timer_group_detach(&mh_timer_of(te)->group);
+        TIMER_PROBE_FIRE(te->handle, te->time, (int32_t)(cur - te->time));
+        if (te->handler) {
+            te->handler(te);
+        }
         free(te);
+        fired++;
+    }
+    budget_stat.fired += fired;
+}
+
+// 不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+// 和 add_timer / del_timer 在同一个线程调用，跨线程取需要调用者自己加锁
+unsigned expire_into(timer_expired_t *out, unsigned max, uint32_t now) {
+    unsigned n = 0;
+    while (n < max) {
+        timer_entry_t *te = min_heap_top_(&min_heap);
+        if (!te || te->time > now) break;
+        min_heap_pop_(&min_heap);
+        handle_release(&handles, te->handle);
+        timer_group_detach(&mh_timer_of(te)->group);
+        TIMER_PROBE_FIRE(te->handle, te->time, (int32_t)(now - te->time));
+        out[n].handle = te->handle;
+        out[n].expire = te->time;
+        free(te);
+        n++;
+    }
+    return n;
+}
+
+static unsigned
+count_expired(unsigned idx, uint32_t now) {
+    if (idx >= min_heap.n || min_heap_at(&min_heap, idx)->time > now) {
+        return 0;
+    }
+    return 1 + count_expired(2 * idx + 1, now) + count_expired(2 * idx + 2, now);
+}
+
+// 当前积压的已到期定时器个数，只遍历已到期的部分，按需调用
+unsigned expired_backlog() {
+    return count_expired(0, current_time());
+}
+
+static void idle_expired(timer_entry_t *te);
+
+// fd 放在 privdata 里，idle_expired 靠它找回槽位
+static timer_handle_t
+add_idle_timer(uint32_t msec, int fd) {
+    timer_handle_t h = add_timer(msec, idle_expired);
+    timer_entry_t *te = (timer_entry_t *)handle_get(&handles, h);
+    if (te) {
+        te->privdata = (void *)(intptr_t)fd;
+    }
+    return h;
+}
+
+static void
+idle_expired(timer_entry_t *te) {
+    int fd = (int)(intptr_t)te->privdata;
+    timer_idle_t *s = timer_idle_find(&idle_table, fd);
+    if (!s || s->timer != te->handle) {
+        return;
+    }
+    uint32_t remain = timer_idle_remain(s, current_time());
+    if (remain) {
+        // 期间有过活动，按剩余时间重挂；内存不足时当作空闲处理
+        s->timer = add_idle_timer(remain, fd);
+        if (s->timer != TIMER_HANDLE_INVALID) {
+            idle_table.stat.rearmed++;
+            return;
+        }
+    }
+    s->timeout = 0;
+    s->timer = TIMER_HANDLE_INVALID;
+    idle_table.stat.fired++;
+    s->handler(fd, s->ud);  // 回调里可以关闭 fd、重新 idle_watch
+}
+
+// 监视 fd 的空闲超时：msec 内没有 idle_touch 就回调 callback（只回调一次）；
+// 已经在监视时重新开始计时。成功返回 0
+int idle_watch(int fd, uint32_t msec, timer_idle_handler_pt callback, void *ud) {
+    timer_idle_t *s = timer_idle_slot(&idle_table, fd);
+    if (!s || !msec) {
+        return -1;
+    }
+    if (s->timeout) {
+        del_timer(s->timer);
+    }
+    s->timer = add_idle_timer(msec, fd);
+    if (s->timer == TIMER_HANDLE_INVALID) {
+        s->timeout = 0;
+        return -1;
+    }
+    s->last_active = current_time();
+    s->timeout = msec;
+    s->handler = callback;
+    s->ud = ud;
+    return 0;
+}
+
+// 收发数据时调用，只记时间，不动定时器
+static inline void idle_touch(int fd) {
+    timer_idle_touch(&idle_table, fd, current_time());
+}
+
+// 关闭连接前调用；没有在监视时返回 false
+bool idle_unwatch(int fd) {
+    timer_idle_t *s = timer_idle_find(&idle_table, fd);
+    if (!s) {
+        return false;
+    }
+    del_timer(s->timer);
+    s->timeout = 0;
+    s->timer = TIMER_HANDLE_INVALID;
+    return true;
+}
+
+const timer_idle_stat_t *idle_stat() {
+    return &idle_table.stat;
+}
+
+// 把所有未到期定时器写入快照：剩余时间、句柄、privdata（必须是值，不能是指针）
+int snapshot_timer(const char *path) {
+    timer_snapshot_t snap;
+    uint32_t now = current_time();
+    unsigned i;
+    if (timer_snapshot_create(&snap, path, min_heap.n, 0) < 0) {
+        return -1;
+    }
+    // 直接按堆数组的顺序写，恢复时 O(n) 建堆
+    for (i = 0; i < min_heap.n; i++) {
+        timer_entry_t *te = min_heap_at(&min_heap, i);
+        int32_t remain = (int32_t)(te->time - now);
+        snap.e[i].remain = remain > 0 ? remain : 0;
+        snap.e[i].handle = te->handle;
+        snap.e[i].payload = (uint64_t)(uintptr_t)te->privdata;
+    }
+    return timer_snapshot_close(&snap);
+}
+
+// 在 init_timer 之后、添加任何定时器之前调用；函数地址不进快照，恢复的定时器统一使用 callback
+// 返回恢复的个数，失败返回 -1
+int restore_timer(const char *path, timer_handler_pt callback) {
+    timer_snapshot_t snap;
+    uint64_t i;
+    if (timer_snapshot_open(&snap, path) < 0) {
+        return -1;
+    }
+    int64_t elapsed = timer_snapshot_elapsed(&snap);
+    uint32_t now = current_time();
+    if (min_heap_reserve_(&min_heap, snap.hdr->count) < 0) {
+        timer_snapshot_close(&snap);
+        return -1;
+    }
+    for (i = 0; i < snap.hdr->count; i++) {
+        mh_timer_t *mt = (mh_timer_t *)malloc(sizeof(*mt));
+        if (!mt) {
+            break;
+        }
+        timer_entry_t *te = &mt->entry;
+        timer_group_link_init(&mt->group);  // 组关系不进快照
+        te->time = timer_snapshot_rebase(&snap.e[i], elapsed, now);
+        te->handler = callback;
+        te->privdata = (void *)(uintptr_t)snap.e[i].payload;
+        te->handle = snap.e[i].handle;
+        if (handle_restore(&handles, te->handle, te) < 0) {
+            free(te); // 句柄重复，快照已损坏
+            continue;
+        }
+        min_heap_at(&min_heap, min_heap.n) = te;
+        min_heap.n++;
     }
+    handle_table_relink(&handles);
+    min_heap_heapify_(&min_heap);
+    timer_snapshot_close(&snap);
+    return (int)min_heap.n;
 }
 
 #endif
\ No newline at end of file
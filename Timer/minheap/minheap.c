@@ -3,12 +3,23 @@
 #define min_heap_elem_greater(a, b) \
     ((a)->time > (b)->time)
 
+#ifdef MIN_HEAP_SEGMENTED
+void min_heap_ctor_(min_heap_t* s) { s->seg = 0; s->nseg = s->segcap = 0; s->n = 0; s->a = 0; }
+void min_heap_dtor_(min_heap_t* s)
+{
+    uint32_t i;
+    for (i = 0; i < s->nseg; i++)
+        free(s->seg[i]);
+    free(s->seg);
+}
+#else
 void min_heap_ctor_(min_heap_t* s) { s->p = 0; s->n = 0; s->a = 0; }
 void min_heap_dtor_(min_heap_t* s) { if (s->p) free(s->p); }
+#endif
 void min_heap_elem_init_(timer_entry_t* e) { e->min_heap_idx = -1; }
 int min_heap_empty_(min_heap_t* s) { return 0u == s->n; }
 unsigned min_heap_size_(min_heap_t* s) { return s->n; }
-timer_entry_t* min_heap_top_(min_heap_t* s) { return s->n ? *s->p : 0; }
+timer_entry_t* min_heap_top_(min_heap_t* s) { return s->n ? min_heap_at(s, 0) : 0; }
 
 int min_heap_push_(min_heap_t* s, timer_entry_t* e)
 {
@@ -18,12 +29,22 @@ int min_heap_push_(min_heap_t* s, timer_entry_t* e)
     return 0;
 }
 
+void min_heap_heapify_(min_heap_t* s)
+{
+    unsigned i;
+    for (i = 0; i < s->n; i++)
+        min_heap_at(s, i)->min_heap_idx = i;
+    for (i = s->n / 2; i-- > 0; )
+        min_heap_shift_down_(s, i, min_heap_at(s, i));
+}
+
 timer_entry_t* min_heap_pop_(min_heap_t* s)
 {
     if (s->n)
     {
-        timer_entry_t* e = *s->p;
-        min_heap_shift_down_(s, 0u, s->p[--s->n]);
+        timer_entry_t* e = min_heap_at(s, 0);
+        s->n--;
+        min_heap_shift_down_(s, 0u, min_heap_at(s, s->n));
         e->min_heap_idx = -1;
         return e;
     }
@@ -39,14 +60,16 @@ int min_heap_erase_(min_heap_t* s, timer_entry_t* e)
 {
     if (-1 != e->min_heap_idx)
     {
-        timer_entry_t *last = s->p[--s->n];
+        timer_entry_t *last;
+        s->n--;
+        last = min_heap_at(s, s->n);
         unsigned parent = (e->min_heap_idx - 1) / 2;
         /* we replace e with the last element in the heap.  We might need to
            shift it upward if it is less than its parent, or downward if it is
            greater than one or both its children. Since the children are known
            to be less than the parent, it can't need to shift both up and
            down. */
-        if (e->min_heap_idx > 0 && min_heap_elem_greater(s->p[parent], last))
+        if (e->min_heap_idx > 0 && min_heap_elem_greater(min_heap_at(s, parent), last))
             min_heap_shift_up_unconditional_(s, e->min_heap_idx, last);
         else
             min_heap_shift_down_(s, e->min_heap_idx, last);
@@ -64,7 +87,7 @@ int min_heap_adjust_(min_heap_t *s, timer_entry_t *e)
         unsigned parent = (e->min_heap_idx - 1) / 2;
         /* The position of e has changed; we shift it up or down
          * as needed.  We can't need to do both. */
-        if (e->min_heap_idx > 0 && min_heap_elem_greater(s->p[parent], e))
+        if (e->min_heap_idx > 0 && min_heap_elem_greater(min_heap_at(s, parent), e))
             min_heap_shift_up_unconditional_(s, e->min_heap_idx, e);
         else
             min_heap_shift_down_(s, e->min_heap_idx, e);
@@ -72,6 +95,30 @@ int min_heap_adjust_(min_heap_t *s, timer_entry_t *e)
     }
 }
 
+#ifdef MIN_HEAP_SEGMENTED
+// 按段扩容：只有段目录会 realloc（1 亿个元素时不到 12KB），段本身不搬动
+int min_heap_reserve_(min_heap_t* s, unsigned n)
+{
+    while (s->a < n)
+    {
+        timer_entry_t **seg;
+        if (s->nseg == s->segcap)
+        {
+            timer_entry_t ***dir;
+            uint32_t cap = s->segcap ? s->segcap * 2 : 8;
+            if (!(dir = (timer_entry_t***)realloc(s->seg, cap * sizeof *dir)))
+                return -1;
+            s->seg = dir;
+            s->segcap = cap;
+        }
+        if (!(seg = (timer_entry_t**)malloc(MIN_HEAP_SEG_SIZE * sizeof *seg)))
+            return -1;
+        s->seg[s->nseg++] = seg;
+        s->a += MIN_HEAP_SEG_SIZE;
+    }
+    return 0;
+}
+#else
 int min_heap_reserve_(min_heap_t* s, unsigned n)
 {
     if (s->a < n)
@@ -87,29 +134,30 @@ int min_heap_reserve_(min_heap_t* s, unsigned n)
     }
     return 0;
 }
+#endif
 
 void min_heap_shift_up_unconditional_(min_heap_t* s, unsigned hole_index, timer_entry_t* e)
 {
     unsigned parent = (hole_index - 1) / 2;
     do
     {
-    (s->p[hole_index] = s->p[parent])->min_heap_idx = hole_index;
+    (min_heap_at(s, hole_index) = min_heap_at(s, parent))->min_heap_idx = hole_index;
     hole_index = parent;
     parent = (hole_index - 1) / 2;
-    } while (hole_index && min_heap_elem_greater(s->p[parent], e));
-    (s->p[hole_index] = e)->min_heap_idx = hole_index;
+    } while (hole_index && min_heap_elem_greater(min_heap_at(s, parent), e));
+    (min_heap_at(s, hole_index) = e)->min_heap_idx = hole_index;
 }
 
 void min_heap_shift_up_(min_heap_t* s, unsigned hole_index, timer_entry_t* e)
 {
     unsigned parent = (hole_index - 1) / 2;
-    while (hole_index && min_heap_elem_greater(s->p[parent], e))
+    while (hole_index && min_heap_elem_greater(min_heap_at(s, parent), e))
     {
-    (s->p[hole_index] = s->p[parent])->min_heap_idx = hole_index;
+    (min_heap_at(s, hole_index) = min_heap_at(s, parent))->min_heap_idx = hole_index;
     hole_index = parent;
     parent = (hole_index - 1) / 2;
     }
-    (s->p[hole_index] = e)->min_heap_idx = hole_index;
+    (min_heap_at(s, hole_index) = e)->min_heap_idx = hole_index;
 }
 
 void min_heap_shift_down_(min_heap_t* s, unsigned hole_index, timer_entry_t* e)
@@ -117,12 +165,12 @@ void min_heap_shift_down_(min_heap_t* s, unsigned hole_index, timer_entry_t* e)
     unsigned min_child = 2 * (hole_index + 1);
     while (min_child <= s->n)
     {
-    min_child -= min_child == s->n || min_heap_elem_greater(s->p[min_child], s->p[min_child - 1]);
-    if (!(min_heap_elem_greater(e, s->p[min_child])))
+    min_child -= min_child == s->n || min_heap_elem_greater(min_heap_at(s, min_child), min_heap_at(s, min_child - 1));
+    if (!(min_heap_elem_greater(e, min_heap_at(s, min_child))))
         break;
-    (s->p[hole_index] = s->p[min_child])->min_heap_idx = hole_index;
+    (min_heap_at(s, hole_index) = min_heap_at(s, min_child))->min_heap_idx = hole_index;
     hole_index = min_child;
     min_child = 2 * (hole_index + 1);
     }
-    (s->p[hole_index] = e)->min_heap_idx = hole_index;
+    (min_heap_at(s, hole_index) = e)->min_heap_idx = hole_index;
 }
\ No newline at end of file
@@ -12,13 +12,42 @@ struct timer_entry_s {
     uint32_t min_heap_idx;
     timer_handler_pt handler;
     void *privdata;
+    uint64_t handle;  // 定时器句柄，见 timer_handle.h
 };
 
+/*
+ * 定义 MIN_HEAP_SEGMENTED 时堆数组由固定大小的段组成（每段 2^MIN_HEAP_SEG_SHIFT 个指针），
+ * 扩容只分配新段、段目录按倍数增长，已有元素不搬动：几千万定时器时不会有一次 push
+ * realloc 拷贝几百 MB 卡住循环，峰值内存也不会短暂翻倍。代价是每次访问多一次查段目录。
+ * 下标 min_heap_idx 的含义不变，元素统一用 min_heap_at(s, i) 访问（是左值，i 会求值两次，不要带 ++/--）。
+ */
+#ifdef MIN_HEAP_SEGMENTED
+
+#ifndef MIN_HEAP_SEG_SHIFT
+#define MIN_HEAP_SEG_SHIFT 16
+#endif
+#define MIN_HEAP_SEG_SIZE (1u << MIN_HEAP_SEG_SHIFT)
+#define MIN_HEAP_SEG_MASK (MIN_HEAP_SEG_SIZE - 1)
+
+typedef struct min_heap {
+    timer_entry_t ***seg;   // 段目录
+    uint32_t nseg, segcap;  // 已分配的段数、目录容量
+    uint32_t n, a; // n 为实际元素个数  a 为容量（nseg 个段）
+} min_heap_t;
+
+#define min_heap_at(s, i) ((s)->seg[(uint32_t)(i) >> MIN_HEAP_SEG_SHIFT][(uint32_t)(i) & MIN_HEAP_SEG_MASK])
+
+#else
+
 typedef struct min_heap {
     timer_entry_t **p;
     uint32_t n, a; // n 为实际元素个数  a 为容量
 } min_heap_t;
 
+#define min_heap_at(s, i) ((s)->p[i])
+
+#endif
+
 void            min_heap_ctor_(min_heap_t* s);
 void            min_heap_dtor_(min_heap_t* s);
 void            min_heap_elem_init_(timer_entry_t* e);
@@ -28,6 +57,8 @@ unsigned        min_heap_size_(min_heap_t* s);
 timer_entry_t*  min_heap_top_(min_heap_t* s);
 int             min_heap_reserve_(min_heap_t* s, unsigned n);
 int             min_heap_push_(min_heap_t* s, timer_entry_t* e);
+// 批量建堆：调用者先 reserve，再把元素放进 min_heap_at(s, 0..s->n)，O(n) 自底向上调整
+void            min_heap_heapify_(min_heap_t* s);
 timer_entry_t*  min_heap_pop_(min_heap_t* s);
 int             min_heap_adjust_(min_heap_t *s, timer_entry_t* e);
 int             min_heap_erase_(min_heap_t* s, timer_entry_t* e);
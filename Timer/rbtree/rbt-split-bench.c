@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rbtree.h"
+
+/*
+ * 同一到期时间的突发：树里先有 n 个随机到期的定时器（默认 100 万，参数可改），
+ * 再加 k 个到期时间相同、比它们都早的定时器，比较两种取出方式：
+ *   - delete：expire_timer 原来的做法，每次 ngx_rbtree_min + ngx_rbtree_delete，O(k log n)；
+ *   - split ：ngx_rbtree_split_timer 一次切下来，O(k + log n)。
+ * 同时检查取出的个数和剩下的树的黑高。
+ */
+
+#define ROUNDS 5
+
+static ngx_rbtree_node_t sentinel;
+
+static double
+now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 返回黑高，不平衡返回 -1
+static int
+black_height(ngx_rbtree_node_t *node) {
+    if (node == &sentinel) {
+        return 0;
+    }
+    int l = black_height(node->left);
+    int r = black_height(node->right);
+    if (l < 0 || l != r || (ngx_rbt_is_red(node) && (ngx_rbt_is_red(node->left) || ngx_rbt_is_red(node->right)))) {
+        return -1;
+    }
+    return l + ngx_rbt_is_black(node);
+}
+
+static void
+fill(ngx_rbtree_t *tree, ngx_rbtree_node_t *nodes, size_t n, ngx_rbtree_node_t *burst, size_t k) {
+    size_t i;
+    ngx_rbtree_init(tree, &sentinel, ngx_rbtree_insert_timer_value);
+    srand(1);
+    for (i = 0; i < n; i++) {
+        nodes[i].key = 1000 + rand() % 3600000;
+        ngx_rbtree_insert(tree, &nodes[i]);
+    }
+    for (i = 0; i < k; i++) {
+        burst[i].key = 500;
+        ngx_rbtree_insert(tree, &burst[i]);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    static const size_t ks[] = {1, 100, 10000, 100000, 1000000};
+    ngx_rbtree_node_t *nodes = malloc(n * sizeof(*nodes));
+    ngx_rbtree_node_t *burst = malloc(ks[sizeof(ks) / sizeof(ks[0]) - 1] * sizeof(*burst));
+    ngx_rbtree_t tree;
+    size_t j, got;
+    int ok = 1;
+
+    printf("%zu background timers, burst of k timers with the same deadline (ns per expired timer)\n", n);
+    printf("  %8s %10s %10s %8s\n", "k", "delete", "split", "speedup");
+    for (j = 0; j < sizeof(ks) / sizeof(ks[0]); j++) {
+        size_t k = ks[j];
+        double del = 0, split = 0;
+        int r;
+        for (r = 0; r < ROUNDS; r++) {
+            fill(&tree, nodes, n, burst, k);
+            double t0 = now_ns();
+            got = 0;
+            while (tree.root != &sentinel) {
+                ngx_rbtree_node_t *node = ngx_rbtree_min(tree.root, &sentinel);
+                if (node->key > 500) {
+                    break;
+                }
+                ngx_rbtree_delete(&tree, node);
+                got++;
+            }
+            del += now_ns() - t0;
+            ok = ok && got == k;
+
+            fill(&tree, nodes, n, burst, k);
+            t0 = now_ns();
+            got = 0;
+            for (ngx_rbtree_node_t *node = ngx_rbtree_split_timer(&tree, 500); node; node = node->right) {
+                got++;
+            }
+            split += now_ns() - t0;
+            ok = ok && got == k && black_height(tree.root) > 0;
+        }
+        printf("  %8zu %10.1f %10.1f %7.1fx\n", k, del / ROUNDS / k, split / ROUNDS / k, del / split);
+    }
+    free(nodes);
+    free(burst);
+    printf(ok ? "check ok\n" : "check FAILED\n");
+    return !ok;
+}
+
+// gcc -O2 rbt-split-bench.c rbtree.c -o rbt-split-bench -I./
@@ -16,6 +16,18 @@ int main()
     add_timer(3000, hello_world);
     add_timer(3000, hello_world);
 
+    timer_handle_t h = add_timer(2500, hello_world);
+    del_timer(h);
+    del_timer(h);  // 句柄已失效，重复取消是空操作
+
+    // 一个连接的空闲、写超时、保活定时器放在同一组，关闭连接时一次取消
+    timer_group_t conn;
+    timer_group_init(&conn);
+    add_group_timer(1500, hello_world, &conn);
+    add_group_timer(1800, hello_world, &conn);
+    add_group_timer(2200, hello_world, &conn);
+    printf("cancel_group: %u timers\n", cancel_group(&conn));
+
     int epfd = epoll_create(1);
     struct epoll_event events[512];
 
@@ -30,4 +42,4 @@ int main()
     return 0;
 }
 
-// gcc rbt-timer.c rbtree.c -o rbt -I./
\ No newline at end of file
+// gcc rbt-timer.c rbtree.c -o rbt -I./ -I../common
\ No newline at end of file
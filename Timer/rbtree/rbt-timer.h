@@ -6,6 +6,7 @@
 #include<string.h>
 #include<unistd.h> // 包含 Unix 标准库，提供了 usleep 等函数
 #include<stdlib.h>
+#include<stdbool.h>
 #include<stddef.h>  // 包含标准库，提供了 offsetof 宏，用于计算结构体成员的偏移量
 
 // 如果是苹果系统
@@ -24,11 +25,22 @@
 #endif
 
 #include"rbtree.h"
+#include"timer_handle.h"
+#include"timer_snapshot.h"
+#include"timer_budget.h"
+#include"timer_group.h"
+#include"timer_expired.h"
+#include"timer_probe.h"
 
 //定义一个红黑树对象，用于管理定时器
 ngx_rbtree_t timer;
 //定义一个红黑树的哨兵节点，用于表示红黑树的边界
 static ngx_rbtree_node_t sentinel;
+//定时器句柄的槽位表，del_timer 通过句柄找到节点
+static handle_table_t handles;
+//每次 expire_timer 的触发预算，默认不限，以及积压统计
+static timer_budget_t budget;
+static timer_budget_stat_t budget_stat;
 
 // 1. 前置声明结构体
 struct timer_entry_s;
@@ -40,11 +52,19 @@ typedef void (*timer_handler_pt)(struct timer_entry_s *ev);
 struct timer_entry_s {
     ngx_rbtree_node_t rbnode;
     timer_handler_pt handler; // 现在合法
+    timer_handle_t handle;    // 定时器句柄
+    timer_group_link_t group; // 所属的定时器组，见 timer_group.h
 };
 
 // 4. 定义别名
 typedef struct timer_entry_s timer_entry_t;
 
+// rbnode.data 记录节点状态：批量触发时整段切下来的节点已经不在树上，
+// 回调里 del_timer / cancel_group 同一批还没触发的定时器时只打标记，由触发循环释放
+#define RBT_IN_TREE   0
+#define RBT_DETACHED  1
+#define RBT_CANCELLED 2
+
 // 获取当前时间的函数，返回值为毫秒级时间
 static uint32_t
 current_time() {
@@ -75,37 +95,90 @@ current_time() {
  ngx_rbtree_t *init_timer(){
     //初始化红黑树，传入红黑树对象、哨兵节点以及插入函数
     ngx_rbtree_init(&timer ,&sentinel,ngx_rbtree_insert_timer_value);
+    handle_table_init(&handles);
     return &timer;
 }
 
-// 向定时器红黑树中添加一个定时器的函数
- timer_entry_t* add_timer(uint32_t msec, timer_handler_pt func) {
+// 向定时器红黑树中添加一个定时器并挂到组 g 里（g 为 NULL 不入组），返回定时器句柄
+ timer_handle_t add_group_timer(uint32_t msec, timer_handler_pt func, timer_group_t *g) {
     // 分配定时器条目结构体的内存
     timer_entry_t *te = (timer_entry_t *)malloc(sizeof(timer_entry_t));
+    if (!te) {
+        return TIMER_HANDLE_INVALID;
+    }
     // 将分配的内存清零
     memset(te, 0, sizeof(timer_entry_t));
     // 设置定时器处理函数
     te->handler = func;
+    // 分配句柄，槽位表记录句柄到节点的映射
+    te->handle = handle_alloc(&handles, te);
+    if (te->handle == TIMER_HANDLE_INVALID) {
+        free(te);
+        return TIMER_HANDLE_INVALID;
+    }
     // 计算定时器的到期时间，为当前时间加上指定的毫秒数
-    msec += current_time();
+    uint32_t now = current_time();
+    msec += now;
     // 打印定时器的到期时间
     printf("add_timer expire at msec = %u\n", msec);
     // 设置红黑树节点的键为定时器的到期时间
     te->rbnode.key = msec;
     // 将定时器条目插入红黑树
     ngx_rbtree_insert(&timer, &te->rbnode);
-    return te;
+    // 挂到组链表尾部，关闭连接时 cancel_group 沿链表取消
+    timer_group_attach(g, &te->group);
+    // 探针：句柄、到期时间、当前时间
+    TIMER_PROBE_ADD(te->handle, msec, now);
+    return te->handle;
+}
+
+// 向定时器红黑树中添加一个定时器的函数，返回定时器句柄
+ timer_handle_t add_timer(uint32_t msec, timer_handler_pt func) {
+    return add_group_timer(msec, func, NULL);
 }
 
-//从当前定时器红黑树中删除一个定时器函数
- void del_timer(timer_entry_t *te){
+//从当前定时器红黑树中删除一个定时器函数，句柄已失效（已触发或已取消）时为空操作
+ bool del_timer(timer_handle_t h){
+    //释放句柄，同时取回节点；旧句柄的代数对不上，直接返回
+    timer_entry_t *te = (timer_entry_t *)handle_release(&handles, h);
+    if (!te) {
+        return false;
+    }
+    TIMER_PROBE_DEL(h, te->rbnode.key);
+    //离开所属的组
+    timer_group_detach(&te->group);
+    //已经切下来等待触发，留给触发循环释放
+    if(te->rbnode.data == RBT_DETACHED){
+        te->rbnode.data = RBT_CANCELLED;
+        return true;
+    }
     //从红黑树中删除定时器条目中对应的红黑树节点
     ngx_rbtree_delete(&timer,&te->rbnode);
     //释放定时器条目结构体
     free(te);
+    return true;
+}
+
+//取消组里的所有定时器：沿组链表逐个摘下节点直接删除，不按句柄查找，返回取消的个数
+ unsigned cancel_group(timer_group_t *g){
+    timer_group_link_t *l;
+    unsigned n = 0;
+    while((l = timer_group_pop(g)) != NULL){
+        timer_entry_t *te = timer_group_entry(l, timer_entry_t, group);
+        handle_release(&handles, te->handle);
+        TIMER_PROBE_DEL(te->handle, te->rbnode.key);
+        n++;
+        if(te->rbnode.data == RBT_DETACHED){
+            te->rbnode.data = RBT_CANCELLED;
+            continue;
+        }
+        ngx_rbtree_delete(&timer, &te->rbnode);
+        free(te);
+    }
+    return n;
 }
 
-//查找最近到期的定时器的函数，返回距离最近到期定时器的时间差（ms)
+//查找最近到期的定时器的函数，返回距离最近到期定时器的时间差（ms)，有积压时返回 0
  int find_nearest_expire_timer(){
     ngx_rbtree_node_t *node;
     //如果红黑树根节点是哨兵节点，说明红黑树为空
@@ -120,15 +193,68 @@ current_time() {
     return diff > 0 ? diff : 0;
 }
 
-//处理到期定时器的函数
+//设置每次 expire_timer 最多触发的个数 / 最多占用的微秒数，0 表示不限
+ void set_expire_budget(uint32_t max_count, uint32_t max_usec){
+    budget.max_count = max_count;
+    budget.max_usec = max_usec;
+}
+
+ const timer_budget_stat_t *expire_budget_stat(){
+    return &budget_stat;
+}
+
+//不限预算时把到期的定时器一次切下来再逐个触发：O(k + log n)，逐个 delete 是 O(k log n)；
+//回调里新加的已到期定时器留到下一轮
+static uint32_t
+expire_split(uint32_t now){
+    ngx_rbtree_node_t *node, *next, *expired;
+    timer_entry_t *te;
+    uint32_t fired = 0;
+    expired = ngx_rbtree_split_timer(&timer, now);
+    //先全部标记，回调里取消同一批的其他定时器时不会去动树
+    for(node = expired; node; node = node->right){
+        node->data = RBT_DETACHED;
+    }
+    for(node = expired; node; node = next){
+        next = node->right;
+        te = (timer_entry_t *) ((char *) node - offsetof(timer_entry_t, rbnode));
+        if(node->data == RBT_CANCELLED){
+            free(te);
+            continue;
+        }
+        printf("touch timer expire time=%u, now = %u\n", node->key, now);
+        handle_release(&handles, te->handle);
+        timer_group_detach(&te->group);
+        TIMER_PROBE_FIRE(te->handle, node->key, (int32_t)(now - node->key));
+        if(te->handler){
+            te->handler(te);
+        }
+        free(te);
+        fired++;
+    }
+    return fired;
+}
+
+//处理到期定时器的函数，预算用完时剩下的到期定时器留在树里
  void expire_timer(){
     timer_entry_t *te;
-    ngx_rbtree_node_t *sentinel,*root,*node;
+    ngx_rbtree_node_t *sentinel,*root,*node,*next;
+    uint32_t fired = 0;
+    uint64_t start = budget.max_usec ? timer_budget_now_us() : 0;
     //获取红黑树的哨兵节点
     sentinel = timer.sentinel;
     //获取当前时间
     uint32_t now = current_time();
-    //循环处理到期的定时器
+    budget_stat.backlog = false;
+    //不限预算且至少两个到期时整段切下来；只有一个时切分的 join 比直接删还慢，走下面的循环
+    if(!budget.max_count && !budget.max_usec && timer.root != sentinel){
+        node = ngx_rbtree_min(timer.root, sentinel);
+        if(node->key <= now && (next = ngx_rbtree_next(&timer, node)) != NULL && next->key <= now){
+            budget_stat.fired += expire_split(now);
+            return;
+        }
+    }
+    //逐个处理到期的定时器
     for(;;){
         //获取红黑树的根节点
         root = timer.root;
@@ -138,17 +264,147 @@ current_time() {
         node = ngx_rbtree_min(root,sentinel);
         //如果最近到期的定时器还没有到期，退出循环
         if(node->key > now) break;
+        //预算用完，记下积压情况，留给下一轮
+        if(timer_budget_exhausted(&budget, fired, start)){
+            budget_stat.exhausted++;
+            budget_stat.backlog = true;
+            budget_stat.backlog_lag_ms = now - node->key;
+            break;
+        }
         // 打印定时器的到期时间和当前时间
         printf("touch timer expire time=%u, now = %u\n", node->key, now);
         // 根据红黑树节点的地址和偏移量计算定时器条目结构体的地址
         te = (timer_entry_t *) ((char *) node - offsetof(timer_entry_t, rbnode));
-        //调用定时处理函数
-        te->handler(te);
+        // 句柄先失效，回调里再 del_timer 自己是空操作
+        handle_release(&handles, te->handle);
+        // 先离开组，回调里 cancel_group 不会再碰到它
+        timer_group_detach(&te->group);
+        // 探针：句柄、到期时间、触发延迟
+        TIMER_PROBE_FIRE(te->handle, node->key, (int32_t)(now - node->key));
+        //调用定时处理函数，只批量取的定时器没有回调
+        if(te->handler){
+            te->handler(te);
+        }
         // 从红黑树中删除定时器条目对应的红黑树节点
         ngx_rbtree_delete(&timer, &te->rbnode);
         // 释放定时器条目结构体的内存
         free(te);
+        fired++;
     }
+    budget_stat.fired += fired;
 }
 
-#endif
\ No newline at end of file
+//不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+//和 add_timer / del_timer 在同一个线程调用，跨线程取需要调用者自己加锁
+ unsigned expire_into(timer_expired_t *out, unsigned max, uint32_t now){
+    ngx_rbtree_node_t *node;
+    unsigned n = 0;
+    while(n < max && timer.root != timer.sentinel){
+        node = ngx_rbtree_min(timer.root, timer.sentinel);
+        if(node->key > now) break;
+        timer_entry_t *te = (timer_entry_t *) ((char *) node - offsetof(timer_entry_t, rbnode));
+        ngx_rbtree_delete(&timer, node);
+        handle_release(&handles, te->handle);
+        timer_group_detach(&te->group);
+        TIMER_PROBE_FIRE(te->handle, node->key, (int32_t)(now - node->key));
+        out[n].handle = te->handle;
+        out[n].expire = node->key;
+        free(te);
+        n++;
+    }
+    return n;
+}
+
+//当前积压的已到期定时器个数，从最小节点往后数，按需调用
+ unsigned expired_backlog(){
+    ngx_rbtree_node_t *node;
+    unsigned n = 0;
+    uint32_t now = current_time();
+    if(timer.root == timer.sentinel){
+        return 0;
+    }
+    for(node = ngx_rbtree_min(timer.root, timer.sentinel); node && node->key <= now; node = ngx_rbtree_next(&timer, node)){
+        n++;
+    }
+    return n;
+}
+
+//把所有未到期定时器写入快照，中序遍历写出，记录天然按到期时间升序
+ int snapshot_timer(const char *path){
+    timer_snapshot_t snap;
+    ngx_rbtree_node_t *node;
+    uint64_t n = 0, i = 0;
+    uint32_t now = current_time();
+    //先数一遍节点个数，红黑树本身不记录大小
+    if(timer.root != timer.sentinel){
+        for(node = ngx_rbtree_min(timer.root, timer.sentinel); node; node = ngx_rbtree_next(&timer, node)){
+            n++;
+        }
+    }
+    if(timer_snapshot_create(&snap, path, n, TIMER_SNAPSHOT_SORTED) < 0){
+        return -1;
+    }
+    if(n){
+        for(node = ngx_rbtree_min(timer.root, timer.sentinel); node; node = ngx_rbtree_next(&timer, node)){
+            timer_entry_t *te = (timer_entry_t *) ((char *) node - offsetof(timer_entry_t, rbnode));
+            int32_t remain = (int32_t)(node->key - now);
+            snap.e[i].remain = remain > 0 ? remain : 0;
+            snap.e[i].handle = te->handle;
+            snap.e[i].payload = 0;
+            i++;
+        }
+    }
+    return timer_snapshot_close(&snap);
+}
+
+static int
+rbt_node_cmp(const void *a, const void *b){
+    ngx_rbtree_key_t ka = (*(ngx_rbtree_node_t * const *)a)->key;
+    ngx_rbtree_key_t kb = (*(ngx_rbtree_node_t * const *)b)->key;
+    return (ngx_rbtree_key_int_t)(ka - kb) < 0 ? -1 : ka != kb;
+}
+
+//在 init_timer 之后、添加任何定时器之前调用，恢复的定时器统一使用 func；
+//有序快照直接 O(n) 建树，否则先排序。返回恢复的个数，失败返回 -1
+ int restore_timer(const char *path, timer_handler_pt func){
+    timer_snapshot_t snap;
+    uint64_t i, n = 0;
+    if(timer_snapshot_open(&snap, path) < 0){
+        return -1;
+    }
+    int64_t elapsed = timer_snapshot_elapsed(&snap);
+    uint32_t now = current_time();
+    ngx_rbtree_node_t **nodes = (ngx_rbtree_node_t **)malloc((snap.hdr->count + 1) * sizeof(*nodes));
+    if(!nodes){
+        timer_snapshot_close(&snap);
+        return -1;
+    }
+    for(i = 0; i < snap.hdr->count; i++){
+        timer_entry_t *te = (timer_entry_t *)malloc(sizeof(timer_entry_t));
+        if(!te){
+            break;
+        }
+        te->handler = func;
+        te->handle = snap.e[i].handle;
+        te->rbnode.key = timer_snapshot_rebase(&snap.e[i], elapsed, now);
+        te->rbnode.data = 0;
+        //组关系不进快照
+        timer_group_link_init(&te->group);
+        //句柄重复说明快照已损坏，丢弃这一条
+        if(handle_restore(&handles, te->handle, te) < 0){
+            free(te);
+            continue;
+        }
+        nodes[n++] = &te->rbnode;
+    }
+    handle_table_relink(&handles);
+    if(!(snap.hdr->flags & TIMER_SNAPSHOT_SORTED)){
+        qsort(nodes, n, sizeof(*nodes), rbt_node_cmp);
+    }
+    ngx_rbtree_build(&timer, nodes, n);
+    free(nodes);
+    timer_snapshot_close(&snap);
+    return (int)n;
+}
+
+#endif
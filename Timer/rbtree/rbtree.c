@@ -18,12 +18,14 @@
      ngx_rbtree_node_t *sentinel, ngx_rbtree_node_t *node);
  static inline void ngx_rbtree_right_rotate(ngx_rbtree_node_t **root,
      ngx_rbtree_node_t *sentinel, ngx_rbtree_node_t *node);
+ static void ngx_rbtree_insert_fixup(ngx_rbtree_node_t **root,
+     ngx_rbtree_node_t *sentinel, ngx_rbtree_node_t *node);
  
  
  void
  ngx_rbtree_insert(ngx_rbtree_t *tree, ngx_rbtree_node_t *node)
  {
-     ngx_rbtree_node_t  **root, *temp, *sentinel;
+     ngx_rbtree_node_t  **root, *sentinel;
  
      /* a binary tree insert */
  
@@ -45,6 +47,20 @@
  
      /* re-balance tree */
  
+     ngx_rbtree_insert_fixup(root, sentinel, node);
+ 
+     ngx_rbt_black(*root);
+ }
+ 
+ 
+ /* 新插入的红节点 node 和父节点都是红色时向上修复，根的颜色由调用者处理 */
+ 
+ static void
+ ngx_rbtree_insert_fixup(ngx_rbtree_node_t **root, ngx_rbtree_node_t *sentinel,
+     ngx_rbtree_node_t *node)
+ {
+     ngx_rbtree_node_t  *temp;
+ 
      while (node != *root && ngx_rbt_is_red(node->parent)) {
  
          if (node->parent == node->parent->parent->left) {
@@ -88,8 +104,6 @@
              }
          }
      }
- 
-     ngx_rbt_black(*root);
  }
  
  
@@ -406,4 +420,266 @@
          node = parent;
      }
  }
- 
\ No newline at end of file
+ 
+
+
+ /*
+  * 由按 key 升序排列的节点数组 O(n) 建树：每次取中点作为子树根，
+  * 叶子深度最多相差 1；前 floor(log2(n + 1)) 层是满的，涂黑，
+  * 最后一层不满的节点涂红，每条路径上的黑节点数相同。
+  */
+
+ static ngx_rbtree_node_t *
+ ngx_rbtree_build_range(ngx_rbtree_node_t **nodes, ngx_uint_t lo, ngx_uint_t hi,
+     ngx_uint_t depth, ngx_uint_t black_depth, ngx_rbtree_node_t *parent,
+     ngx_rbtree_node_t *sentinel)
+ {
+     ngx_uint_t          mid;
+     ngx_rbtree_node_t  *node;
+
+     if (lo >= hi) {
+         return sentinel;
+     }
+
+     mid = lo + (hi - lo) / 2;
+     node = nodes[mid];
+     node->parent = parent;
+
+     if (depth < black_depth) {
+         ngx_rbt_black(node);
+
+     } else {
+         ngx_rbt_red(node);
+     }
+
+     node->left = ngx_rbtree_build_range(nodes, lo, mid, depth + 1,
+                                         black_depth, node, sentinel);
+     node->right = ngx_rbtree_build_range(nodes, mid + 1, hi, depth + 1,
+                                          black_depth, node, sentinel);
+
+     return node;
+ }
+
+
+ void
+ ngx_rbtree_build(ngx_rbtree_t *tree, ngx_rbtree_node_t **nodes, ngx_uint_t n)
+ {
+     ngx_uint_t  black_depth;
+
+     black_depth = 0;
+
+     while ((2u << black_depth) - 1 <= n) {
+         black_depth++;
+     }
+
+     tree->root = ngx_rbtree_build_range(nodes, 0, n, 0, black_depth, NULL,
+                                         tree->sentinel);
+ }
+
+
+
+ /*
+  * 按 key 切分：Tarjan 的 split，沿查找路径往下走，路径上 key 不大于切分点的节点
+  * 连同左子树按序摘下；大于切分点的节点连同右子树留下，自底向上两两 join
+  * 成剩余的树。各次 join 的代价是两边黑高之差，沿路径求和是 O(log n)，
+  * 摘下 k 个节点总共 O(k + log n)。
+  */
+
+ #define NGX_RBTREE_MAX_HEIGHT  128
+
+
+ /* 中序把子树接到 *tail 后面，用 right 串起来 */
+
+ static void
+ ngx_rbtree_flatten(ngx_rbtree_node_t *node, ngx_rbtree_node_t *sentinel,
+     ngx_rbtree_node_t ***tail)
+ {
+     ngx_rbtree_node_t  *right;
+
+     while (node != sentinel) {
+         ngx_rbtree_flatten(node->left, sentinel, tail);
+
+         right = node->right;
+         node->left = NULL;
+         node->parent = NULL;
+         **tail = node;
+         *tail = &node->right;
+
+         node = right;
+     }
+ }
+
+
+ /*
+  * left 中的 key 都不大于 node，right 中的都不小于 node，lbh / rbh 是两棵树的黑高
+  * （从根到叶子路径上的黑节点数，不含哨兵）。返回接好的树，*bh 为新的黑高。
+  * 黑高高的一侧沿边界往下找到和另一侧黑高相同的黑节点，用红色的 node 替换它，
+  * 再按插入的方式修复，只动边界上的 O(|lbh - rbh|) 个节点。
+  */
+
+ static ngx_rbtree_node_t *
+ ngx_rbtree_join(ngx_rbtree_node_t *left, ngx_uint_t lbh,
+     ngx_rbtree_node_t *node, ngx_rbtree_node_t *right, ngx_uint_t rbh,
+     ngx_rbtree_node_t *sentinel, ngx_uint_t *bh)
+ {
+     ngx_uint_t          h;
+     ngx_rbtree_node_t  *root, *temp, *parent;
+
+     /* 切下来的子树的根可能是红的，涂黑后黑高加一 */
+
+     if (ngx_rbt_is_red(left)) {
+         ngx_rbt_black(left);
+         lbh++;
+     }
+
+     if (ngx_rbt_is_red(right)) {
+         ngx_rbt_black(right);
+         rbh++;
+     }
+
+     if (lbh == rbh) {
+         node->left = left;
+         node->right = right;
+         node->parent = NULL;
+         ngx_rbt_black(node);
+
+         if (left != sentinel) {
+             left->parent = node;
+         }
+
+         if (right != sentinel) {
+             right->parent = node;
+         }
+
+         *bh = lbh + 1;
+
+         return node;
+     }
+
+     parent = NULL;
+
+     if (lbh > rbh) {
+         root = left;
+         temp = left;
+         h = lbh;
+
+         while (ngx_rbt_is_red(temp) || h != rbh) {
+             h -= ngx_rbt_is_black(temp);
+             parent = temp;
+             temp = temp->right;
+         }
+
+         parent->right = node;
+         node->left = temp;
+         node->right = right;
+         h = lbh;
+
+     } else {
+         root = right;
+         temp = right;
+         h = rbh;
+
+         while (ngx_rbt_is_red(temp) || h != lbh) {
+             h -= ngx_rbt_is_black(temp);
+             parent = temp;
+             temp = temp->left;
+         }
+
+         parent->left = node;
+         node->left = left;
+         node->right = temp;
+         h = rbh;
+     }
+
+     node->parent = parent;
+     ngx_rbt_red(node);
+
+     if (node->left != sentinel) {
+         node->left->parent = node;
+     }
+
+     if (node->right != sentinel) {
+         node->right->parent = node;
+     }
+
+     ngx_rbtree_insert_fixup(&root, sentinel, node);
+
+     if (ngx_rbt_is_red(root)) {
+         ngx_rbt_black(root);
+         h++;
+     }
+
+     root->parent = NULL;
+     *bh = h;
+
+     return root;
+ }
+
+
+ ngx_rbtree_node_t *
+ ngx_rbtree_split_timer(ngx_rbtree_t *tree, ngx_rbtree_key_t key)
+ {
+     ngx_uint_t           bh, rbh, n;
+     ngx_rbtree_node_t   *node, *next, *sentinel, *head, **tail;
+     ngx_rbtree_node_t   *keep[NGX_RBTREE_MAX_HEIGHT];
+     ngx_uint_t           keep_bh[NGX_RBTREE_MAX_HEIGHT];
+
+     sentinel = tree->sentinel;
+     head = NULL;
+     tail = &head;
+
+     bh = 0;
+
+     for (node = tree->root; node != sentinel; node = node->left) {
+         bh += ngx_rbt_is_black(node);
+     }
+
+     n = 0;
+     node = tree->root;
+
+     while (node != sentinel) {
+
+         /* node 的子树的黑高 */
+         rbh = bh - ngx_rbt_is_black(node);
+
+         /* node->key <= key，和 ngx_rbtree_insert_timer_value 一样考虑回绕 */
+
+         if ((ngx_rbtree_key_int_t) (node->key - key) <= 0) {
+             next = node->right;
+
+             ngx_rbtree_flatten(node->left, sentinel, &tail);
+
+             node->left = NULL;
+             node->parent = NULL;
+             *tail = node;
+             tail = &node->right;
+
+             node = next;
+
+         } else {
+             keep[n] = node;
+             keep_bh[n] = rbh;
+             n++;
+
+             node = node->left;
+         }
+
+         bh = rbh;
+     }
+
+     *tail = NULL;
+
+     /* 留下的节点自底向上 join，越深的 key 越小 */
+
+     node = sentinel;
+     bh = 0;
+
+     while (n--) {
+         node = ngx_rbtree_join(node, bh, keep[n], keep[n]->right, keep_bh[n],
+                                sentinel, &bh);
+     }
+
+     tree->root = node;
+
+     return head;
+ }
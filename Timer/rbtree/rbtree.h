@@ -57,10 +57,21 @@
  ngx_rbtree_insert_timer_value(ngx_rbtree_node_t *root,
      ngx_rbtree_node_t *node, ngx_rbtree_node_t *sentinel);
  
+ /* 用按 key 升序排列的节点批量建树，tree 必须为空 */
+ void
+ ngx_rbtree_build(ngx_rbtree_t *tree, ngx_rbtree_node_t **nodes, ngx_uint_t n);
+ 
  ngx_rbtree_node_t *
  ngx_rbtree_next(ngx_rbtree_t *tree,
      ngx_rbtree_node_t *node);
  
+ /*
+  * 摘下所有 key <= key 的节点（按定时器的方式比较，考虑回绕），剩下的仍是合法的红黑树。
+  * 摘下的节点按 key 升序用 right 串成单链表返回，以 NULL 结尾，O(k + log n)
+  */
+ ngx_rbtree_node_t *
+ ngx_rbtree_split_timer(ngx_rbtree_t *tree, ngx_rbtree_key_t key);
+ 
  #define ngx_rbt_red(node)               ((node)->color = 1)
  #define ngx_rbt_black(node)             ((node)->color = 0)
  #define ngx_rbt_is_red(node)            ((node)->color)
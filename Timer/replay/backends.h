@@ -0,0 +1,347 @@
+#ifndef MARK_REPLAY_BACKENDS_H
+#define MARK_REPLAY_BACKENDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <set>
+
+#include "timer_handle.h"
+#include "timer_group.h"
+#include "timer_expired.h"
+
+/*
+ * 回放和内存测试共用的适配层：把各实现的底层结构包成同一个接口，时间由调用者给出（模拟时间，ms），
+ * 不读时钟，全速推进。各 C 实现的头文件放进各自的命名空间，同名的 handler_pt / timer_entry_t 不冲突；
+ * 时间轮是全局单例，需要编译时定义 TIMER_SIM_CLOCK，同一时刻只能有一个 TimeWheelBackend。
+ */
+
+namespace mh {
+extern "C" {
+#include "minheap.h"
+}
+}
+namespace rbt {
+extern "C" {
+#include "rbtree.h"
+}
+}
+namespace skl {
+extern "C" {
+#include "skiplist.h"
+}
+}
+namespace tw {
+extern "C" {
+#include "timewheel.h"
+}
+}
+
+class Backend {
+public:
+    virtual ~Backend() {}
+    virtual const char *Name() const = 0;
+    // 在 now 添加一个 timeout 毫秒后到期的定时器，返回本实现的句柄，失败返回 0
+    virtual uint64_t Add(uint32_t now, uint32_t timeout) = 0;
+    // 句柄已失效时返回 false（时间轮的 del_timer 没有返回值，总是返回 true）
+    virtual bool Del(uint64_t handle) = 0;
+    // 推进到 now，触发所有到期时间 <= now 的定时器，返回触发的个数
+    virtual size_t Expire(uint32_t now) = 0;
+};
+
+// 不存任何东西，回放时用来扣除读录制文件和句柄映射本身的开销
+class NullBackend : public Backend {
+    uint64_t next = 0;
+public:
+    const char *Name() const override { return "none"; }
+    uint64_t Add(uint32_t, uint32_t) override { return ++next; }
+    bool Del(uint64_t) override { return true; }
+    size_t Expire(uint32_t) override { return 0; }
+};
+
+/* ---------------- 最小堆 ---------------- */
+class MinHeapBackend : public Backend {
+    mh::min_heap_t heap;
+    handle_table_t handles;
+    static void OnFire(mh::timer_entry_t *) {}
+public:
+    MinHeapBackend() {
+        mh::min_heap_ctor_(&heap);
+        handle_table_init(&handles);
+    }
+    ~MinHeapBackend() {
+        mh::timer_entry_t *te;
+        while ((te = mh::min_heap_pop_(&heap)) != NULL) {
+            free(te);
+        }
+        mh::min_heap_dtor_(&heap);
+        handle_table_free(&handles);
+    }
+    const char *Name() const override { return "minheap"; }
+    uint64_t Add(uint32_t now, uint32_t timeout) override {
+        mh::timer_entry_t *te = (mh::timer_entry_t *)malloc(sizeof(*te));
+        if (!te) {
+            return TIMER_HANDLE_INVALID;
+        }
+        mh::min_heap_elem_init_(te);
+        te->time = now + timeout;
+        te->handler = OnFire;
+        te->privdata = NULL;
+        te->handle = handle_alloc(&handles, te);
+        if (te->handle == TIMER_HANDLE_INVALID || mh::min_heap_push_(&heap, te) != 0) {
+            handle_release(&handles, te->handle);
+            free(te);
+            return TIMER_HANDLE_INVALID;
+        }
+        return te->handle;
+    }
+    bool Del(uint64_t h) override {
+        mh::timer_entry_t *te = (mh::timer_entry_t *)handle_release(&handles, h);
+        if (!te) {
+            return false;
+        }
+        mh::min_heap_erase_(&heap, te);
+        free(te);
+        return true;
+    }
+    size_t Expire(uint32_t now) override {
+        mh::timer_entry_t *te;
+        size_t n = 0;
+        while ((te = mh::min_heap_top_(&heap)) != NULL && te->time <= now) {
+            mh::min_heap_pop_(&heap);
+            handle_release(&handles, te->handle);
+            te->handler(te);
+            free(te);
+            n++;
+        }
+        return n;
+    }
+};
+
+/* ---------------- 红黑树 ---------------- */
+class RbtreeBackend : public Backend {
+    struct Entry {
+        rbt::ngx_rbtree_node_t node;   // 必须是第一个成员
+        uint64_t handle;
+        void (*handler)(Entry *);
+    };
+    rbt::ngx_rbtree_t tree;
+    rbt::ngx_rbtree_node_t sentinel;
+    handle_table_t handles;
+    static void OnFire(Entry *) {}
+public:
+    RbtreeBackend() {
+        ngx_rbtree_init(&tree, &sentinel, rbt::ngx_rbtree_insert_timer_value);
+        handle_table_init(&handles);
+    }
+    ~RbtreeBackend() {
+        while (tree.root != tree.sentinel) {
+            rbt::ngx_rbtree_node_t *node = rbt::ngx_rbtree_min(tree.root, tree.sentinel);
+            rbt::ngx_rbtree_delete(&tree, node);
+            free(node);
+        }
+        handle_table_free(&handles);
+    }
+    const char *Name() const override { return "rbtree"; }
+    uint64_t Add(uint32_t now, uint32_t timeout) override {
+        Entry *e = (Entry *)malloc(sizeof(*e));
+        if (!e) {
+            return TIMER_HANDLE_INVALID;
+        }
+        e->handler = OnFire;
+        e->handle = handle_alloc(&handles, e);
+        if (e->handle == TIMER_HANDLE_INVALID) {
+            free(e);
+            return TIMER_HANDLE_INVALID;
+        }
+        e->node.key = now + timeout;
+        rbt::ngx_rbtree_insert(&tree, &e->node);
+        return e->handle;
+    }
+    bool Del(uint64_t h) override {
+        Entry *e = (Entry *)handle_release(&handles, h);
+        if (!e) {
+            return false;
+        }
+        rbt::ngx_rbtree_delete(&tree, &e->node);
+        free(e);
+        return true;
+    }
+    size_t Expire(uint32_t now) override {
+        size_t n = 0;
+        while (tree.root != tree.sentinel) {
+            rbt::ngx_rbtree_node_t *node = rbt::ngx_rbtree_min(tree.root, tree.sentinel);
+            if (node->key > now) {
+                break;
+            }
+            Entry *e = (Entry *)node;
+            rbt::ngx_rbtree_delete(&tree, node);
+            handle_release(&handles, e->handle);
+            e->handler(e);
+            free(e);
+            n++;
+        }
+        return n;
+    }
+};
+
+/* ---------------- 跳表 ---------------- */
+class SkiplistBackend : public Backend {
+    skl::zskiplist *zsl;
+    handle_table_t handles;
+    static void OnFire(skl::zskiplistNode *) {}
+public:
+    SkiplistBackend() {
+        zsl = skl::zslCreate();
+        handle_table_init(&handles);
+    }
+    ~SkiplistBackend() {
+        skl::zslFree(zsl);
+        handle_table_free(&handles);
+    }
+    const char *Name() const override { return "skiplist"; }
+    uint64_t Add(uint32_t now, uint32_t timeout) override {
+        skl::zskiplistNode *zn = skl::zslInsert(zsl, now + timeout, OnFire);
+        if (!zn) {
+            return TIMER_HANDLE_INVALID;
+        }
+        zn->handle = handle_alloc(&handles, zn);
+        if (zn->handle == TIMER_HANDLE_INVALID) {
+            skl::zslDelete(zsl, zn);
+            return TIMER_HANDLE_INVALID;
+        }
+        return zn->handle;
+    }
+    bool Del(uint64_t h) override {
+        skl::zskiplistNode *zn = (skl::zskiplistNode *)handle_release(&handles, h);
+        if (!zn) {
+            return false;
+        }
+        skl::zslDelete(zsl, zn);
+        return true;
+    }
+    size_t Expire(uint32_t now) override {
+        skl::zskiplistNode *x;
+        size_t n = 0;
+        while ((x = skl::zslMin(zsl)) != NULL && x->score <= now) {
+            skl::zslDeleteHead(zsl);
+            handle_release(&handles, x->handle);
+            x->handler(x);
+            free(x);
+            n++;
+        }
+        return n;
+    }
+};
+
+/* ---------------- 时间轮 ---------------- */
+#ifdef TIMER_SIM_CLOCK
+class TimeWheelBackend : public Backend {
+    static size_t fired;
+    static void OnFire(tw::timer_node_t *) { fired++; }
+    size_t reported = fired;
+public:
+    TimeWheelBackend() {
+        tw::timer_sim_now = 0;
+        tw::init_timer();
+    }
+    ~TimeWheelBackend() { tw::clear_timer(); }
+    const char *Name() const override { return "timewheel"; }
+    uint64_t Add(uint32_t, uint32_t timeout) override {
+        // 相对时间轮当前刻度添加，调用者保证先 Expire(now)；超时为 0 时 add_timer 立即回调
+        return tw::add_timer((int)timeout, OnFire, 0);
+    }
+    bool Del(uint64_t h) override {
+        tw::del_timer(h);
+        return true;
+    }
+    size_t Expire(uint32_t now) override {
+        tw::timer_sim_now = now;
+        tw::expire_timer();
+        size_t n = fired - reported;  // 包括 Add 里立即回调的
+        reported = fired;
+        return n;
+    }
+};
+size_t TimeWheelBackend::fired;
+#endif
+
+/* ---------------- std::set（和 timer.cc 的节点布局相同） ---------------- */
+class SetBackend : public Backend {
+    struct Key {
+        time_t expire;
+        int64_t id;
+    };
+    struct Node : public Key {
+        std::function<void(const Node &)> func;
+        Node(time_t expire, int64_t id, std::function<void(const Node &)> f) : func(std::move(f)) {
+            this->expire = expire;
+            this->id = id;
+        }
+    };
+    struct Less {
+        using is_transparent = void;
+        bool operator()(const Key &a, const Key &b) const {
+            return a.expire < b.expire || (a.expire == b.expire && a.id < b.id);
+        }
+    };
+    std::set<Node, Less> timeouts;
+    int64_t gid = 0;
+public:
+    const char *Name() const override { return "set"; }
+    // 句柄里拼上到期时间和 id 的低 32 位，取消时和 timer.cc 一样按 (expire, id) 查找
+    uint64_t Add(uint32_t now, uint32_t timeout) override {
+        uint32_t expire = now + timeout;
+        timeouts.emplace(expire, ++gid, [](const Node &) {});
+        return ((uint64_t)expire << 32) | (uint32_t)gid;
+    }
+    bool Del(uint64_t h) override {
+        Key key;
+        key.expire = (time_t)(h >> 32);
+        key.id = (int64_t)(uint32_t)h;
+        auto iter = timeouts.find(key);
+        if (iter == timeouts.end()) {
+            return false;
+        }
+        timeouts.erase(iter);
+        return true;
+    }
+    size_t Expire(uint32_t now) override {
+        size_t n = 0;
+        auto iter = timeouts.begin();
+        while (iter != timeouts.end() && iter->expire <= (time_t)now) {
+            iter->func(*iter);
+            iter = timeouts.erase(iter);
+            n++;
+        }
+        return n;
+    }
+};
+
+static const char *const kBackendNames[] = {
+    "minheap", "rbtree", "skiplist",
+#ifdef TIMER_SIM_CLOCK
+    "timewheel",
+#endif
+    "set",
+};
+
+// 按名字创建，未知名字返回空
+static std::unique_ptr<Backend>
+MakeBackend(const char *name) {
+    if (!strcmp(name, "none")) return std::unique_ptr<Backend>(new NullBackend());
+    if (!strcmp(name, "minheap")) return std::unique_ptr<Backend>(new MinHeapBackend());
+    if (!strcmp(name, "rbtree")) return std::unique_ptr<Backend>(new RbtreeBackend());
+    if (!strcmp(name, "skiplist")) return std::unique_ptr<Backend>(new SkiplistBackend());
+#ifdef TIMER_SIM_CLOCK
+    if (!strcmp(name, "timewheel")) return std::unique_ptr<Backend>(new TimeWheelBackend());
+#endif
+    if (!strcmp(name, "set")) return std::unique_ptr<Backend>(new SetBackend());
+    return nullptr;
+}
+
+#endif // MARK_REPLAY_BACKENDS_H
@@ -0,0 +1,225 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "backends.h"
+
+/*
+ * 每个定时器占多少内存：每个实现在单独的子进程里灌满 N 个定时器，然后
+ *   fill    RSS 增量 / 个，请求的字节数 / 个，分配器实际占用 / 个（mallinfo2），两者之差就是分配器开销（块头 + 对齐）
+ *   churn   随机取消再添加 2N 次，RSS / 个，堆里空闲但没还给系统的字节 / 个，碎片率 = 空闲 / 堆大小
+ *   cancel  随机取消 90%，RSS / 剩下的个数，malloc_trim 之后再看一次，剩下的定时器钉住的页还不回去
+ * 请求的字节数用 -Wl,--wrap 包住 malloc / calloc / realloc / free 统计（operator new 也转到 malloc），
+ * free 时按 malloc_usable_size 扣，churn 之后不准，只在 fill 时报告。
+ * 句柄表、堆数组这些随个数增长的部分都算在内；时间轮取消只打标记，节点要等到刻度才释放，churn 时一并体现。
+ * 时间不推进，超时在 [1, 1h) 里随机，灌满和 churn 期间不会触发。
+ *
+ *   ./mem-bench 10000000                 # 1000 万，所有实现
+ *   ./mem-bench 100000000 minheap set    # 1 亿，指定实现（需要十几 GB 内存）
+ */
+
+using namespace std;
+
+#define SPAN_MS 3600000
+
+/* ---------------- malloc 统计 ---------------- */
+static size_t live_requested, live_blocks;
+
+extern "C" {
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n) {
+    void *p = __real_malloc(n);
+    if (p) {
+        live_requested += n;
+        live_blocks++;
+    }
+    return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    void *p = __real_calloc(n, size);
+    if (p) {
+        live_requested += n * size;
+        live_blocks++;
+    }
+    return p;
+}
+
+void *__wrap_realloc(void *old, size_t n) {
+    size_t old_size = old ? malloc_usable_size(old) : 0;
+    void *p = __real_realloc(old, n);
+    if (p) {
+        if (old) {
+            live_requested -= old_size;
+            live_blocks--;
+        }
+        live_requested += n;
+        live_blocks++;
+    }
+    return p;
+}
+
+void __wrap_free(void *p) {
+    if (p) {
+        live_requested -= malloc_usable_size(p);
+        live_blocks--;
+    }
+    __real_free(p);
+}
+}
+
+// 不内联，否则编译器看到 malloc / free 和 new / delete 配对会报 -Wmismatched-new-delete
+__attribute__((noinline)) void *operator new(size_t n) {
+    void *p = malloc(n);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+
+/* ---------------- 测量 ---------------- */
+static size_t
+rss_bytes() {
+    long pages = 0, resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp) {
+        if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(fp);
+    }
+    return (size_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+struct Sample {
+    size_t rss, requested, blocks;
+    size_t in_use;      // 分配器交出去的字节（含块头），uordblks + hblkhd
+    size_t heap;        // 分配器向系统要的字节，arena + hblkhd
+    size_t free_held;   // 堆里空闲着的字节，fordblks
+};
+
+static Sample
+Measure() {
+    Sample s;
+    struct mallinfo2 mi = mallinfo2();
+    s.rss = rss_bytes();
+    s.requested = live_requested;
+    s.blocks = live_blocks;
+    s.in_use = mi.uordblks + mi.hblkhd;
+    s.heap = mi.arena + mi.hblkhd;
+    s.free_held = mi.fordblks;
+    return s;
+}
+
+static uint64_t seed = 88172645463325252ull;
+
+static uint32_t
+rnd() {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return (uint32_t)seed;
+}
+
+static double
+per(size_t a, size_t b, size_t n) {
+    return n ? ((double)a - (double)b) / n : 0.0;
+}
+
+// 子进程里跑一个实现，结果写到 out
+static int
+Run(const char *name, size_t n, int out) {
+    // 句柄数组不走 malloc，先摸一遍，不算进基线之后的增量
+    uint64_t *handles = (uint64_t *)mmap(NULL, n * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (handles == MAP_FAILED) {
+        dprintf(out, "%-9s cannot map %zu handles\n", name, n);
+        return 1;
+    }
+    auto b = MakeBackend(name);
+    if (!b) {
+        dprintf(out, "unknown backend %s\n", name);
+        return 1;
+    }
+    Sample base = Measure();
+
+    for (size_t i = 0; i < n; i++) {
+        handles[i] = b->Add(0, 1 + rnd() % SPAN_MS);
+    }
+    Sample fill = Measure();
+    dprintf(out, "%-9s fill   %10zu timers  rss %6.1f B/timer  requested %6.1f  allocated %6.1f"
+        "  allocator overhead %5.1f B/timer  (%.2f allocs/timer)\n", b->Name(), n,
+        per(fill.rss, base.rss, n), per(fill.requested, base.requested, n),
+        per(fill.in_use, base.in_use, n), per(fill.in_use - fill.requested, base.in_use - base.requested, n),
+        per(fill.blocks, base.blocks, n));
+
+    size_t ops = 2 * n;
+    for (size_t k = 0; k < ops; k++) {
+        size_t i = rnd() % n;
+        b->Del(handles[i]);
+        handles[i] = b->Add(0, 1 + rnd() % SPAN_MS);
+    }
+    Sample churn = Measure();
+    dprintf(out, "%-9s churn  %10zu ops     rss %6.1f B/timer  free in heap %6.1f B/timer"
+        "  fragmentation %4.1f%%  (%.2f allocs/timer)\n", b->Name(), ops,
+        per(churn.rss, base.rss, n), per(churn.free_held, 0, n),
+        churn.heap ? 100.0 * churn.free_held / churn.heap : 0.0, per(churn.blocks, base.blocks, n));
+
+    size_t left = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (rnd() % 10) {
+            b->Del(handles[i]);
+        } else {
+            left++;
+        }
+    }
+    Sample cancel = Measure();
+    malloc_trim(0);
+    Sample trim = Measure();
+    dprintf(out, "%-9s cancel %10zu left    rss %6.1f B/live   after malloc_trim %6.1f B/live"
+        "  fragmentation %4.1f%%\n", b->Name(), left,
+        per(cancel.rss, base.rss, left), per(trim.rss, base.rss, left),
+        trim.heap ? 100.0 * trim.free_held / trim.heap : 0.0);
+    // 不析构，退出时整体归还
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    vector<const char *> names;
+    if (argc > 2) {
+        names.assign(argv + 2, argv + argc);
+    } else {
+        names.assign(begin(kBackendNames), end(kBackendNames));
+    }
+    int out = dup(STDOUT_FILENO);
+    for (const char *name : names) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(Run(name, n, out));
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status)) {
+            printf("%-9s killed (signal %d), not enough memory for %zu timers?\n", name,
+                WIFSIGNALED(status) ? WTERMSIG(status) : 0, n);
+        }
+    }
+    return 0;
+}
+
+// gcc -O2 -c -DTIMER_SIM_CLOCK ../minheap/minheap.c ../rbtree/rbtree.c ../skiplist/skiplist.c ../timewheel/timewheel.c -I../common -I../timewheel
+// g++ -O2 -std=c++14 -DTIMER_SIM_CLOCK mem-bench.cc minheap.o rbtree.o skiplist.o timewheel.o -o mem-bench -I../common -I../minheap -I../rbtree -I../skiplist -I../timewheel -lpthread -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include "timer_trace.h"
+#include "backends.h"
+
+/*
+ * 回放定时器操作录制文件：按录制的先后顺序在模拟时间里全速驱动各实现，
+ * 每条记录先把时间推进到它的时间戳（触发期间到期的定时器），再执行 ADD / DEL。
+ * 录制时的句柄和回放实现的句柄用哈希表对应；FIRE 记录表示录制时已经触发，只用来清理对应关系。
+ * none 只走读文件和句柄映射，其余实现的耗时减去它就是数据结构本身的开销。
+ *
+ *   ./trace-replay timer.trace                    # 所有实现
+ *   ./trace-replay timer.trace minheap timewheel  # 指定实现
+ */
+
+using namespace std;
+
+struct ReplayStat {
+    uint64_t adds = 0, dels = 0, fires = 0;
+    double seconds = 0;
+};
+
+static ReplayStat
+Replay(Backend *b, const timer_trace_t *t) {
+    ReplayStat st;
+    unordered_map<uint64_t, uint64_t> handles;  // 录制时的句柄 -> 回放实现的句柄
+    uint32_t now = 0;
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < t->count; i++) {
+        const timer_trace_rec_t *r = &t->r[i];
+        uint32_t ts = timer_trace_ts(r);
+        if (ts != now) {
+            st.fires += b->Expire(ts);
+            now = ts;
+        }
+        switch (timer_trace_op(r)) {
+        case TIMER_TRACE_ADD:
+            handles[r->handle] = b->Add(now, r->timeout);
+            st.adds++;
+            break;
+        case TIMER_TRACE_DEL: {
+            auto iter = handles.find(r->handle);
+            if (iter != handles.end()) {
+                st.dels += b->Del(iter->second);
+                handles.erase(iter);
+            }
+            break;
+        }
+        case TIMER_TRACE_FIRE:
+            handles.erase(r->handle);
+            break;
+        }
+    }
+    st.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return st;
+}
+
+int main(int argc, char *argv[]) {
+    timer_trace_t t;
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trace> [none|minheap|rbtree|skiplist|timewheel|set ...]\n", argv[0]);
+        return 1;
+    }
+    if (timer_trace_load(&t, argv[1]) < 0) {
+        fprintf(stderr, "cannot load trace %s\n", argv[1]);
+        return 1;
+    }
+    uint64_t ops[3] = {0, 0, 0};
+    for (uint64_t i = 0; i < t.count; i++) {
+        ops[timer_trace_op(&t.r[i]) & 3]++;
+    }
+    printf("%s: %llu records over %.1f s, add %llu del %llu fire %llu\n", argv[1],
+        (unsigned long long)t.count, t.count ? timer_trace_ts(&t.r[t.count - 1]) / 1000.0 : 0.0,
+        (unsigned long long)ops[0], (unsigned long long)ops[1], (unsigned long long)ops[2]);
+
+    vector<const char *> names;
+    if (argc > 2) {
+        names.assign(argv + 2, argv + argc);
+    } else {
+        names.push_back("none");
+        names.insert(names.end(), begin(kBackendNames), end(kBackendNames));
+    }
+    double base = 0;
+    for (const char *name : names) {
+        auto b = MakeBackend(name);
+        if (!b) {
+            fprintf(stderr, "unknown backend %s\n", name);
+            continue;
+        }
+        ReplayStat st = Replay(b.get(), &t);
+        if (!strcmp(name, "none")) {
+            base = st.seconds;
+        }
+        uint64_t n = st.adds + st.dels + st.fires;
+        printf("  %-9s %7.3f s  %6.1f ns/op  (%5.1f ns/op over none)  fired %llu cancelled %llu\n",
+            b->Name(), st.seconds, n ? st.seconds * 1e9 / n : 0.0,
+            n && base > 0 ? (st.seconds - base) * 1e9 / n : 0.0,
+            (unsigned long long)st.fires, (unsigned long long)st.dels);
+    }
+    timer_trace_unload(&t);
+    return 0;
+}
+
+// gcc -O2 -c -DTIMER_SIM_CLOCK ../minheap/minheap.c ../rbtree/rbtree.c ../skiplist/skiplist.c ../timewheel/timewheel.c -I../common -I../timewheel
+// g++ -O2 -std=c++14 -DTIMER_SIM_CLOCK trace-replay.cc minheap.o rbtree.o skiplist.o timewheel.o -o trace-replay -I../common -I../minheap -I../rbtree -I../skiplist -I../timewheel -lpthread
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "timer_trace.h"
+
+/*
+ * 没有线上录制文件时合成一个网关负载的录制文件：
+ *   - CONNS 个长连接，每个连接一个 IDLE_MS 的空闲定时器，每来一个请求就取消旧的、重新添加（刷新）；
+ *   - 每个请求一个 REQ_MS 的请求超时，应答到了就取消：90% 1~20ms，9% 20~200ms，1% 不应答，超时触发；
+ *   - 请求在连接间均匀分布，每毫秒 rate 个。
+ * 只写 ADD / DEL，不写 FIRE（回放时各实现自己触发），格式见 common/timer_trace.h。
+ *
+ *   ./trace-synth gw.trace 120 5     # 120 秒，每毫秒 5 个请求
+ */
+
+#define CONNS   50000
+#define IDLE_MS 30000
+#define REQ_MS  5000
+#define LAT_MAX 256     // 应答延迟上限（ms），也是待取消环的大小
+#define LAT_CAP 256     // 每毫秒最多挂多少个待取消的请求超时，超出的当作不应答
+
+static uint64_t idle_handle[CONNS];
+static uint32_t idle_expire[CONNS];
+static uint64_t pending[LAT_MAX][LAT_CAP];  // 按应答时刻取模
+static int npending[LAT_MAX];
+
+static uint32_t
+rnd() {
+    return (uint32_t)rand() << 16 ^ (uint32_t)rand();
+}
+
+// 应答延迟，0 表示不应答
+static uint32_t
+latency() {
+    uint32_t r = rnd() % 100;
+    if (r < 90) return 1 + rnd() % 20;
+    if (r < 99) return 20 + rnd() % 180;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "gw.trace";
+    uint32_t seconds = argc > 2 ? (uint32_t)atoi(argv[2]) : 120;
+    int rate = argc > 3 ? atoi(argv[3]) : 5;
+    uint64_t next = 0, records = 0;
+    uint32_t now;
+    int i;
+
+    if (timer_trace_open(path) < 0) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    srand(12345);
+    for (now = 0; now < seconds * 1000; now++) {
+        // 先处理这一毫秒到达的应答
+        int slot = now % LAT_MAX;
+        for (i = 0; i < npending[slot]; i++) {
+            timer_trace_write(TIMER_TRACE_DEL, now, pending[slot][i], 0);
+            records++;
+        }
+        npending[slot] = 0;
+
+        for (i = 0; i < rate; i++) {
+            int c = rnd() % CONNS;
+            // 空闲定时器还没到期就取消后重新添加，已经到期的（连接被回收后重连）直接添加
+            if (idle_handle[c] && idle_expire[c] > now) {
+                timer_trace_write(TIMER_TRACE_DEL, now, idle_handle[c], 0);
+                records++;
+            }
+            idle_handle[c] = ++next;
+            idle_expire[c] = now + IDLE_MS;
+            timer_trace_write(TIMER_TRACE_ADD, now, idle_handle[c], IDLE_MS);
+
+            uint64_t req = ++next;
+            timer_trace_write(TIMER_TRACE_ADD, now, req, REQ_MS);
+            records += 2;
+            uint32_t lat = latency();
+            int s = (now + lat) % LAT_MAX;
+            if (lat && npending[s] < LAT_CAP) {
+                pending[s][npending[s]++] = req;
+            }
+        }
+    }
+    timer_trace_close();
+    printf("%s: %llu records, %u s, %d requests/ms\n", path, (unsigned long long)records, seconds, rate);
+    return 0;
+}
+
+// gcc -O2 trace-synth.c -o trace-synth -I../common
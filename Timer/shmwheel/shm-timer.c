@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "shmwheel.h"
+
+#define SHM_NAME "/mark-shm-timer"
+
+enum {
+    TIMER_WINDOW = 1,  // 限流窗口结束
+    TIMER_SESSION,     // 共享会话过期
+    TIMER_QUIT,
+};
+
+static shm_timer_t *T;
+static int quit;
+
+void do_window(uint64_t arg) {
+    printf("[owner %d] rate-limit window of worker %d slot %d closed\n",
+        getpid(), (int)(arg >> 32), (int)(uint32_t)arg);
+}
+
+void do_session(uint64_t arg) {
+    printf("[owner %d] session %lu expired\n", getpid(), (unsigned long)arg);
+}
+
+void do_quit(uint64_t arg) {
+    quit = 1;
+}
+
+void worker(int id) {
+    int i;
+    for (i = 0; i < 3; i++) {
+        // 从 worker 进程添加，owner 进程执行
+        shm_timer_add(T, 200 * (i + 1), TIMER_WINDOW, ((uint64_t)id << 32) | i);
+        usleep(100 * 1000);
+    }
+    timer_handle_t h = shm_timer_add(T, 500, TIMER_SESSION, 1000 + id);
+    // 会话续期：取消旧的，再加一个新的；旧句柄再取消一次是空操作
+    shm_timer_cancel(T, h);
+    shm_timer_cancel(T, h);
+    shm_timer_add(T, 800, TIMER_SESSION, 1000 + id);
+    printf("[worker %d] done\n", id);
+    shm_timer_detach(T);
+    exit(0);
+}
+
+int main() {
+    int i;
+    shm_unlink(SHM_NAME);
+    // 在 fork 之前创建，子进程继承映射和 eventfd
+    T = shm_timer_create(SHM_NAME, 1024);
+    if (!T) {
+        perror("shm_timer_create");
+        return 1;
+    }
+    shm_timer_register(T, TIMER_WINDOW, do_window);
+    shm_timer_register(T, TIMER_SESSION, do_session);
+    shm_timer_register(T, TIMER_QUIT, do_quit);
+    shm_timer_add(T, 2500, TIMER_QUIT, 0);
+
+    for (i = 0; i < 2; i++) {
+        if (fork() == 0) {
+            worker(i);
+        }
+    }
+    while (!quit) {
+        shm_timer_expire(T);
+        if (!quit) {
+            shm_timer_wait(T, -1);
+        }
+    }
+    for (i = 0; i < 2; i++) {
+        wait(NULL);
+    }
+    shm_timer_destroy(T, SHM_NAME);
+    return 0;
+}
+
+// gcc shm-timer.c shmwheel.c -o shm -I./ -I../common -lpthread -lrt
@@ -0,0 +1,479 @@
+#include "shmwheel.h"
+#include "timer_probe.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define SHM_MAGIC 0x5348574cu  // "SHWL"
+#define SHM_BATCH 64
+
+static uint64_t
+gettime() {
+    struct timespec ti;
+    clock_gettime(CLOCK_MONOTONIC, &ti);
+    return (uint64_t)ti.tv_sec * 1000 + ti.tv_nsec / 1000000;
+}
+
+static void
+shm_lock(shm_wheel_t *w) {
+    // 持锁进程崩溃后，下一个加锁者接手；时间轮的修改都很短，这里直接标记为一致
+    if (pthread_mutex_lock(&w->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&w->lock);
+    }
+}
+
+static void
+shm_unlock(shm_wheel_t *w) {
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void
+list_clear(shm_list_t *list) {
+    list->head = list->tail = SHM_NIL;
+}
+
+static uint32_t
+list_detach(shm_list_t *list) {
+    uint32_t ret = list->head;
+    list_clear(list);
+    return ret;
+}
+
+static void
+list_link(shm_timer_t *t, shm_list_t *list, uint32_t idx) {
+    t->nodes[idx].next = SHM_NIL;
+    if (list->tail == SHM_NIL) {
+        list->head = idx;
+    } else {
+        t->nodes[list->tail].next = idx;
+    }
+    list->tail = idx;
+}
+
+static void
+add_node(shm_timer_t *t, uint32_t idx) {
+    shm_wheel_t *w = t->w;
+    uint32_t time = t->nodes[idx].expire;
+    uint32_t current = w->time;
+    // 按高位是否相同选层（同 timewheel.c），按差值放会落进从不 cascade 的 0 号槽
+    if ((time | SHM_TIME_NEAR_MASK) == (current | SHM_TIME_NEAR_MASK)) {
+        list_link(t, &w->near[time & SHM_TIME_NEAR_MASK], idx);
+    } else {
+        int i;
+        uint32_t mask = SHM_TIME_NEAR << SHM_TIME_LEVEL_SHIFT;
+        for (i = 0; i < 3; i++) {
+            if ((time | (mask - 1)) == (current | (mask - 1))) {
+                break;
+            }
+            mask <<= SHM_TIME_LEVEL_SHIFT;
+        }
+        list_link(t, &w->t[i][(time >> (SHM_TIME_NEAR_SHIFT + i * SHM_TIME_LEVEL_SHIFT)) & SHM_TIME_LEVEL_MASK], idx);
+    }
+}
+
+static void
+free_node(shm_timer_t *t, uint32_t idx) {
+    shm_node_t *node = &t->nodes[idx];
+    if (!node->cancel) {
+        t->w->count--;
+    }
+    node->used = 0;
+    if (++node->gen == 0) {
+        node->gen = 1;
+    }
+    node->next = t->w->free_head;
+    t->w->free_head = idx;
+}
+
+static shm_timer_t *
+shm_map(int fd, size_t size, int wakefd) {
+    shm_timer_t *t = (shm_timer_t *)calloc(1, sizeof(*t));
+    if (!t) {
+        return NULL;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        free(t);
+        return NULL;
+    }
+    t->w = (shm_wheel_t *)base;
+    t->nodes = (shm_node_t *)((char *)base + sizeof(shm_wheel_t));
+    t->size = size;
+    t->wakefd = wakefd;
+    t->epfd = -1;
+    return t;
+}
+
+shm_timer_t *
+shm_timer_create(const char *name, uint32_t capacity) {
+    uint32_t i;
+    capacity += 1; // 0 号节点保留
+    size_t size = sizeof(shm_wheel_t) + (size_t)capacity * sizeof(shm_node_t);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    shm_timer_t *t = shm_map(fd, size, -1);
+    close(fd);
+    if (!t) {
+        shm_unlink(name);
+        return NULL;
+    }
+    shm_wheel_t *w = t->w;
+    // ftruncate 出来的内存已经是 0，只需设置非零字段
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&w->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    w->capacity = capacity;
+    w->current_point = gettime();
+    for (i = capacity - 1; i > 0; i--) {
+        t->nodes[i].gen = 1;
+        t->nodes[i].next = w->free_head;
+        w->free_head = i;
+    }
+
+    t->wakefd = eventfd(0, EFD_NONBLOCK);
+    t->epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN };
+    epoll_ctl(t->epfd, EPOLL_CTL_ADD, t->wakefd, &ev);
+    __atomic_store_n(&w->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return t;
+}
+
+shm_timer_t *
+shm_timer_attach(const char *name, int wakefd) {
+    struct stat st;
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_wheel_t)) {
+        close(fd);
+        return NULL;
+    }
+    shm_timer_t *t = shm_map(fd, st.st_size, wakefd);
+    close(fd);
+    if (t && __atomic_load_n(&t->w->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC) {
+        shm_timer_detach(t);
+        return NULL;
+    }
+    return t;
+}
+
+void
+shm_timer_detach(shm_timer_t *t) {
+    munmap(t->w, t->size);
+    if (t->epfd >= 0) {
+        close(t->epfd);
+    }
+    free(t);
+}
+
+void
+shm_timer_destroy(shm_timer_t *t, const char *name) {
+    if (t->wakefd >= 0) {
+        close(t->wakefd);
+    }
+    shm_timer_detach(t);
+    shm_unlink(name);
+}
+
+int
+shm_timer_register(shm_timer_t *t, uint16_t type, shm_handler_pt func) {
+    if (type >= SHM_MAX_TYPES) {
+        return -1;
+    }
+    t->handlers[type] = func;
+    return 0;
+}
+
+timer_handle_t
+shm_timer_add(shm_timer_t *t, int msec, uint16_t type, uint64_t arg) {
+    shm_wheel_t *w = t->w;
+    timer_handle_t handle;
+    if (msec < 0) {
+        msec = 0;
+    }
+    shm_lock(w);
+    uint32_t idx = w->free_head;
+    if (idx == SHM_NIL) {
+        shm_unlock(w);
+        return TIMER_HANDLE_INVALID;
+    }
+    shm_node_t *node = &t->nodes[idx];
+    w->free_head = node->next;
+    node->expire = w->time + msec;
+    node->type = type;
+    node->arg = arg;
+    node->cancel = 0;
+    node->used = 1;
+    w->count++;
+    add_node(t, idx);
+    handle = ((timer_handle_t)node->gen << 32) | idx;
+    TIMER_PROBE_ADD(handle, node->expire, w->time);
+    int wake = w->sleeping && (int32_t)(node->expire - w->wake_tick) < 0;
+    if (wake) {
+        w->wake_tick = node->expire; // 之后更晚的定时器不必再唤醒
+    }
+    shm_unlock(w);
+    // 只有比 owner 预计醒来更早时才进内核
+    if (wake && t->wakefd >= 0) {
+        eventfd_write(t->wakefd, 1);
+    }
+    return handle;
+}
+
+int
+shm_timer_cancel(shm_timer_t *t, timer_handle_t handle) {
+    shm_wheel_t *w = t->w;
+    uint32_t idx = handle_index(handle);
+    int ret = 0;
+    shm_lock(w);
+    if (idx != SHM_NIL && idx < w->capacity) {
+        shm_node_t *node = &t->nodes[idx];
+        if (node->used && !node->cancel && node->gen == handle_gen(handle)) {
+            // 节点留在槽位里，到期时再回收
+            TIMER_PROBE_DEL(handle, node->expire);
+            node->cancel = 1;
+            w->count--;
+            ret = 1;
+        }
+    }
+    shm_unlock(w);
+    return ret;
+}
+
+static void
+move_list(shm_timer_t *t, int level, int idx) {
+    uint32_t current = list_detach(&t->w->t[level][idx]);
+    uint32_t count = 0;
+    while (current != SHM_NIL) {
+        uint32_t next = t->nodes[current].next;
+        add_node(t, current);
+        current = next;
+        count++;
+    }
+    TIMER_PROBE_CASCADE(level, idx, count);
+}
+
+static void
+timer_shift(shm_timer_t *t) {
+    shm_wheel_t *w = t->w;
+    int mask = SHM_TIME_NEAR;
+    uint32_t ct = ++w->time;
+    if (ct == 0) {
+        move_list(t, 3, 0);
+    } else {
+        uint32_t time = ct >> SHM_TIME_NEAR_SHIFT;
+        int i = 0;
+        while ((ct & (mask - 1)) == 0) {
+            int idx = time & SHM_TIME_LEVEL_MASK;
+            if (idx != 0) {
+                move_list(t, i, idx);
+                break;
+            }
+            mask <<= SHM_TIME_LEVEL_SHIFT;
+            time >>= SHM_TIME_LEVEL_SHIFT;
+            ++i;
+        }
+    }
+}
+
+// 摘下当前槽位，类型和参数拷出后节点立即回收，回调在锁外执行；
+// lag 是这一刻度落后墙上时钟的刻度数，只给探针用
+static void
+timer_execute(shm_timer_t *t, uint32_t lag) {
+    shm_wheel_t *w = t->w;
+    int idx = w->time & SHM_TIME_NEAR_MASK;
+    uint16_t types[SHM_BATCH];
+    uint64_t args[SHM_BATCH];
+    int i, n;
+
+    while (w->near[idx].head != SHM_NIL) {
+        uint32_t current = list_detach(&w->near[idx]);
+        while (current != SHM_NIL) {
+            n = 0;
+            while (current != SHM_NIL && n < SHM_BATCH) {
+                shm_node_t *node = &t->nodes[current];
+                uint32_t next = node->next;
+                if (!node->cancel) {
+                    TIMER_PROBE_FIRE(((timer_handle_t)node->gen << 32) | current, node->expire, lag);
+                    types[n] = node->type;
+                    args[n] = node->arg;
+                    n++;
+                }
+                free_node(t, current);
+                current = next;
+            }
+            // 剩余节点已从槽位摘下，只有本进程能看到
+            shm_unlock(w);
+            for (i = 0; i < n; i++) {
+                if (types[i] < SHM_MAX_TYPES && t->handlers[types[i]]) {
+                    t->handlers[types[i]](args[i]);
+                }
+            }
+            shm_lock(w);
+        }
+    }
+}
+
+void
+shm_timer_expire(shm_timer_t *t) {
+    shm_wheel_t *w = t->w;
+    uint64_t cp = gettime();
+    shm_lock(w);
+    uint32_t diff = (uint32_t)(cp - w->current_point);
+    w->current_point = cp;
+    while (diff--) {
+        timer_execute(t, diff + 1);
+        timer_shift(t);
+        timer_execute(t, diff);
+    }
+    shm_unlock(w);
+}
+
+// 把当前刻度的槽位整条接到 pending 尾部，调用者持有锁
+static void
+collect_near(shm_timer_t *t) {
+    shm_wheel_t *w = t->w;
+    shm_list_t *list = &w->near[w->time & SHM_TIME_NEAR_MASK];
+    if (list->head == SHM_NIL) {
+        return;
+    }
+    if (w->pending.tail == SHM_NIL) {
+        w->pending.head = list->head;
+    } else {
+        t->nodes[w->pending.tail].next = list->head;
+    }
+    w->pending.tail = list->tail;
+    list_clear(list);
+}
+
+int
+shm_timer_expire_into(shm_timer_t *t, timer_expired_t *out, uint64_t *args, int max) {
+    shm_wheel_t *w = t->w;
+    uint64_t cp = gettime();
+    int n = 0;
+    shm_lock(w);
+    uint32_t diff = (uint32_t)(cp - w->current_point);
+    w->current_point = cp;
+    // 和 shm_timer_expire 的顺序一致：当前刻度、推进、新刻度
+    while (diff--) {
+        collect_near(t);
+        timer_shift(t);
+        collect_near(t);
+    }
+    while (n < max && w->pending.head != SHM_NIL) {
+        uint32_t idx = w->pending.head;
+        shm_node_t *node = &t->nodes[idx];
+        w->pending.head = node->next;
+        if (w->pending.head == SHM_NIL) {
+            w->pending.tail = SHM_NIL;
+        }
+        // 在 pending 里被取消的节点直接丢掉
+        if (!node->cancel) {
+            out[n].handle = ((timer_handle_t)node->gen << 32) | idx;
+            out[n].expire = node->expire;
+            TIMER_PROBE_FIRE(out[n].handle, node->expire, (int32_t)(w->time - node->expire));
+            if (args) {
+                args[n] = node->arg;
+            }
+            n++;
+        }
+        free_node(t, idx);
+    }
+    shm_unlock(w);
+    return n;
+}
+
+static int
+level_next(shm_list_t *slots, uint32_t from) {
+    int i;
+    for (i = 0; i < SHM_TIME_LEVEL; i++) {
+        if (slots[(from + i) & SHM_TIME_LEVEL_MASK].head != SHM_NIL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 距离最近一个到期刻度还有多少毫秒，高层槽位按 cascade 时刻估计，调用者持有锁
+static int
+next_expire_ms(shm_wheel_t *w) {
+    int64_t best = -1;
+    uint32_t i;
+    int level, d;
+    if (w->pending.head != SHM_NIL) {
+        return 0;   // 还有没取走的
+    }
+    for (i = 0; i < SHM_TIME_NEAR; i++) {
+        if (w->near[(w->time + i) & SHM_TIME_NEAR_MASK].head != SHM_NIL) {
+            best = i;
+            break;
+        }
+    }
+    for (level = 0; level < 4; level++) {
+        int shift = SHM_TIME_NEAR_SHIFT + level * SHM_TIME_LEVEL_SHIFT;
+        uint32_t current = w->time >> shift;
+        d = level_next(w->t[level], current + 1);
+        if (d < 0) {
+            continue;
+        }
+        int64_t ticks = ((int64_t)(current + 1 + d) << shift) - w->time;
+        // 高层槽位可能比低层第一个非空槽更早 cascade，每层都要看
+        if (best < 0 || ticks < best) {
+            best = ticks;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+    best -= (int64_t)(gettime() - w->current_point);
+    if (best < 0) {
+        return 0;
+    }
+    return best > 0x7fffffff ? 0x7fffffff : (int)best;
+}
+
+void
+shm_timer_wait(shm_timer_t *t, int max_ms) {
+    shm_wheel_t *w = t->w;
+    shm_lock(w);
+    int ms = next_expire_ms(w);
+    if (max_ms >= 0 && (ms < 0 || ms > max_ms)) {
+        ms = max_ms;
+    }
+    if (ms == 0) {
+        shm_unlock(w);
+        return;
+    }
+    w->sleeping = 1;
+    w->wake_tick = ms < 0 ? w->time + 0x7fffffff
+        : w->time + (uint32_t)(gettime() - w->current_point) + (uint32_t)ms;
+    shm_unlock(w);
+
+    struct epoll_event ev;
+    if (t->epfd >= 0 && epoll_wait(t->epfd, &ev, 1, ms) > 0) {
+        eventfd_t cnt;
+        eventfd_read(t->wakefd, &cnt);
+    }
+
+    shm_lock(w);
+    w->sleeping = 0;
+    shm_unlock(w);
+}
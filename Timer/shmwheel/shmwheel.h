@@ -0,0 +1,96 @@
+#ifndef _MARK_SHMWHEEL_
+#define _MARK_SHMWHEEL_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "timer_handle.h"
+#include "timer_expired.h"
+
+/*
+ * 共享内存多层时间轮：节点池和时间轮索引都放在 POSIX 共享内存段里，
+ * 链表用节点下标代替指针，各进程映射到不同地址也能共用。
+ *   - 任意进程都可以添加 / 取消定时器，只持有一把进程间共享的 robust 互斥锁，
+ *     无竞争时不进内核；
+ *   - 由一个 owner 进程推进时间轮并执行回调，回调用类型 id 表示（函数地址在各进程不同），
+ *     owner 按 id 查本进程注册的处理函数；
+ *   - owner 在 shm_timer_wait 中睡眠，只有新定时器早于它预计醒来的时刻时，
+ *     添加方才写 eventfd 唤醒它（eventfd 需在 fork 之前创建）。
+ */
+
+#define SHM_TIME_NEAR_SHIFT  8
+#define SHM_TIME_NEAR        (1 << SHM_TIME_NEAR_SHIFT)
+#define SHM_TIME_LEVEL_SHIFT 6
+#define SHM_TIME_LEVEL       (1 << SHM_TIME_LEVEL_SHIFT)
+#define SHM_TIME_NEAR_MASK   (SHM_TIME_NEAR - 1)
+#define SHM_TIME_LEVEL_MASK  (SHM_TIME_LEVEL - 1)
+
+#define SHM_MAX_TYPES 64    // 回调类型 id 的上限
+#define SHM_NIL 0           // 下标 0 保留，表示空
+
+typedef struct shm_node_s {
+    uint32_t next;          // 同一槽位中下一个节点的下标
+    uint32_t expire;        // 到期刻度
+    uint32_t gen;           // 代数，与下标一起组成句柄
+    uint16_t type;          // 回调类型 id
+    uint8_t  cancel;
+    uint8_t  used;
+    uint64_t arg;           // 回调参数，不能是指针
+} shm_node_t;
+
+typedef struct shm_list_s {
+    uint32_t head;
+    uint32_t tail;
+} shm_list_t;
+
+// 共享内存段头部，节点数组紧跟其后
+typedef struct shm_wheel_s {
+    uint32_t magic;
+    uint32_t capacity;      // 节点数（含保留的 0 号）
+    pthread_mutex_t lock;   // PTHREAD_PROCESS_SHARED | PTHREAD_MUTEX_ROBUST
+    uint32_t time;          // 当前刻度
+    uint64_t current_point; // 上次推进时的 CLOCK_MONOTONIC 毫秒数，各进程一致
+    uint32_t free_head;
+    uint32_t count;         // 存活的定时器数
+    int sleeping;           // owner 是否在 shm_timer_wait 中睡眠
+    uint32_t wake_tick;     // owner 预计醒来的刻度
+    shm_list_t pending;     // shm_timer_expire_into 已推进到、还没取走的节点，按到期顺序
+    shm_list_t near[SHM_TIME_NEAR];
+    shm_list_t t[4][SHM_TIME_LEVEL];
+} shm_wheel_t;
+
+typedef void (*shm_handler_pt)(uint64_t arg);
+
+// 进程内的句柄，fork 后子进程直接沿用
+typedef struct shm_timer_s {
+    shm_wheel_t *w;
+    shm_node_t *nodes;
+    size_t size;
+    int wakefd;
+    int epfd;               // 只有 owner 使用
+    shm_handler_pt handlers[SHM_MAX_TYPES];
+} shm_timer_t;
+
+// owner 创建共享内存段和 eventfd，capacity 为最多同时存在的定时器数
+shm_timer_t *shm_timer_create(const char *name, uint32_t capacity);
+// 不经 fork 的进程按名字挂接，wakefd 为 owner 传过来的 eventfd（-1 表示不唤醒）
+shm_timer_t *shm_timer_attach(const char *name, int wakefd);
+void shm_timer_detach(shm_timer_t *t);
+// owner 退出时删除共享内存段
+void shm_timer_destroy(shm_timer_t *t, const char *name);
+
+// 只在执行回调的进程中注册
+int shm_timer_register(shm_timer_t *t, uint16_t type, shm_handler_pt func);
+
+// 任意进程调用；节点池用完返回 TIMER_HANDLE_INVALID
+timer_handle_t shm_timer_add(shm_timer_t *t, int msec, uint16_t type, uint64_t arg);
+// 任意进程调用；句柄已失效时为空操作，返回 0
+int shm_timer_cancel(shm_timer_t *t, timer_handle_t handle);
+
+// 以下只在 owner 进程调用
+void shm_timer_expire(shm_timer_t *t);
+// 不执行回调：推进时间，按到期顺序取出最多 max 个到期定时器写入 out（args 不为 NULL 时同时写回调参数），
+// 返回个数，没取完的留到下一次；同一个时间轮只用 shm_timer_expire 和它中的一种驱动
+int shm_timer_expire_into(shm_timer_t *t, timer_expired_t *out, uint64_t *args, int max);
+void shm_timer_wait(shm_timer_t *t, int max_ms);
+
+#endif
@@ -9,8 +9,10 @@ void defaultHandler(zskiplistNode *node) {
 zskiplistNode *zslCreateNode(int level, unsigned long score, handler_pt func) {
     zskiplistNode *zn =
         malloc(sizeof(*zn)+level*sizeof(struct zskiplistLevel));
+    if (!zn) return NULL;
     zn->score = score;
     zn->handler = func;
+    timer_group_link_init(&zn->group);
     return zn;
 }
 
@@ -24,6 +26,7 @@ zskiplist *zslCreate(void) {
     zsl->header = zslCreateNode(ZSKIPLIST_MAXLEVEL,0,defaultHandler);
     for (j = 0; j < ZSKIPLIST_MAXLEVEL; j++) {
         zsl->header->level[j].forward = NULL;
+        zsl->tail[j] = zsl->header;
     }
     return zsl;
 }
@@ -52,31 +55,50 @@ int zslRandomLevel(void) {
     return (level<ZSKIPLIST_MAXLEVEL) ? level : ZSKIPLIST_MAXLEVEL;
 }
 
+/* score 相同的节点按插入顺序排列，新节点放在最后 */
 zskiplistNode *zslInsert(zskiplist *zsl, unsigned long score, handler_pt func) {
     zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
-    int i, level;
-
-    x = zsl->header;
-    for (i = zsl->level-1; i >= 0; i--) {
+    int i, top, level;
+
+    /* finger search：从第 0 层往上找第一个尾节点不大于 score 的层 top，
+     * 它以上各层的尾节点更靠前，新节点都接在尾后；top 以下从 tail[top] 往下查找。
+     * 到期时间单调递增时 top 为 0，不用查找；找不到这样的层时退化为从 header 查找 */
+    for (top = 0; top < zsl->level; top++) {
+        if (zsl->tail[top] == zsl->header || zsl->tail[top]->score <= score) {
+            break;
+        }
+    }
+    x = top < zsl->level ? zsl->tail[top] : zsl->header;
+    for (i = zsl->level-1; i >= top; i--) {
+        update[i] = zsl->tail[i];
+    }
+    for (i = top-1; i >= 0; i--) {
         while (x->level[i].forward &&
-                x->level[i].forward->score < score)
+                x->level[i].forward->score <= score)
         {
             x = x->level[i].forward;
         }
         update[i] = x;
     }
     level = zslRandomLevel();
+#ifdef ZSKIPLIST_DEBUG
     printf("zskiplist add node level = %d\n", level);
+#endif
+    /* 先分配，失败时跳表保持原样 */
+    x = zslCreateNode(level,score,func);
+    if (!x) return NULL;
     if (level > zsl->level) {
         for (i = zsl->level; i < level; i++) {
             update[i] = zsl->header;
         }
         zsl->level = level;
     }
-    x = zslCreateNode(level,score,func);
     for (i = 0; i < level; i++) {
         x->level[i].forward = update[i]->level[i].forward;
         update[i]->level[i].forward = x;
+        if (!x->level[i].forward) {
+            zsl->tail[i] = x;
+        }
     }
 
     zsl->length++;
@@ -97,6 +119,9 @@ void zslDeleteHead(zskiplist *zsl) {
     for (i = zsl->level-1; i >= 0; i--) {
         if (zsl->header->level[i].forward == x) {
             zsl->header->level[i].forward = x->level[i].forward;
+            if (zsl->tail[i] == x) {
+                zsl->tail[i] = zsl->header;
+            }
         }
     }
     while(zsl->level > 1 && zsl->header->level[zsl->level-1].forward == NULL)
@@ -109,6 +134,9 @@ void zslDeleteNode(zskiplist *zsl, zskiplistNode *x, zskiplistNode **update) {
     for (i = 0; i < zsl->level; i++) {
         if (update[i]->level[i].forward == x) {
             update[i]->level[i].forward = x->level[i].forward;
+            if (zsl->tail[i] == x) {
+                zsl->tail[i] = update[i];
+            }
         }
     }
     while(zsl->level > 1 && zsl->header->level[zsl->level-1].forward == NULL)
@@ -117,7 +145,7 @@ void zslDeleteNode(zskiplist *zsl, zskiplistNode *x, zskiplistNode **update) {
 }
 
 void zslDelete(zskiplist *zsl, zskiplistNode* zn) {
-    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x, *y;
     int i;
 
     x = zsl->header;
@@ -127,13 +155,58 @@ void zslDelete(zskiplist *zsl, zskiplistNode* zn) {
         {
             x = x->level[i].forward;
         }
-        update[i] = x;
+        /* score 相同的节点可能有多个，在本层继续找 zn 本身的前驱 */
+        y = x;
+        while (y->level[i].forward && y->level[i].forward != zn &&
+                y->level[i].forward->score == zn->score)
+        {
+            y = y->level[i].forward;
+        }
+        update[i] = y;
     }
-    x = x->level[0].forward;
-    if (x && zn->score == x->score) {
-        zslDeleteNode(zsl, x, update);
-        free(x);
+    if (update[0]->level[0].forward == zn) {
+        zslDeleteNode(zsl, zn, update);
+        free(zn);
+    }
+}
+
+unsigned long zslCutPrefix(zskiplist *zsl, unsigned long score,
+        void (*visit)(zskiplistNode *node, void *arg), void *arg) {
+    zskiplistNode *x, *head, *next;
+    unsigned long n;
+    int i;
+
+    /* 每层找到最后一个 score <= score 的节点，header 直接跳过它 */
+    head = zsl->header->level[0].forward;
+    x = zsl->header;
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward &&
+                x->level[i].forward->score <= score)
+        {
+            x = x->level[i].forward;
+        }
+        if (x == zsl->header) {
+            continue;
+        }
+        zsl->header->level[i].forward = x->level[i].forward;
+        if (!x->level[i].forward) {
+            zsl->tail[i] = zsl->header;
+        }
+    }
+    if (x == zsl->header) {
+        return 0;
+    }
+    x->level[0].forward = NULL;
+    while(zsl->level > 1 && zsl->header->level[zsl->level-1].forward == NULL)
+        zsl->level--;
+
+    /* 计数和 visit 放在同一遍里，节点只读一次 */
+    for (n = 0, x = head; x; x = next, n++) {
+        next = x->level[0].forward;
+        zsl->length--;
+        visit(x, arg);
     }
+    return n;
 }
 
 void zslPrint(zskiplist *zsl) {
@@ -1,6 +1,9 @@
 #ifndef _MARK_SKIPLIST_
 #define _MARK_SKIPLIST_
 
+#include <stdint.h>
+#include "timer_group.h"
+
 /* ZSETs use a specialized version of Skiplists */
 #define ZSKIPLIST_MAXLEVEL 32 /* Should be enough for 2^64 elements */
 #define ZSKIPLIST_P 0.25      /* Skiplist P = 1/2 */
@@ -12,6 +15,8 @@ struct zskiplistNode {
     // double score;
     unsigned long score; // 时间戳
     handler_pt handler;
+    uint64_t handle; // 定时器句柄，由 skl-timer.h 分配
+    timer_group_link_t group; // 所属的定时器组
      /*struct zskiplistNode *backward; 从后向前遍历时使用*/
     struct zskiplistLevel {
         struct zskiplistNode *forward;
@@ -21,17 +26,24 @@ struct zskiplistNode {
 
 typedef struct zskiplist {
     // 添加一个free的函数
-    struct zskiplistNode *header/*, *tail 并不需要知道最后一个节点*/;
+    struct zskiplistNode *header;
+    // 每层最后一个节点（该层为空时是 header），插入时从尾部往前找，单调递增的到期时间 O(1) 插入
+    struct zskiplistNode *tail[ZSKIPLIST_MAXLEVEL];
     int length;
     int level;
 } zskiplist;
 
 zskiplist *zslCreate(void);
 void zslFree(zskiplist *zsl);
+// 内存不足返回 NULL
 zskiplistNode *zslInsert(zskiplist *zsl, unsigned long score, handler_pt func);
 zskiplistNode* zslMin(zskiplist *zsl);
 void zslDeleteHead(zskiplist *zsl);
 void zslDelete(zskiplist *zsl, zskiplistNode* zn); 
+// 摘下所有 score <= score 的节点，每层只改一次 header 的 forward，再按顺序逐个交给 visit
+// （由它释放节点，其中可以插入、删除，摘下的节点已经不在跳表里），返回摘下的个数
+unsigned long zslCutPrefix(zskiplist *zsl, unsigned long score,
+        void (*visit)(zskiplistNode *node, void *arg), void *arg);
 
 void zslPrint(zskiplist *zsl);
 #endif
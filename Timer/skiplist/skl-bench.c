@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "skiplist.h"
+
+/*
+ * 跳表插入和到期的两处改动与改动前对比，n 个定时器（默认 100 万，参数可改）：
+ *   insert：改动前从 header 往下找（ref_insert，原样保留在这里）vs 从各层尾节点往下找（zslInsert），
+ *           到期时间单调递增（同一毫秒多个）/ 尾部附近抖动 / 完全随机三种分布；
+ *   expire：每次推进 k 个刻度，zslMin + zslDeleteHead 逐个弹出 vs zslCutPrefix 一次摘下。
+ * 每项跑 ROUNDS 次取最小值，输出每个定时器的耗时（ns），同时检查两种方式取出的个数。
+ */
+
+#define ROUNDS 5
+
+static double
+min2(double a, double b) {
+    return a < b ? a : b;
+}
+
+static double
+now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+handler(zskiplistNode *node) {
+    (void)node;
+}
+
+static void
+free_node(zskiplistNode *node, void *arg) {
+    (void)arg;
+    free(node);
+}
+
+int zslRandomLevel(void);
+zskiplistNode *zslCreateNode(int level, unsigned long score, handler_pt func);
+
+// 改动前的 zslInsert：每次从 header 的最高层往下找，不维护 tail
+static zskiplistNode *
+ref_insert(zskiplist *zsl, unsigned long score, handler_pt func) {
+    zskiplistNode *update[ZSKIPLIST_MAXLEVEL], *x;
+    int i, level;
+
+    x = zsl->header;
+    for (i = zsl->level-1; i >= 0; i--) {
+        while (x->level[i].forward &&
+                x->level[i].forward->score < score)
+        {
+            x = x->level[i].forward;
+        }
+        update[i] = x;
+    }
+    level = zslRandomLevel();
+    if (level > zsl->level) {
+        for (i = zsl->level; i < level; i++) {
+            update[i] = zsl->header;
+        }
+        zsl->level = level;
+    }
+    x = zslCreateNode(level, score, func);
+    for (i = 0; i < level; i++) {
+        x->level[i].forward = update[i]->level[i].forward;
+        update[i]->level[i].forward = x;
+    }
+    zsl->length++;
+    return x;
+}
+
+static unsigned long *scores;
+static size_t n;
+
+static void
+gen(int kind) {
+    size_t i;
+    srand(1);
+    for (i = 0; i < n; i++) {
+        switch (kind) {
+        case 0: scores[i] = 1000 + i / 4; break;                 // 单调递增，每毫秒 4 个
+        case 1: scores[i] = 1000 + i / 4 + rand() % 256; break;  // 尾部往前 256ms 内抖动
+        default: scores[i] = 1000 + (unsigned long)rand() % (n * 4); break;
+        }
+    }
+}
+
+static double
+bench_insert(int ref) {
+    zskiplist *zsl = zslCreate();
+    size_t i;
+    srand(2);
+    double t0 = now_ns();
+    for (i = 0; i < n; i++) {
+        if (ref) {
+            ref_insert(zsl, scores[i], handler);
+        } else {
+            zslInsert(zsl, scores[i], handler);
+        }
+    }
+    double t = now_ns() - t0;
+    zslFree(zsl);
+    return t / n;
+}
+
+// 单调递增的 n 个定时器，每次推进 k 个刻度取出到期的；返回每个定时器的耗时，*got 为取出的个数
+static double
+bench_expire(int cut, unsigned long k, size_t *got) {
+    zskiplist *zsl = zslCreate();
+    zskiplistNode *x;
+    unsigned long now, last = 1000 + (n - 1) / 4;
+    size_t i;
+    srand(2);
+    for (i = 0; i < n; i++) {
+        zslInsert(zsl, 1000 + i / 4, handler);
+    }
+    *got = 0;
+    double t0 = now_ns();
+    for (now = 1000 + k - 1; now < last + k; now += k) {
+        if (cut) {
+            *got += zslCutPrefix(zsl, now, free_node, NULL);
+        } else {
+            while ((x = zslMin(zsl)) != NULL && x->score <= now) {
+                zslDeleteHead(zsl);
+                free(x);
+                (*got)++;
+            }
+        }
+    }
+    double t = now_ns() - t0;
+    zslFree(zsl);
+    return t / n;
+}
+
+int main(int argc, char *argv[]) {
+    static const char *kinds[] = {"monotone", "near-tail", "random"};
+    static const unsigned long ks[] = {1, 16, 256, 4096};
+    size_t j, got_pop, got_cut;
+    int ok = 1;
+
+    n = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    scores = malloc(n * sizeof(*scores));
+
+    printf("insert %zu timers (ns/insert)\n", n);
+    printf("  %-10s %10s %10s\n", "", "header", "finger");
+    for (j = 0; j < 3; j++) {
+        double ref = 1e18, fin = 1e18;
+        int r;
+        gen((int)j);
+        for (r = 0; r < ROUNDS; r++) {
+            // 前一轮释放的节点会影响下一轮的内存布局，两种方式轮流先跑
+            if (r & 1) {
+                fin = min2(fin, bench_insert(0));
+                ref = min2(ref, bench_insert(1));
+            } else {
+                ref = min2(ref, bench_insert(1));
+                fin = min2(fin, bench_insert(0));
+            }
+        }
+        printf("  %-10s %10.1f %10.1f\n", kinds[j], ref, fin);
+    }
+
+    printf("expire %zu timers, k ticks per round (ns/timer)\n", n);
+    printf("  %-10s %10s %10s\n", "k", "pop head", "cut");
+    for (j = 0; j < sizeof(ks) / sizeof(ks[0]); j++) {
+        double pop = 1e18, cut = 1e18;
+        int r;
+        for (r = 0; r < ROUNDS; r++) {
+            pop = min2(pop, bench_expire(0, ks[j], &got_pop));
+            cut = min2(cut, bench_expire(1, ks[j], &got_cut));
+            ok = ok && got_pop == n && got_cut == n;
+        }
+        printf("  %-10lu %10.1f %10.1f\n", ks[j], pop, cut);
+    }
+    free(scores);
+    printf(ok ? "check ok\n" : "check FAILED\n");
+    return !ok;
+}
+
+// gcc -O2 skl-bench.c skiplist.c -o skl-bench -I./ -I../common
@@ -10,20 +10,29 @@ void print_hello(zskiplistNode *zn) {
 
 int main()
 {
-    zskiplist *zsl = init_timer();
-    add_timer(zsl, 3010, print_hello);
-    add_timer(zsl, 4004, print_hello);
-    zskiplistNode *zn = add_timer(zsl, 3005, print_hello);
-    del_timer(zsl, zn);
-    add_timer(zsl, 5008, print_hello);
-    add_timer(zsl, 7003, print_hello);
-    // zslPrint(zsl);
+    skl_timer_t *T = init_timer();
+    add_timer(T, 3010, print_hello);
+    add_timer(T, 4004, print_hello);
+    timer_handle_t h = add_timer(T, 3005, print_hello);
+    del_timer(T, h);
+    del_timer(T, h);  // 句柄已失效，重复取消是空操作
+
+    // 一个连接的空闲、写超时、保活定时器放在同一组，关闭连接时一次取消
+    timer_group_t conn;
+    timer_group_init(&conn);
+    add_group_timer(T, 3500, print_hello, &conn);
+    add_group_timer(T, 4500, print_hello, &conn);
+    add_group_timer(T, 6000, print_hello, &conn);
+    printf("cancel_group: %u timers\n", cancel_group(T, &conn));
+    add_timer(T, 5008, print_hello);
+    add_timer(T, 7003, print_hello);
+    // zslPrint(T->zsl);
     for (;;) {
-        expire_timer(zsl);
+        expire_timer(T);
         usleep(10000);
     }
     return 0;
 }
 
 
-// gcc skiplist.c skl-timer.c -o skl -I./
\ No newline at end of file
+// gcc skiplist.c skl-timer.c -o skl -I./ -I../common
\ No newline at end of file
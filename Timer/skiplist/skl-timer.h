@@ -23,7 +23,21 @@
 #include<time.h>
 #endif
 
+#include<stdbool.h>
+
 #include"skiplist.h"
+#include"timer_handle.h"
+#include"timer_budget.h"
+#include"timer_expired.h"
+#include"timer_probe.h"
+
+// 定时器实例：跳表加上它自己的句柄槽位表，以及每次 expire_timer 的触发预算
+typedef struct skl_timer_s {
+    zskiplist *zsl;
+    handle_table_t handles;
+    timer_budget_t budget;          // 默认不限
+    timer_budget_stat_t budget_stat;
+} skl_timer_t;
 
 static uint32_t
 current_time() {
@@ -42,32 +56,174 @@ current_time() {
 	return t;
 }
 
-zskiplist *init_timer(){
-    return zslCreate();
+skl_timer_t *init_timer(){
+    skl_timer_t *T = calloc(1, sizeof(*T));
+    T->zsl = zslCreate();
+    handle_table_init(&T->handles);
+    return T;
 }
 
-zskiplistNode *add_timer(zskiplist *zsl,uint32_t msec,handler_pt func){
-    msec += current_time();
+// 添加定时器并挂到组 g 里（g 为 NULL 不入组），关闭连接时用 cancel_group 一次取消整组
+timer_handle_t add_group_timer(skl_timer_t *T, uint32_t msec, handler_pt func, timer_group_t *g){
+    uint32_t now = current_time();
+    msec += now;
     printf("add_timer expire at msec = %u\n", msec);
-    return zslInsert(zsl, msec, func);
+    zskiplistNode *zn = zslInsert(T->zsl, msec, func);
+    if (!zn) {
+        return TIMER_HANDLE_INVALID;
+    }
+    zn->handle = handle_alloc(&T->handles, zn);
+    if (zn->handle == TIMER_HANDLE_INVALID) {
+        zslDelete(T->zsl, zn);  // 会释放节点
+        return TIMER_HANDLE_INVALID;
+    }
+    timer_group_attach(g, &zn->group);
+    TIMER_PROBE_ADD(zn->handle, msec, now);
+    return zn->handle;
+}
+
+timer_handle_t add_timer(skl_timer_t *T, uint32_t msec, handler_pt func){
+    return add_group_timer(T, msec, func, NULL);
+}
+
+// 句柄已失效（已触发或已取消）时直接返回 false，不会访问已释放的节点
+bool del_timer(skl_timer_t *T, timer_handle_t h) {
+    zskiplistNode *zn = handle_release(&T->handles, h);
+    if (!zn) {
+        return false;
+    }
+    TIMER_PROBE_DEL(h, zn->score);
+    timer_group_detach(&zn->group);
+    zslDelete(T->zsl, zn);
+    return true;
+}
+
+// 沿组链表逐个摘除，不按句柄查找；返回取消的个数
+unsigned cancel_group(skl_timer_t *T, timer_group_t *g) {
+    timer_group_link_t *l;
+    unsigned n = 0;
+    while ((l = timer_group_pop(g)) != NULL) {
+        zskiplistNode *zn = timer_group_entry(l, zskiplistNode, group);
+        handle_release(&T->handles, zn->handle);
+        TIMER_PROBE_DEL(zn->handle, zn->score);
+        zslDelete(T->zsl, zn);
+        n++;
+    }
+    return n;
+}
+
+
+// 返回距离最近到期定时器的毫秒数，没有定时器返回 -1，有积压时返回 0
+int find_nearest_expire_timer(skl_timer_t *T) {
+    zskiplistNode *x = zslMin(T->zsl);
+    if (!x) return -1;
+    int diff = (int)x->score - (int)current_time();
+    return diff > 0 ? diff : 0;
+}
+
+// 每次 expire_timer 最多触发 max_count 个 / 最多占用 max_usec 微秒，0 表示不限
+void set_expire_budget(skl_timer_t *T, uint32_t max_count, uint32_t max_usec) {
+    T->budget.max_count = max_count;
+    T->budget.max_usec = max_usec;
 }
 
-void del_timer(zskiplist *zsl, zskiplistNode *zn) {
-    zslDelete(zsl, zn);
+// 不限预算时用 zslCutPrefix 一次摘下所有到期节点再逐个触发，回调里新加的已到期定时器留到下一轮。
+// 回调里取消同一批还没触发的定时器时，句柄已经释放、zslDelete 在跳表里找不到它，留给这里释放
+typedef struct skl_expire_cut_s {
+    skl_timer_t *T;
+    uint32_t now;
+    uint32_t fired;
+} skl_expire_cut_t;
+
+static void
+expire_cut_visit(zskiplistNode *x, void *arg) {
+    skl_expire_cut_t *c = arg;
+    if (!handle_release(&c->T->handles, x->handle)) {
+        free(x);
+        return;
+    }
+    printf("touch timer expire time=%lu, now = %u\n", x->score, c->now);
+    timer_group_detach(&x->group);
+    TIMER_PROBE_FIRE(x->handle, x->score, (int32_t)(c->now - (uint32_t)x->score));
+    if (x->handler) {
+        x->handler(x);
+    }
+    free(x);
+    c->fired++;
 }
 
+static uint32_t
+expire_cut(skl_timer_t *T, uint32_t now) {
+    skl_expire_cut_t c = {T, now, 0};
+    zslCutPrefix(T->zsl, now, expire_cut_visit, &c);
+    return c.fired;
+}
 
-void expire_timer(zskiplist *zsl) {
+void expire_timer(skl_timer_t *T) {
     zskiplistNode *x;
     uint32_t now = current_time();
+    uint32_t fired = 0;
+    uint64_t start = T->budget.max_usec ? timer_budget_now_us() : 0;
+    T->budget_stat.backlog = false;
+    if (!T->budget.max_count && !T->budget.max_usec) {
+        // 没有到期的不用往下找
+        if ((x = zslMin(T->zsl)) != NULL && x->score <= now) {
+            T->budget_stat.fired += expire_cut(T, now);
+        }
+        return;
+    }
     for (;;) {
-        x = zslMin(zsl);
+        x = zslMin(T->zsl);
         if (!x) break;
         if (x->score > now) break;
+        // 预算用完，剩下的留在跳表里，仍按到期时间排列
+        if (timer_budget_exhausted(&T->budget, fired, start)) {
+            T->budget_stat.exhausted++;
+            T->budget_stat.backlog = true;
+            T->budget_stat.backlog_lag_ms = now - (uint32_t)x->score;
+            break;
+        }
         printf("touch timer expire time=%lu, now = %u\n", x->score, now);
-        x->handler(x);
-        zslDeleteHead(zsl);
+        zslDeleteHead(T->zsl);
+        handle_release(&T->handles, x->handle);
+        timer_group_detach(&x->group);  // 先离开组，回调里 cancel_group 不会再碰到它
+        TIMER_PROBE_FIRE(x->handle, x->score, (int32_t)(now - (uint32_t)x->score));
+        if (x->handler) {
+            x->handler(x);
+        }
+        free(x);
+        fired++;
+    }
+    T->budget_stat.fired += fired;
+}
+
+// 不执行回调，按到期顺序取出最多 max 个到期时间 <= now 的定时器写入 out，返回个数；
+// 和 add_timer / del_timer 在同一个线程调用，跨线程取需要调用者自己加锁
+unsigned expire_into(skl_timer_t *T, timer_expired_t *out, unsigned max, uint32_t now) {
+    zskiplistNode *x;
+    unsigned n = 0;
+    while (n < max && (x = zslMin(T->zsl)) != NULL && x->score <= now) {
+        zslDeleteHead(T->zsl);
+        handle_release(&T->handles, x->handle);
+        timer_group_detach(&x->group);
+        TIMER_PROBE_FIRE(x->handle, x->score, (int32_t)(now - (uint32_t)x->score));
+        out[n].handle = x->handle;
+        out[n].expire = (uint32_t)x->score;
+        free(x);
+        n++;
+    }
+    return n;
+}
+
+// 当前积压的已到期定时器个数，沿第 0 层往后数，按需调用
+unsigned expired_backlog(skl_timer_t *T) {
+    zskiplistNode *x = T->zsl->header->level[0].forward;
+    uint32_t now = current_time();
+    unsigned n = 0;
+    for (; x && x->score <= now; x = x->level[0].forward) {
+        n++;
     }
+    return n;
 }
 
 #endif
\ No newline at end of file
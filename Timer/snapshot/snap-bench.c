@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include "minheap.h"
+#include "rbtree.h"
+#include "timer_handle.h"
+#include "timer_snapshot.h"
+
+/*
+ * 快照恢复耗时：N 个（默认 1000 万）1ms~1h 的会话定时器，
+ *   逐个插入     —— 重启后逐个 add_timer 的做法；
+ *   写快照       —— mmap 写出剩余时间 / 句柄 / 载荷；
+ *   快照恢复     —— mmap 读入，重新挂到单调时钟上，最小堆 O(n) 建堆，红黑树有序 O(n) 建树。
+ * 两种做法的节点都来自预先分配的数组，只比较建索引和句柄表的开销。
+ */
+
+#define SNAP_PATH "/tmp/mark-timer.snap"
+
+typedef struct rbt_entry_s {
+    ngx_rbtree_node_t rbnode;
+    timer_handle_t handle;
+} rbt_entry_t;
+
+static double
+now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t
+now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 黑高一致、红节点没有红孩子时返回黑高，否则返回 -1
+static int
+rbt_check(ngx_rbtree_node_t *node, ngx_rbtree_node_t *sentinel) {
+    if (node == sentinel) {
+        return 1;
+    }
+    if (ngx_rbt_is_red(node) && (ngx_rbt_is_red(node->left) || ngx_rbt_is_red(node->right))) {
+        return -1;
+    }
+    int l = rbt_check(node->left, sentinel);
+    int r = rbt_check(node->right, sentinel);
+    if (l < 0 || l != r) {
+        return -1;
+    }
+    return l + ngx_rbt_is_black(node);
+}
+
+static void
+bench_minheap(unsigned n) {
+    min_heap_t heap;
+    handle_table_t handles;
+    timer_snapshot_t snap;
+    unsigned i;
+    double t0, t_push, t_save, t_restore;
+    uint32_t now = now_ms();
+    timer_entry_t *es = (timer_entry_t *)calloc(n, sizeof(*es));
+
+    srand(1);
+    min_heap_ctor_(&heap);
+    handle_table_init(&handles);
+    t0 = now_sec();
+    for (i = 0; i < n; i++) {
+        es[i].time = now + 1 + rand() % 3600000;
+        es[i].handle = handle_alloc(&handles, &es[i]);
+        min_heap_push_(&heap, &es[i]);
+    }
+    t_push = now_sec() - t0;
+    uint32_t min_before = min_heap_top_(&heap)->time - now;
+
+    t0 = now_sec();
+    timer_snapshot_create(&snap, SNAP_PATH, heap.n, 0);
+    for (i = 0; i < heap.n; i++) {
+        snap.e[i].remain = (int32_t)(min_heap_at(&heap, i)->time - now);
+        snap.e[i].handle = min_heap_at(&heap, i)->handle;
+        snap.e[i].payload = i;
+    }
+    timer_snapshot_close(&snap);
+    t_save = now_sec() - t0;
+
+    min_heap_dtor_(&heap);
+    handle_table_free(&handles);
+    min_heap_ctor_(&heap);
+
+    t0 = now_sec();
+    timer_snapshot_open(&snap, SNAP_PATH);
+    int64_t elapsed = 0;  // 同一次运行内，不扣停机时间
+    now = now_ms();
+    min_heap_reserve_(&heap, snap.hdr->count);
+    for (i = 0; i < snap.hdr->count; i++) {
+        timer_entry_t *te = &es[i];
+        te->time = timer_snapshot_rebase(&snap.e[i], elapsed, now);
+        te->handle = snap.e[i].handle;
+        te->privdata = (void *)(uintptr_t)snap.e[i].payload;
+        handle_restore(&handles, te->handle, te);
+        min_heap_at(&heap, heap.n) = te;
+        heap.n++;
+    }
+    handle_table_relink(&handles);
+    min_heap_heapify_(&heap);
+    timer_snapshot_close(&snap);
+    t_restore = now_sec() - t0;
+
+    timer_entry_t *top = min_heap_top_(&heap);
+    printf("%-10s %12.3f %12.3f %12.3f %8s\n", "minheap", t_push, t_save, t_restore,
+        top->time - now == min_before && handle_get(&handles, top->handle) == top ? "ok" : "BAD");
+    min_heap_dtor_(&heap);
+    handle_table_free(&handles);
+    free(es);
+}
+
+static void
+bench_rbtree(unsigned n) {
+    ngx_rbtree_t tree;
+    ngx_rbtree_node_t sentinel, *node, **nodes;
+    handle_table_t handles;
+    timer_snapshot_t snap;
+    unsigned i;
+    double t0, t_insert, t_save, t_restore;
+    uint32_t now = now_ms();
+    rbt_entry_t *es = (rbt_entry_t *)calloc(n, sizeof(*es));
+
+    srand(1);
+    ngx_rbtree_init(&tree, &sentinel, ngx_rbtree_insert_timer_value);
+    handle_table_init(&handles);
+    t0 = now_sec();
+    for (i = 0; i < n; i++) {
+        es[i].rbnode.key = now + 1 + rand() % 3600000;
+        es[i].handle = handle_alloc(&handles, &es[i]);
+        ngx_rbtree_insert(&tree, &es[i].rbnode);
+    }
+    t_insert = now_sec() - t0;
+
+    t0 = now_sec();
+    timer_snapshot_create(&snap, SNAP_PATH, n, TIMER_SNAPSHOT_SORTED);
+    i = 0;
+    for (node = ngx_rbtree_min(tree.root, tree.sentinel); node; node = ngx_rbtree_next(&tree, node)) {
+        rbt_entry_t *te = (rbt_entry_t *)((char *)node - offsetof(rbt_entry_t, rbnode));
+        snap.e[i].remain = (int32_t)(node->key - now);
+        snap.e[i].handle = te->handle;
+        snap.e[i].payload = 0;
+        i++;
+    }
+    timer_snapshot_close(&snap);
+    t_save = now_sec() - t0;
+
+    handle_table_free(&handles);
+    ngx_rbtree_init(&tree, &sentinel, ngx_rbtree_insert_timer_value);
+
+    t0 = now_sec();
+    timer_snapshot_open(&snap, SNAP_PATH);
+    now = now_ms();
+    nodes = (ngx_rbtree_node_t **)malloc(snap.hdr->count * sizeof(*nodes));
+    for (i = 0; i < snap.hdr->count; i++) {
+        rbt_entry_t *te = &es[i];
+        te->rbnode.key = timer_snapshot_rebase(&snap.e[i], 0, now);
+        te->handle = snap.e[i].handle;
+        handle_restore(&handles, te->handle, te);
+        nodes[i] = &te->rbnode;
+    }
+    handle_table_relink(&handles);
+    ngx_rbtree_build(&tree, nodes, snap.hdr->count);
+    free(nodes);
+    timer_snapshot_close(&snap);
+    t_restore = now_sec() - t0;
+
+    int ok = rbt_check(tree.root, tree.sentinel) > 0;
+    for (i = 0, node = ngx_rbtree_min(tree.root, tree.sentinel); ok && node; node = ngx_rbtree_next(&tree, node), i++) {
+        ok = node == &es[i].rbnode;
+    }
+    printf("%-10s %12.3f %12.3f %12.3f %8s\n", "rbtree", t_insert, t_save, t_restore,
+        ok && i == n ? "ok" : "BAD");
+    handle_table_free(&handles);
+    free(es);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned n = argc > 1 ? (unsigned)atoi(argv[1]) : 10000000;
+    printf("timers = %u\n", n);
+    printf("%-10s %12s %12s %12s %8s\n", "backend", "one-by-one s", "save s", "restore s", "check");
+    bench_minheap(n);
+    bench_rbtree(n);
+    unlink(SNAP_PATH);
+    return 0;
+}
+
+// gcc -O2 snap-bench.c ../minheap/minheap.c ../rbtree/rbtree.c -o snap-bench -I../minheap -I../rbtree -I../common
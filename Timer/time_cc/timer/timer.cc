@@ -1,9 +1,15 @@
 #include<sys/epoll.h>
+#include<unistd.h>
 #include<functional> // 用于 std::function 回调函数
 #include<chrono>  //高精度时间处理
 #include<set> //有序集合
 #include<memory> //智能指针
+#include<vector> //暂存区
 #include<iostream>
+#include"../../common/timer_probe.h" //USDT 探针，句柄用定时器 id
+#if defined(__linux__)
+#include"../../common/timer_rt.h" //低延迟模式：绑核、SCHED_FIFO、mlockall、忙等，只有 Linux 有
+#endif
 
 using namespace std;
 
@@ -11,6 +17,7 @@ using namespace std;
 struct TimerNodeBase {
     time_t expire;   //定时器过期时间，单位ms，从epoch
     int64_t id;   //定时器唯一标识，用于在相同过期时间情况下区分
+    int32_t stage = -1;   //在暂存区中的下标，-1 表示在有序集合中（不参与排序）
 };
 
 //定时器节点的派生类，包含回调函数
@@ -73,63 +80,353 @@ public:
         return temp.count();  
     }
 
+    //开启暂存区：新定时器先追加到无序的暂存区，暂存区里最早的定时器到期，
+    //或暂存区存在超过 max_age 毫秒时，才把其中未取消的定时器一次并入有序集合；
+    //在暂存区里取消是 O(1)，很快被取消的请求超时从头到尾都不需要排序
+    void EnableStaging(time_t max_age){
+        stage_max_age = max_age;
+    }
+
+    //暂存区统计
+    struct StageStat {
+        uint64_t staged = 0;      // 进入暂存区的个数
+        uint64_t cancelled = 0;   // 在暂存区里就被取消、从未排序的个数
+        uint64_t merged = 0;      // 并入有序集合的个数
+    };
+    const StageStat &GetStageStat() const { return stage_stat; }
+
     //添加定时器：参数为延迟时间（ms）和回调函数
     TimerNodeBase AddTimer(time_t msec,TimerNode::Callback func){
+        time_t now = GetTick();
         //计算过期时间
-        time_t expire = GetTick() + msec;
-        //判断是否插入到集合末尾（优化性能）
-        if(timeouts.empty() || expire <= timeouts.crbegin()->expire){
-            // emplace 直接构造元素并插入（返回值为 pair<iterator, bool>）
-            //在容器内部构造，防止外部构造之后再拷贝
-            //里面的move是把func的资源直接转移给容器内新构造的对象，避免拷贝
-            auto pairs = timeouts.emplace(GenID(),expire,std::move(func));
-            // 返回基类对象（通过 static_cast 转换）,避免暴漏子类的内部实现
-            return static_cast<TimerNodeBase>(*pairs.first);
+        time_t expire = now + msec;
+        if(stage_max_age >= 0){
+            if(stage.empty()){
+                stage_since = now;
+                stage_min = expire;
+            }else if(expire < stage_min){
+                stage_min = expire;
+            }
+            TimerNodeBase node;
+            node.expire = expire;
+            node.id = GenID();
+            node.stage = (int32_t)stage.size();
+            stage.push_back(StagedTimer{node.expire, node.id, std::move(func), false});
+            stage_live++;
+            stage_stat.staged++;
+            TIMER_PROBE_ADD(node.id, expire, now);
+            return node;
         }
-        //如果一直使用同一个msec，可能会一直向最右边插入，模版提供crbegin直接访问到红黑树最右侧节点
-        /*
-        emplace_hint 允许你提供一个迭代器作为插入位置的提示。容器会尝试在该提示位置附近插入新元素，这样可以减少插入操作所需的查找时间，从而优化性能
-        timeouts.crbegin()：crbegin() 是 std::set 容器的一个成员函数，它返回一个常量反向迭代器，指向容器的最后一个元素。反向迭代器的方向与正向迭代器相反，所以 crbegin() 指向的是容器中按排序规则最大的元素。
-        .base()：base() 是反向迭代器的一个成员函数，它将反向迭代器转换为对应的正向迭代器。因为 emplace_hint 函数需要的是正向迭代器作为提示位置，所以需要将反向迭代器转换为正向迭代器。
-        综合起来，timeouts.crbegin().base() 得到的是指向容器中最后一个元素之后位置的正向迭代器，作为插入位置的提示。
-        */
-        auto ele = timeouts.emplace_hint(timeouts.crbegin().base(),GenID(),expire,std::move(func));
-        return static_cast<TimerNodeBase>(*ele);
+        TimerNodeBase node = Insert(GenID(), expire, std::move(func));
+        TIMER_PROBE_ADD(node.id, expire, now);
+        return node;
     }
 
-    //删除定时器：根据TimerNodeBase对象删除
+    //删除定时器：根据TimerNodeBase对象删除，还在暂存区里时按下标 O(1) 标记取消
     bool DelTimer(TimerNodeBase &node){
+        if(node.stage >= 0 && (size_t)node.stage < stage.size() && stage[node.stage].id == node.id){
+            StagedTimer &st = stage[node.stage];
+            if(st.cancelled){
+                return false;
+            }
+            st.cancelled = true;
+            st.func = nullptr;  //尽早释放回调捕获的资源
+            TIMER_PROBE_DEL(node.id, node.expire);
+            stage_stat.cancelled++;
+            if(--stage_live == 0){
+                stage.clear();  //全部取消，暂存区直接清空复用
+            }
+            return true;
+        }
+        //已经并入有序集合（下标对不上 id），按 (expire, id) 查找
         auto iter = timeouts.find(node);  //在set中查找节点
         if(iter != timeouts.end()){
+            TIMER_PROBE_DEL(node.id, node.expire);
             timeouts.erase(iter);
             return true;
         }
         return false;
     }
 
-    //处理到期的定时器，遍历并执行回调
+    //设置每次 HandleTimer 的预算：最多触发 max_count 个、最多占用 slice，0 表示不限
+    //预算用完时剩下的已到期定时器留在集合里，仍按到期时间排序，下一轮接着处理
+    void SetBudget(size_t max_count, chrono::microseconds slice = chrono::microseconds(0)){
+        budget_count = max_count;
+        budget_slice = slice;
+    }
+
+    //积压统计
+    struct BudgetStat {
+        uint64_t fired = 0;       // 累计触发个数
+        uint64_t exhausted = 0;   // 因预算用完而提前返回的次数
+        time_t backlog_lag = 0;   // 最近一次返回时，积压中最早的定时器已超时多少毫秒
+        bool backlog = false;     // 最近一次返回时是否还有已到期未触发的定时器
+    };
+    const BudgetStat &GetBudgetStat() const { return stat; }
+
+    //处理到期的定时器，遍历并执行回调，受预算限制
     void HandleTimer(time_t now){
+        FlushStage(now);
         auto iter = timeouts.begin();
+        size_t fired = 0;
+        auto start = chrono::steady_clock::now();
+        stat.backlog = false;
         //循环处理所有过期时间 <= now的定时器
         while(iter != timeouts.end() && iter->expire <= now){
-            iter->func(*iter);  // 执行回调函数（传入当前节点引用）
+            //预算用完：记下积压情况后返回，让 epoll_wait 先处理 I/O
+            if(BudgetExhausted(fired, start)){
+                stat.exhausted++;
+                stat.backlog = true;
+                stat.backlog_lag = now - iter->expire;
+                break;
+            }
+            TIMER_PROBE_FIRE(iter->id, iter->expire, now - iter->expire);
+            if(iter->func){  // 只给 ExpireInto 取的定时器可以不带回调
+                iter->func(*iter);  // 执行回调函数（传入当前节点引用）
+            }
             // 删除节点并获取下一个迭代器（避免迭代器失效）
             iter = timeouts.erase(iter);
+            fired++;
+        }
+        stat.fired += fired;
+    }
+
+    //不执行回调：按到期顺序取出最多 max 个过期时间 <= now 的定时器写入 out，返回个数，
+    //没取完的留在集合里；取出的节点回调直接丢弃，调用者按 (expire, id) 对应自己的记录批量处理
+    size_t ExpireInto(TimerNodeBase *out, size_t max, time_t now){
+        FlushStage(now);
+        size_t n = 0;
+        auto iter = timeouts.begin();
+        while(n < max && iter != timeouts.end() && iter->expire <= now){
+            TIMER_PROBE_FIRE(iter->id, iter->expire, now - iter->expire);
+            out[n++] = static_cast<TimerNodeBase>(*iter);
+            iter = timeouts.erase(iter);
         }
+        return n;
     }
 
-    //计算剩余睡眠时间：返回距离下一个定时器到期的时间（ms）
+    //当前积压的已到期定时器个数，只遍历已到期的部分，按需调用
+    size_t Backlog(time_t now){
+        size_t n = 0;
+        for(auto iter = timeouts.begin(); iter != timeouts.end() && iter->expire <= now; ++iter){
+            n++;
+        }
+        return n;
+    }
+
+    //按 fd 的空闲超时（惰性刷新）：收发数据时 Touch 只记最近活动时间，不动定时器；
+    //每个 fd 底层只有一个定时器，到期时发现期间有过活动就按剩余时间重新挂上，真的空闲满 timeout 才回调。
+    //已经在监视时重新开始计时；回调只执行一次，关闭连接前调用 UnwatchIdle
+    using IdleCallback = std::function<void(int fd)>;
+    bool WatchIdle(int fd, time_t timeout, IdleCallback func){
+        if(fd < 0 || timeout <= 0){
+            return false;
+        }
+        if((size_t)fd >= idle.size()){
+            idle.resize(fd + 1);
+        }
+        IdleSlot &s = idle[fd];
+        if(s.timeout > 0){
+            DelTimer(s.node);
+        }
+        s.last_active = GetTick();
+        s.timeout = timeout;
+        s.func = std::move(func);
+        s.node = ArmIdle(fd, timeout);
+        return true;
+    }
+
+    //收发数据时调用，只写一个时间戳；没有监视的 fd 忽略，也不计入 touched
+    void Touch(int fd, time_t now){
+        if(fd >= 0 && (size_t)fd < idle.size() && idle[fd].timeout > 0){
+            idle[fd].last_active = now;
+            idle_stat.touched++;
+        }
+    }
+
+    bool UnwatchIdle(int fd){
+        if(fd < 0 || (size_t)fd >= idle.size() || idle[fd].timeout <= 0){
+            return false;
+        }
+        IdleSlot &s = idle[fd];
+        DelTimer(s.node);
+        s.timeout = 0;
+        s.func = nullptr;
+        return true;
+    }
+
+    //空闲超时统计
+    struct IdleStat {
+        uint64_t touched = 0;     // 记录活动的次数
+        uint64_t rearmed = 0;     // 到期时发现有活动、按剩余时间重挂的次数
+        uint64_t fired = 0;       // 真正空闲超时回调的次数
+    };
+    const IdleStat &GetIdleStat() const { return idle_stat; }
+
+    //计算剩余睡眠时间：返回距离下一个定时器到期的时间（ms），有积压时返回 0
+    //暂存区不需要排序，用它的最早到期时间参与比较即可
     time_t TimeToSleep(){
         auto iter = timeouts.begin();
-        if(iter == timeouts.end()){
+        bool staged = stage_live > 0;
+        if(iter == timeouts.end() && !staged){
             //无定时器返回-1，epoll永久阻塞
             return -1;
         }
-        time_t diss = iter->expire - GetTick(); // 计算当前时间到最近过期时间的差值
+        time_t expire = iter != timeouts.end() ? iter->expire : stage_min;
+        if(staged && stage_min < expire){
+            expire = stage_min;
+        }
+        time_t diss = expire - GetTick(); // 计算当前时间到最近过期时间的差值
         return diss > 0  ? diss : 0; // 差值为负时返回 0（立即触发）
     }
 
+    //低延迟模式，在跑事件循环的线程上调用：mlockall 并预先触碰栈，绑到 cpu（-1 不绑），
+    //fifo_prio > 0 时切到 SCHED_FIFO；之后 WaitEvents 的 epoll_wait 只睡到截止前 1ms，
+    //剩下的 clock_nanosleep + 忙等对准毫秒边界。节点由 std::set 分配，没有节点池可以预分配。
+    //返回 0 全部成功，-1 不是 Linux（不支持），否则为 TIMER_RT_NO_* 的组合（没有权限的项被跳过，照常运行）
+    int EnableRealtime(int cpu, int fifo_prio){
+#if defined(__linux__)
+        int ret = 0;
+        if(timer_rt_lock_memory() < 0){
+            ret |= TIMER_RT_NO_MLOCK;
+        }
+        if(cpu >= 0 && timer_rt_pin(cpu) < 0){
+            ret |= TIMER_RT_NO_PIN;
+        }
+        if(fifo_prio > 0 && timer_rt_fifo(fifo_prio) < 0){
+            ret |= TIMER_RT_NO_FIFO;
+        }
+        rt = true;
+        return ret;
+#else
+        (void)cpu;
+        (void)fifo_prio;
+        return -1;
+#endif
+    }
+
+    //事件循环里代替 epoll_wait(epfd, ev, max, TimeToSleep())
+    int WaitEvents(int epfd, epoll_event *ev, int max){
+        time_t ms = TimeToSleep();
+        if(!rt || ms <= 0){
+            return epoll_wait(epfd, ev, max, (int)ms);
+        }
+#if defined(__linux__)
+        time_t deadline = GetTick() + ms;
+        int n = epoll_wait(epfd, ev, max, (int)(ms - 1));
+        if(n != 0){
+            return n;  //先处理 I/O（或出错）
+        }
+        timer_rt_wait_until((uint64_t)deadline * 1000000ull, TIMER_RT_SPIN_NS);
+        return epoll_wait(epfd, ev, max, 0);  //忙等期间到达的 I/O 一起取走
+#else
+        return epoll_wait(epfd, ev, max, (int)ms);
+#endif
+    }
+
 private:
+    //插入有序集合
+    TimerNodeBase Insert(int64_t id,time_t expire,TimerNode::Callback func){
+        //判断是否插入到集合末尾（优化性能）
+        if(timeouts.empty() || expire <= timeouts.crbegin()->expire){
+            // emplace 直接构造元素并插入（返回值为 pair<iterator, bool>）
+            //在容器内部构造，防止外部构造之后再拷贝
+            //里面的move是把func的资源直接转移给容器内新构造的对象，避免拷贝
+            auto pairs = timeouts.emplace(id,expire,std::move(func));
+            // 返回基类对象（通过 static_cast 转换）,避免暴漏子类的内部实现
+            return static_cast<TimerNodeBase>(*pairs.first);
+        }
+        //如果一直使用同一个msec，可能会一直向最右边插入，模版提供crbegin直接访问到红黑树最右侧节点
+        /*
+        emplace_hint 允许你提供一个迭代器作为插入位置的提示。容器会尝试在该提示位置附近插入新元素，这样可以减少插入操作所需的查找时间，从而优化性能
+        timeouts.crbegin()：crbegin() 是 std::set 容器的一个成员函数，它返回一个常量反向迭代器，指向容器的最后一个元素。反向迭代器的方向与正向迭代器相反，所以 crbegin() 指向的是容器中按排序规则最大的元素。
+        .base()：base() 是反向迭代器的一个成员函数，它将反向迭代器转换为对应的正向迭代器。因为 emplace_hint 函数需要的是正向迭代器作为提示位置，所以需要将反向迭代器转换为正向迭代器。
+        综合起来，timeouts.crbegin().base() 得到的是指向容器中最后一个元素之后位置的正向迭代器，作为插入位置的提示。
+        */
+        auto ele = timeouts.emplace_hint(timeouts.crbegin().base(),id,expire,std::move(func));
+        return static_cast<TimerNodeBase>(*ele);
+    }
+
+    struct StagedTimer {
+        time_t expire;
+        int64_t id;
+        TimerNode::Callback func;
+        bool cancelled;
+    };
+
+    //暂存区里最早的定时器已到期，或暂存区太老，把未取消的定时器并入有序集合
+    void FlushStage(time_t now){
+        if(stage.empty() || (stage_min > now && now - stage_since < stage_max_age)){
+            return;
+        }
+        for(auto &st : stage){
+            if(!st.cancelled){
+                Insert(st.id, st.expire, std::move(st.func));
+                stage_stat.merged++;
+            }
+        }
+        stage.clear();
+        stage_live = 0;
+    }
+
+    struct IdleSlot {
+        time_t last_active = 0;                       // 最近一次活动的时间
+        time_t timeout = 0;                           // 0 表示没有在监视
+        TimerNodeBase node;                           // 底层定时器
+        IdleCallback func;
+    };
+
+    //底层定时器的回调只带 fd 和自己的 id，id 对不上说明已经取消或重新监视过
+    TimerNodeBase ArmIdle(int fd, time_t msec){
+        return AddTimer(msec, [this, fd](const TimerNode &node){
+            OnIdleTimer(fd, node.id);
+        });
+    }
+
+    void OnIdleTimer(int fd, int64_t id){
+        if((size_t)fd >= idle.size() || idle[fd].timeout <= 0 || idle[fd].node.id != id){
+            return;
+        }
+        IdleSlot &s = idle[fd];
+        time_t idle_ms = GetTick() - s.last_active;
+        if(idle_ms < s.timeout){
+            //期间有过活动，按剩余时间重挂
+            s.node = ArmIdle(fd, s.timeout - idle_ms);
+            idle_stat.rearmed++;
+            return;
+        }
+        s.timeout = 0;
+        idle_stat.fired++;
+        IdleCallback func = std::move(s.func);
+        s.func = nullptr;
+        func(fd);  //回调里可以关闭 fd、重新 WatchIdle
+    }
+
+    vector<IdleSlot> idle;                            // 按 fd 下标索引
+    IdleStat idle_stat;
+
+    time_t stage_max_age = -1;                        // -1 表示不使用暂存区
+    vector<StagedTimer> stage;                        // 只追加，不排序
+    size_t stage_live = 0;                            // 暂存区中未取消的个数
+    time_t stage_min = 0;                             // 暂存区中最早的到期时间（取消后不回退，偏保守）
+    time_t stage_since = 0;                           // 暂存区第一个定时器的加入时间
+    StageStat stage_stat;
+
+    //时间片每触发 16 个才检查一次，避免每个定时器都读时钟
+    bool BudgetExhausted(size_t fired, chrono::steady_clock::time_point start){
+        if(budget_count && fired >= budget_count){
+            return true;
+        }
+        return budget_slice.count() && fired && fired % 16 == 0
+            && chrono::steady_clock::now() - start >= budget_slice;
+    }
+
+    size_t budget_count = 0;                          // 默认不限
+    chrono::microseconds budget_slice{0};
+    BudgetStat stat;
+
+    bool rt = false;                                  // 低延迟模式，见 EnableRealtime
+
     //生成唯一ID（静态成员，保证每个定时器的ID唯一）
     static int64_t GenID(){
         return gid++;   
@@ -147,13 +444,21 @@ private:
 // 初始化静态成员 gid
 int64_t Timer::gid = 0;
 
-int main(){
+int main(int argc, char *argv[]){
     //创建epoll实例
     int epfd = epoll_create(1);
 
     //创建定时器管理对象
     //std::unique_ptr<Timer> timer(new Timer());
     unique_ptr<Timer> timer = make_unique<Timer>();
+    //每轮最多触发 1000 个或占用 2ms，定时器风暴时不会饿死 I/O
+    timer->SetBudget(1000, chrono::microseconds(2000));
+    //新定时器先进暂存区，50ms 内被取消的不会进入红黑树
+    timer->EnableStaging(50);
+    // ./timer --rt：事件循环线程绑到 0 号核，能切 SCHED_FIFO 就切，截止前忙等对准毫秒边界
+    if (argc > 1 && string(argv[1]) == "--rt") {
+        cout << "rt mode enabled, unavailable flags = " << timer->EnableRealtime(0, 50) << endl;
+    }
 
     int i = 0;  //用于统计定时器的触发次数
 
@@ -178,6 +483,39 @@ int main(){
     });
     timer->DelTimer(node);  // 删除刚添加的第四个定时器（不会触发）
 
+    // 模拟 1000 个请求超时，请求很快完成，超时在暂存区里就被 O(1) 取消
+    for (int k = 0; k < 1000; k++) {
+        auto req = timer->AddTimer(5000, [&](const TimerNode &node) {
+            cout << "request timeout, never printed" << endl;
+        });
+        timer->DelTimer(req);
+    }
+    cout << "staged:" << timer->GetStageStat().staged
+         << " cancelled in stage:" << timer->GetStageStat().cancelled
+         << " merged:" << timer->GetStageStat().merged << endl;
+
+    // 连接 1000ms 没有数据就关闭；对端在 300/600/900ms 各发一次，收包只 Touch，
+    // 1000ms 时底层定时器发现有活动，按剩余的 900ms 重挂一次，1900ms 关闭
+    int pipefd[2];
+    if (pipe(pipefd) == 0) {
+        epoll_event rev = {};
+        rev.events = EPOLLIN;
+        rev.data.fd = pipefd[0];
+        epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &rev);
+        timer->WatchIdle(pipefd[0], 1000, [&](int fd) {
+            cout << Timer::GetTick() << " fd " << fd << " idle, close (touched "
+                 << timer->GetIdleStat().touched << ", rearmed " << timer->GetIdleStat().rearmed << ")" << endl;
+            close(fd);
+        });
+        for (int t = 300; t <= 900; t += 300) {
+            timer->AddTimer(t, [&](const TimerNode &) {
+                if (write(pipefd[1], "x", 1) < 0) {
+                    cout << "write failed" << endl;
+                }
+            });
+        }
+    }
+
     // 输出当前时间（验证定时器起始点）
     cout << "now time:" << Timer::GetTick() << endl;
 
@@ -187,12 +525,17 @@ int main(){
     //主循环：事件驱动处理
     while(true){
         //超时事件由Timer::TimeToSleep()计算（最近定时器的剩余时间），也就是说，时间到了，epoll就不阻塞了
-        int n = epoll_wait(epfd,ev,64,timer->TimeToSleep());
+        //WaitEvents 在低延迟模式下睡到截止前 1ms 再忙等
+        int n = timer->WaitEvents(epfd,ev,64);
         time_t now = Timer::GetTick();  //获取当前时间
 
         // 处理 epoll 事件（此处预留占位符，实际可添加网络事件处理）
         for (int i = 0; i < n; i++) {
-            /**/  // 此处应添加实际事件处理逻辑（如网络 I/O）
+            // 此处应添加实际事件处理逻辑（如网络 I/O），收到数据时刷新空闲超时
+            char buf[64];
+            if (read(ev[i].data.fd, buf, sizeof(buf)) > 0) {
+                timer->Touch(ev[i].data.fd, now);
+            }
         }
 
         // 处理到期的定时器（无论 epoll 是否触发，都检查定时器）
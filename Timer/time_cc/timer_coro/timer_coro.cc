@@ -0,0 +1,322 @@
+#include <sys/epoll.h>
+
+#include <coroutine>
+#include <functional>
+#include <chrono>
+#include <set>
+#include <optional>
+#include <utility>
+#include <iostream>
+
+using namespace std;
+
+/*
+ * 协程版定时器：co_await timer.Sleep(ms) 把挂起的 coroutine_handle 直接存进定时器节点，
+ * 不构造 std::function；co_await timer.WithTimeout(task, ms) 让任务和定时器赛跑。
+ * 协程帧被销毁时，挂起点上的 awaiter 跟着析构，并取消自己的定时器，
+ * 所以取消会沿着 co_await 链一路传播下去。
+ */
+
+struct TimerNodeBase {
+    time_t expire;
+    int64_t id;
+};
+
+struct TimerNode : public TimerNodeBase {
+    using Callback = std::function<void(const TimerNode &node)>;
+    Callback func;
+    coroutine_handle<> co;  // 非空时到期直接 resume，不走 func
+    TimerNode(int64_t id, time_t expire, Callback func) : func(std::move(func)) {
+        this->expire = expire;
+        this->id = id;
+    }
+    TimerNode(int64_t id, time_t expire, coroutine_handle<> co) : co(co) {
+        this->expire = expire;
+        this->id = id;
+    }
+};
+
+bool operator < (const TimerNodeBase &lhd, const TimerNodeBase &rhd) {
+    if (lhd.expire < rhd.expire) {
+        return true;
+    } else if (lhd.expire > rhd.expire) {
+        return false;
+    }
+    return lhd.id < rhd.id;
+}
+
+// 惰性启动的协程任务，co_await 时才开始执行，结束后对称转移回等待者
+template <typename T>
+class Task;
+
+template <typename T>
+struct TaskPromiseBase {
+    coroutine_handle<> continuation;
+
+    suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        coroutine_handle<> await_suspend(coroutine_handle<P> h) noexcept {
+            auto next = h.promise().continuation;
+            return next ? next : noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { terminate(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase<T> {
+    optional<T> value;
+    Task<T> get_return_object();
+    void return_value(T v) { value.emplace(std::move(v)); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase<void> {
+    Task<void> get_return_object();
+    void return_void() {}
+};
+
+template <typename T>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+    using Handle = coroutine_handle<promise_type>;
+
+    explicit Task(Handle h) : h(h) {}
+    Task(Task &&o) noexcept : h(std::exchange(o.h, nullptr)) {}
+    Task &operator=(Task &&o) noexcept {
+        if (this != &o) {
+            if (h) h.destroy();
+            h = std::exchange(o.h, nullptr);
+        }
+        return *this;
+    }
+    // 销毁未完成的协程帧即取消它
+    ~Task() { if (h) h.destroy(); }
+
+    bool Done() const { return !h || h.done(); }
+    // 顶层任务由事件循环驱动，这里只负责启动
+    void Start() { h.resume(); }
+
+    bool await_ready() const { return false; }
+    coroutine_handle<> await_suspend(coroutine_handle<> waiter) {
+        h.promise().continuation = waiter;
+        return h;
+    }
+    T await_resume() {
+        if constexpr (!is_void_v<T>) {
+            return std::move(*h.promise().value);
+        }
+    }
+
+    Handle h;
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+class Timer {
+public:
+    static inline time_t GetTick() {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    TimerNodeBase AddTimer(time_t msec, TimerNode::Callback func) {
+        return Emplace(GetTick() + msec, std::move(func));
+    }
+
+    TimerNodeBase AddTimer(time_t msec, coroutine_handle<> co) {
+        return Emplace(GetTick() + msec, co);
+    }
+
+    bool DelTimer(const TimerNodeBase &node) {
+        auto iter = timeouts.find(node);
+        if (iter != timeouts.end()) {
+            timeouts.erase(iter);
+            return true;
+        }
+        return false;
+    }
+
+    // 先从集合中摘下再执行，恢复的协程可以随意增删定时器
+    void HandleTimer(time_t now) {
+        while (!timeouts.empty() && timeouts.begin()->expire <= now) {
+            auto nh = timeouts.extract(timeouts.begin());
+            TimerNode &node = nh.value();
+            if (node.co) {
+                node.co.resume();
+            } else {
+                node.func(node);
+            }
+        }
+    }
+
+    time_t TimeToSleep() {
+        auto iter = timeouts.begin();
+        if (iter == timeouts.end()) {
+            return -1;
+        }
+        time_t diss = iter->expire - GetTick();
+        return diss > 0 ? diss : 0;
+    }
+
+    size_t Size() const { return timeouts.size(); }
+
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(Timer &timer, time_t msec) : timer(timer), msec(msec) {}
+        SleepAwaiter(const SleepAwaiter &) = delete;
+        // 协程在挂起状态被销毁时，awaiter 随协程帧析构，撤掉还没触发的定时器
+        ~SleepAwaiter() { if (armed) timer.DelTimer(node); }
+
+        bool await_ready() const { return msec <= 0; }
+        void await_suspend(coroutine_handle<> h) {
+            node = timer.AddTimer(msec, h);
+            armed = true;
+        }
+        void await_resume() { armed = false; }
+
+    private:
+        Timer &timer;
+        time_t msec;
+        TimerNodeBase node{};
+        bool armed = false;
+    };
+
+    SleepAwaiter Sleep(time_t msec) { return SleepAwaiter(*this, msec); }
+
+    // 任务先完成返回结果（void 任务返回 true），超时返回 nullopt（void 任务返回 false），
+    // 超时后任务的协程帧被销毁，它内部挂起的定时器一并取消
+    template <typename T>
+    class TimeoutAwaiter {
+    public:
+        TimeoutAwaiter(Timer &timer, Task<T> op, time_t msec)
+            : timer(timer), op(std::move(op)), msec(msec) {}
+        TimeoutAwaiter(const TimeoutAwaiter &) = delete;
+        ~TimeoutAwaiter() { if (armed) timer.DelTimer(node); }
+
+        bool await_ready() const { return false; }
+        coroutine_handle<> await_suspend(coroutine_handle<> h) {
+            // 定时器和任务都以等待者为延续，谁先到谁恢复它
+            node = timer.AddTimer(msec, h);
+            armed = true;
+            op.h.promise().continuation = h;
+            return op.h;
+        }
+        auto await_resume() {
+            bool done = op.Done();
+            if (done) {
+                timer.DelTimer(node);
+            } else {
+                op = Task<T>(nullptr);  // 超时：销毁任务
+            }
+            armed = false;
+            if constexpr (is_void_v<T>) {
+                return done;
+            } else {
+                return done ? optional<T>(std::move(*op.h.promise().value)) : nullopt;
+            }
+        }
+
+    private:
+        Timer &timer;
+        Task<T> op;
+        time_t msec;
+        TimerNodeBase node{};
+        bool armed = false;
+    };
+
+    template <typename T>
+    TimeoutAwaiter<T> WithTimeout(Task<T> op, time_t msec) {
+        return TimeoutAwaiter<T>(*this, std::move(op), msec);
+    }
+
+private:
+    template <typename P>
+    TimerNodeBase Emplace(time_t expire, P &&payload) {
+        if (timeouts.empty() || expire <= timeouts.crbegin()->expire) {
+            auto pairs = timeouts.emplace(GenID(), expire, std::forward<P>(payload));
+            return static_cast<TimerNodeBase>(*pairs.first);
+        }
+        auto ele = timeouts.emplace_hint(timeouts.crbegin().base(), GenID(), expire, std::forward<P>(payload));
+        return static_cast<TimerNodeBase>(*ele);
+    }
+
+    static int64_t GenID() {
+        return gid++;
+    }
+    static int64_t gid;
+    set<TimerNode, std::less<>> timeouts;
+};
+
+int64_t Timer::gid = 0;
+
+static Timer timer;
+
+// 模拟一次读报文，latency 毫秒后返回
+Task<int> ReadMessage(int latency, int msg) {
+    co_await timer.Sleep(latency);
+    co_return msg;
+}
+
+// 一个带多个超时的小协议：握手、读两条报文、保活
+Task<void> Session(int id, int latency) {
+    cout << Timer::GetTick() << " session " << id << " handshake" << endl;
+    co_await timer.Sleep(100);
+    for (int i = 0; i < 2; i++) {
+        auto msg = co_await timer.WithTimeout(ReadMessage(latency, id * 10 + i), 300);
+        if (!msg) {
+            cout << Timer::GetTick() << " session " << id << " read timeout, close" << endl;
+            co_return;
+        }
+        cout << Timer::GetTick() << " session " << id << " got message " << *msg << endl;
+    }
+    co_await timer.Sleep(200);
+    cout << Timer::GetTick() << " session " << id << " done" << endl;
+}
+
+Task<void> Forgotten() {
+    co_await timer.Sleep(5000);
+    cout << "never printed" << endl;
+}
+
+int main() {
+    int epfd = epoll_create(1);
+
+    Task<void> fast = Session(1, 100);
+    Task<void> slow = Session(2, 500);
+    fast.Start();
+    slow.Start();
+    {
+        // 挂起中的协程被销毁，它的 5 秒定时器随之取消
+        Task<void> forgotten = Forgotten();
+        forgotten.Start();
+        cout << "timers before destroy: " << timer.Size() << endl;
+    }
+    cout << "timers after destroy: " << timer.Size() << endl;
+
+    epoll_event ev[64] = {0};
+    while (!fast.Done() || !slow.Done()) {
+        int n = epoll_wait(epfd, ev, 64, timer.TimeToSleep());
+        time_t now = Timer::GetTick();
+        for (int i = 0; i < n; i++) {
+            /**/
+        }
+        timer.HandleTimer(now);
+    }
+    cout << "pending timers: " << timer.Size() << endl;
+    return 0;
+}
+
+// g++ timer_coro.cc -o timer_coro -std=c++20
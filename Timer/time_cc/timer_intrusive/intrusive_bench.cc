@@ -0,0 +1,167 @@
+#include <malloc.h>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <chrono>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include "timer_intrusive.h"
+
+using namespace std;
+
+/*
+ * 侵入式配对堆 vs timer.cc 的 std::set 实现（这里照搬一份，去掉 main）：
+ *   - 每个定时器占用的内存：std::set 按 mallinfo2 统计的堆增量，侵入式就是钩子大小，定时器自己不分配；
+ *   - 添加 / 取消（随机顺序）/ 全部到期 的平均耗时。
+ */
+
+struct TimerNodeBase {
+    time_t expire;
+    int64_t id;
+};
+
+struct TimerNode : public TimerNodeBase {
+    using Callback = std::function<void(const TimerNode &node)>;
+    Callback func;
+    TimerNode(int64_t id, time_t expire, Callback func) : func(func) {
+        this->expire = expire;
+        this->id = id;
+    }
+};
+
+bool operator < (const TimerNodeBase &lhd, const TimerNodeBase &rhd) {
+    if (lhd.expire < rhd.expire) {
+        return true;
+    } else if (lhd.expire > rhd.expire) {
+        return false;
+    }
+    return lhd.id < rhd.id;
+}
+
+class SetTimer {
+public:
+    TimerNodeBase AddTimer(time_t expire, TimerNode::Callback func) {
+        if (timeouts.empty() || expire <= timeouts.crbegin()->expire) {
+            auto pairs = timeouts.emplace(gid++, expire, std::move(func));
+            return static_cast<TimerNodeBase>(*pairs.first);
+        }
+        auto ele = timeouts.emplace_hint(timeouts.crbegin().base(), gid++, expire, std::move(func));
+        return static_cast<TimerNodeBase>(*ele);
+    }
+    bool DelTimer(TimerNodeBase &node) {
+        auto iter = timeouts.find(node);
+        if (iter != timeouts.end()) {
+            timeouts.erase(iter);
+            return true;
+        }
+        return false;
+    }
+    void HandleTimer(time_t now) {
+        auto iter = timeouts.begin();
+        while (iter != timeouts.end() && iter->expire <= now) {
+            iter->func(*iter);
+            iter = timeouts.erase(iter);
+        }
+    }
+private:
+    int64_t gid = 0;
+    set<TimerNode, std::less<>> timeouts;
+};
+
+// 连接对象：侵入式版本把钩子嵌在里面
+struct Conn : public TimerHook {
+    int fd;
+};
+
+static long fired;
+
+static double NowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t HeapUsed() {
+    return mallinfo2().uordblks;
+}
+
+static time_t last_expire;
+static bool in_order = true;
+
+static void OnExpire(TimerHook *hook) {
+    fired++;
+    in_order = in_order && hook->expire >= last_expire;
+    last_expire = hook->expire;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? atoi(argv[1]) : 1000000;
+    mt19937 rng(1);
+    vector<time_t> expires(n);
+    vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        expires[i] = 1 + rng() % 60000;
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), rng);
+    size_t half = n / 2;
+
+    // std::set
+    double set_add, set_del, set_exp, set_mem;
+    {
+        vector<Conn> conns(n);
+        vector<TimerNodeBase> refs(n);
+        SetTimer timer;
+        size_t before = HeapUsed();
+        double t0 = NowNs();
+        for (size_t i = 0; i < n; i++) {
+            Conn *c = &conns[i];
+            refs[i] = timer.AddTimer(expires[i], [c](const TimerNode &) { fired += c->fd >= 0; });
+        }
+        set_add = (NowNs() - t0) / n;
+        set_mem = (double)(HeapUsed() - before) / n;
+        t0 = NowNs();
+        for (size_t i = 0; i < half; i++) {
+            timer.DelTimer(refs[order[i]]);
+        }
+        set_del = (NowNs() - t0) / half;
+        t0 = NowNs();
+        timer.HandleTimer(1 << 30);
+        set_exp = (NowNs() - t0) / (n - half);
+    }
+
+    // 侵入式
+    double in_add, in_del, in_exp;
+    bool ok = true;
+    {
+        vector<Conn> conns(n);
+        IntrusiveTimer timer;
+        fired = 0;
+        size_t before = HeapUsed();
+        time_t base = IntrusiveTimer::GetTick();
+        double t0 = NowNs();
+        for (size_t i = 0; i < n; i++) {
+            timer.AddTimer(&conns[i], expires[i], OnExpire);
+        }
+        in_add = (NowNs() - t0) / n;
+        ok = HeapUsed() == before;  // 添加不分配内存
+        t0 = NowNs();
+        for (size_t i = 0; i < half; i++) {
+            timer.DelTimer(&conns[order[i]]);
+        }
+        in_del = (NowNs() - t0) / half;
+        t0 = NowNs();
+        timer.HandleTimer(base + (1 << 30));
+        in_exp = (NowNs() - t0) / (n - half);
+        ok = ok && timer.Size() == 0 && in_order;
+    }
+
+    printf("timers = %zu, cancel %zu in random order, expire the rest\n", n, half);
+    printf("%-12s %14s %10s %12s %12s\n", "impl", "bytes/timer", "add ns", "cancel ns", "expire ns");
+    printf("%-12s %14.1f %10.1f %12.1f %12.1f\n", "std::set", set_mem, set_add, set_del, set_exp);
+    printf("%-12s %14zu %10.1f %12.1f %12.1f\n", "intrusive", sizeof(TimerHook), in_add, in_del, in_exp);
+    printf("intrusive allocation-free, drained in order: %s (fired %ld)\n", ok ? "ok" : "BAD", fired);
+    return 0;
+}
+
+// g++ -O2 intrusive_bench.cc -o intrusive_bench -std=c++14
@@ -0,0 +1,71 @@
+#include <sys/epoll.h>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include "timer_intrusive.h"
+
+using namespace std;
+
+static IntrusiveTimer timer;
+
+// 连接对象自带定时器钩子，添加 / 取消定时器不再分配内存
+struct Connection : public TimerHook {
+    int fd;
+    int requests = 0;
+    explicit Connection(int fd) : fd(fd) {}
+};
+
+static void OnIdle(TimerHook *hook) {
+    Connection *c = static_cast<Connection *>(hook);
+    cout << IntrusiveTimer::GetTick() << " conn " << c->fd << " idle timeout after "
+         << c->requests << " requests" << endl;
+}
+
+static void OnRequest(TimerHook *hook);
+
+// 模拟连接上每 300ms 来一个请求，每个请求把空闲超时续期到 1000ms
+struct Client : public TimerHook {
+    Connection *conn;
+    int left;
+};
+
+static void OnRequest(TimerHook *hook) {
+    Client *cl = static_cast<Client *>(hook);
+    cl->conn->requests++;
+    timer.AddTimer(cl->conn, 1000, OnIdle);  // 续期：直接从钩子摘下再挂上
+    if (--cl->left > 0) {
+        timer.AddTimer(cl, 300, OnRequest);
+    }
+}
+
+int main() {
+    int epfd = epoll_create(1);
+    vector<unique_ptr<Connection>> conns;
+    vector<unique_ptr<Client>> clients;
+    for (int i = 0; i < 3; i++) {
+        conns.emplace_back(new Connection(100 + i));
+        timer.AddTimer(conns.back().get(), 1000, OnIdle);
+        clients.emplace_back(new Client);
+        clients.back()->conn = conns.back().get();
+        clients.back()->left = i * 3;
+        if (clients.back()->left > 0) {
+            timer.AddTimer(clients.back().get(), 300, OnRequest);
+        }
+    }
+    // 连接 100 没有请求、被主动关闭：O(1) 摘下钩子，重复取消是空操作
+    timer.DelTimer(conns[0].get());
+    timer.DelTimer(conns[0].get());
+
+    epoll_event ev[64] = {0};
+    while (timer.Size() > 0) {
+        int n = epoll_wait(epfd, ev, 64, timer.TimeToSleep());
+        time_t now = IntrusiveTimer::GetTick();
+        for (int i = 0; i < n; i++) {
+            /**/
+        }
+        timer.HandleTimer(now);
+    }
+    return 0;
+}
+
+// g++ timer_intrusive.cc -o timer_intrusive -std=c++14
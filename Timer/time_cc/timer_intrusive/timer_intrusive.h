@@ -0,0 +1,154 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * 侵入式定时器：定时器钩子 TimerHook 由调用方嵌在自己的对象里（比如连接对象继承它），
+ * 定时器本身只串起这些钩子，添加不分配内存，取消直接从钩子摘下，不用按 (expire, id) 查找。
+ * 组织方式是配对堆（pairing heap）：
+ *   - 添加、取最小值 O(1)；
+ *   - 删除最小值 / 取消是均摊 O(log n)，摘下本身 O(1)，再把子树两两合并。
+ */
+
+struct TimerHook {
+    using Callback = void (*)(TimerHook *hook);
+
+    time_t expire = 0;
+    uint64_t seq = 0;             // 同一到期时间按添加顺序触发
+    Callback func = nullptr;
+    TimerHook *child = nullptr;   // 第一个孩子
+    TimerHook *next = nullptr;    // 右兄弟
+    TimerHook *prev = nullptr;    // 左兄弟；第一个孩子指向父节点；根为 nullptr
+    bool linked = false;
+
+    bool Linked() const { return linked; }
+};
+
+class IntrusiveTimer {
+public:
+    static inline time_t GetTick() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 钩子已经挂着时先摘下再重新挂，等价于续期
+    void AddTimer(TimerHook *hook, time_t msec, TimerHook::Callback func) {
+        if (hook->linked) {
+            DelTimer(hook);
+        }
+        hook->expire = GetTick() + msec;
+        hook->seq = seq++;
+        hook->func = func;
+        hook->child = hook->next = hook->prev = nullptr;
+        hook->linked = true;
+        root = Meld(root, hook);
+        count++;
+    }
+
+    // 没挂着（已触发、已取消）时返回 false
+    bool DelTimer(TimerHook *hook) {
+        if (!hook->linked) {
+            return false;
+        }
+        if (hook == root) {
+            root = MergePairs(root->child);
+            if (root) {
+                root->prev = nullptr;
+            }
+        } else {
+            // 从兄弟链表摘下，prev 要么是左兄弟，要么是父节点
+            if (hook->prev->child == hook) {
+                hook->prev->child = hook->next;
+            } else {
+                hook->prev->next = hook->next;
+            }
+            if (hook->next) {
+                hook->next->prev = hook->prev;
+            }
+            TimerHook *sub = MergePairs(hook->child);
+            if (sub) {
+                sub->prev = nullptr;
+                root = Meld(root, sub);
+            }
+        }
+        hook->child = hook->next = hook->prev = nullptr;
+        hook->linked = false;
+        count--;
+        return true;
+    }
+
+    void HandleTimer(time_t now) {
+        while (root && root->expire <= now) {
+            TimerHook *hook = root;
+            DelTimer(hook);
+            hook->func(hook);  // 回调里可以重新 AddTimer 自己，也可以销毁宿主对象
+        }
+    }
+
+    time_t TimeToSleep() {
+        if (!root) {
+            return -1;
+        }
+        time_t diss = root->expire - GetTick();
+        return diss > 0 ? diss : 0;
+    }
+
+    size_t Size() const { return count; }
+
+private:
+    static bool Less(const TimerHook *a, const TimerHook *b) {
+        return a->expire < b->expire || (a->expire == b->expire && a->seq < b->seq);
+    }
+
+    // 两个堆合并：较大的根成为较小的根的第一个孩子
+    static TimerHook *Meld(TimerHook *a, TimerHook *b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (Less(b, a)) {
+            TimerHook *t = a;
+            a = b;
+            b = t;
+        }
+        b->prev = a;
+        b->next = a->child;
+        if (a->child) {
+            a->child->prev = b;
+        }
+        a->child = b;
+        a->next = nullptr;
+        return a;
+    }
+
+    // 两趟合并：从左到右两两合并，再从右到左依次合并
+    static TimerHook *MergePairs(TimerHook *first) {
+        if (!first) {
+            return nullptr;
+        }
+        TimerHook *pairs = nullptr;  // 第一趟的结果，用 prev 反向串起来
+        while (first) {
+            TimerHook *a = first;
+            TimerHook *b = a->next;
+            first = b ? b->next : nullptr;
+            a->next = a->prev = nullptr;
+            if (b) {
+                b->next = b->prev = nullptr;
+            }
+            TimerHook *m = Meld(a, b);
+            m->prev = pairs;
+            pairs = m;
+        }
+        TimerHook *result = nullptr;
+        while (pairs) {
+            TimerHook *p = pairs;
+            pairs = pairs->prev;
+            p->prev = nullptr;
+            result = Meld(result, p);
+        }
+        return result;
+    }
+
+    TimerHook *root = nullptr;
+    uint64_t seq = 0;
+    size_t count = 0;
+};
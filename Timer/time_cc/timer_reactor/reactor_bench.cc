@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include "timer_reactor.h"
+
+using namespace std;
+
+/*
+ * 扩展性：1~N 个 reactor 各自在本 loop 上添加 1~1000ms 的定时器并取消其中 90%，
+ * 每 100 次操作中有 1 次通过收件箱投递到随机的其他 loop。
+ * 跑满 RUN_MS 毫秒，输出所有 loop 的总吞吐（Mops/s），理想情况随核数线性增长。
+ */
+
+#define BATCH  1000
+#define RUN_MS 1000
+
+struct LoopStat {
+    alignas(64) uint64_t ops = 0;
+};
+
+static void Noop(const TimerNode &) {}
+
+static void Drive(vector<unique_ptr<Reactor>> &loops, vector<LoopStat> &stats, time_t deadline) {
+    Reactor *self = Reactor::Current();
+    LoopStat &st = stats[self->Index()];
+    thread_local unsigned seed = self->Index() + 1;
+    thread_local TimerRef prev{nullptr, {}};
+    for (int i = 0; i < BATCH; i++) {
+        Reactor *target = self;
+        if (loops.size() > 1 && rand_r(&seed) % 100 == 0) {
+            target = loops[rand_r(&seed) % loops.size()].get();
+        }
+        TimerRef ref = target->AddTimer(1 + rand_r(&seed) % 1000, Noop);
+        if (prev.loop) {
+            Reactor::DelTimer(prev);
+        }
+        prev = rand_r(&seed) % 10 ? ref : TimerRef{nullptr, {}};
+    }
+    st.ops += BATCH;
+    if (Timer::GetTick() < deadline) {
+        // 0ms 定时器：让出给 epoll_wait 处理收件箱，再接着跑下一批
+        self->AddTimer(0, [&loops, &stats, deadline](const TimerNode &) {
+            Drive(loops, stats, deadline);
+        });
+    } else {
+        for (auto &loop : loops) {
+            loop->Stop();
+        }
+    }
+}
+
+static double Run(int n) {
+    vector<unique_ptr<Reactor>> loops;
+    vector<LoopStat> stats(n);
+    vector<thread> threads;
+    for (int i = 0; i < n; i++) {
+        loops.emplace_back(new Reactor(i));
+    }
+    time_t start = Timer::GetTick();
+    time_t deadline = start + RUN_MS;
+    for (auto &loop : loops) {
+        loop->AddTimer(0, [&loops, &stats, deadline](const TimerNode &) {
+            Drive(loops, stats, deadline);
+        });
+    }
+    for (auto &loop : loops) {
+        threads.push_back(loop->Start());
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    double cost = (Timer::GetTick() - start) / 1000.0;
+    uint64_t total = 0;
+    for (auto &st : stats) {
+        total += st.ops;
+    }
+    return total / cost / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    int maxn = argc > 1 ? atoi(argv[1]) : (int)thread::hardware_concurrency();
+    double base = 0;
+    printf("%8s %12s %10s\n", "reactors", "Mops/s", "speedup");
+    for (int n = 1; n <= maxn; n *= 2) {
+        double r = Run(n);
+        if (n == 1) {
+            base = r;
+        }
+        printf("%8d %12.2f %10.2f\n", n, r, r / base);
+    }
+    return 0;
+}
+
+// g++ -O2 reactor_bench.cc -o reactor_bench -std=c++17 -lpthread
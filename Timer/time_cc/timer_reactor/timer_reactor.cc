@@ -0,0 +1,53 @@
+#include <iostream>
+#include <mutex>
+#include "timer_reactor.h"
+
+using namespace std;
+
+static mutex out_mutex;
+
+#define LOG(x) do { lock_guard<mutex> lk(out_mutex); cout << Timer::GetTick() << " " << x << endl; } while (0)
+
+int main() {
+    int nloops = 4;
+    vector<unique_ptr<Reactor>> loops;
+    vector<thread> threads;
+    for (int i = 0; i < nloops; i++) {
+        loops.emplace_back(new Reactor(i));
+    }
+    for (auto &loop : loops) {
+        threads.push_back(loop->Start());
+    }
+
+    // 主线程往各个 loop 投递定时器，回调在目标 loop 的线程上执行
+    for (int i = 0; i < nloops; i++) {
+        loops[i]->AddTimer(100 * (i + 1), [&loops, i](const TimerNode &node) {
+            LOG("loop " << Reactor::Current()->Index() << " fired id:" << hex << node.id << dec);
+            // 在 loop i 上给下一个 loop 安排定时器
+            Reactor *next = loops[(i + 1) % loops.size()].get();
+            next->AddTimer(200, [i](const TimerNode &node) {
+                LOG("loop " << Reactor::Current()->Index() << " fired cross-loop timer from loop " << i);
+            });
+        });
+    }
+
+    // 投递后马上取消，同一线程发出的添加 / 取消按顺序执行
+    TimerRef ref = loops[0]->AddTimer(500, [](const TimerNode &) {
+        LOG("never printed");
+    });
+    Reactor::DelTimer(ref);
+
+    loops[0]->AddTimer(1500, [&loops](const TimerNode &) {
+        LOG("stop all loops");
+        for (auto &loop : loops) {
+            loop->Stop();
+        }
+    });
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    return 0;
+}
+
+// g++ timer_reactor.cc -o timer_reactor -std=c++17 -lpthread
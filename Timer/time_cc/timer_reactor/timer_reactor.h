@@ -0,0 +1,250 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+#include <memory>
+
+/*
+ * 每核一个 reactor：每个 loop 独占自己的 epoll fd、eventfd 和 Timer，
+ * 本线程增删定时器直接操作 Timer；其他线程通过无锁收件箱（多生产者单消费者）投递命令，
+ * 收件箱从空变为非空时才写 eventfd 唤醒目标 loop。
+ * 定时器 ID = 线程前缀 << 40 | 线程内序号，前缀在线程第一次分配 ID 时领取一次，
+ * 热路径上没有共享的原子变量。
+ */
+
+struct TimerNodeBase {
+    time_t expire;
+    int64_t id;
+};
+
+struct TimerNode : public TimerNodeBase {
+    using Callback = std::function<void(const TimerNode &node)>;
+    Callback func;
+    TimerNode(int64_t id, time_t expire, Callback func) : func(std::move(func)) {
+        this->expire = expire;
+        this->id = id;
+    }
+};
+
+inline bool operator < (const TimerNodeBase &lhd, const TimerNodeBase &rhd) {
+    if (lhd.expire < rhd.expire) {
+        return true;
+    } else if (lhd.expire > rhd.expire) {
+        return false;
+    }
+    return lhd.id < rhd.id;
+}
+
+// 单线程使用的定时器，ID 由调用方生成
+class Timer {
+public:
+    static inline time_t GetTick() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 本线程内唯一、跨线程也唯一的 ID
+    static int64_t GenID() {
+        static std::atomic<int64_t> next_prefix{1};
+        thread_local int64_t prefix = 0;
+        thread_local int64_t seq = 0;
+        if (prefix == 0) {
+            prefix = next_prefix.fetch_add(1, std::memory_order_relaxed);
+        }
+        return prefix << 40 | ++seq;
+    }
+
+    void AddTimer(const TimerNodeBase &node, TimerNode::Callback func) {
+        if (timeouts.empty() || node.expire <= timeouts.crbegin()->expire) {
+            timeouts.emplace(node.id, node.expire, std::move(func));
+            return;
+        }
+        timeouts.emplace_hint(timeouts.crbegin().base(), node.id, node.expire, std::move(func));
+    }
+
+    bool DelTimer(const TimerNodeBase &node) {
+        auto iter = timeouts.find(node);
+        if (iter != timeouts.end()) {
+            timeouts.erase(iter);
+            return true;
+        }
+        return false;
+    }
+
+    // 先摘下再执行，回调里可以随意增删定时器
+    void HandleTimer(time_t now) {
+        while (!timeouts.empty() && timeouts.begin()->expire <= now) {
+            auto nh = timeouts.extract(timeouts.begin());
+            nh.value().func(nh.value());
+        }
+    }
+
+    time_t TimeToSleep() {
+        auto iter = timeouts.begin();
+        if (iter == timeouts.end()) {
+            return -1;
+        }
+        time_t diss = iter->expire - GetTick();
+        return diss > 0 ? diss : 0;
+    }
+
+    size_t Size() const { return timeouts.size(); }
+
+private:
+    std::set<TimerNode, std::less<>> timeouts;
+};
+
+class Reactor;
+
+// 跨 loop 的定时器引用
+struct TimerRef {
+    Reactor *loop;
+    TimerNodeBase node;
+};
+
+class Reactor {
+public:
+    explicit Reactor(int index) : index(index) {
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = wakefd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+    }
+
+    ~Reactor() {
+        DrainInbox();  // 释放没来得及处理的命令
+        close(wakefd);
+        close(epfd);
+    }
+
+    Reactor(const Reactor &) = delete;
+    Reactor &operator=(const Reactor &) = delete;
+
+    static Reactor *Current() { return current; }
+    int Index() const { return index; }
+    Timer &GetTimer() { return timer; }
+
+    // 任意线程调用；在本 loop 线程上直接插入，否则投递到收件箱
+    TimerRef AddTimer(time_t msec, TimerNode::Callback func) {
+        TimerRef ref{this, {Timer::GetTick() + msec, Timer::GenID()}};
+        if (current == this) {
+            timer.AddTimer(ref.node, std::move(func));
+        } else {
+            Post(new Command{Command::ADD, ref.node, std::move(func), nullptr});
+        }
+        return ref;
+    }
+
+    // 任意线程调用；跨线程取消与添加来自同一线程时保证先添加后取消
+    static void DelTimer(const TimerRef &ref) {
+        Reactor *loop = ref.loop;
+        if (current == loop) {
+            loop->timer.DelTimer(ref.node);
+        } else {
+            loop->Post(new Command{Command::DEL, ref.node, nullptr, nullptr});
+        }
+    }
+
+    void Stop() {
+        Post(new Command{Command::STOP, {}, nullptr, nullptr});
+    }
+
+    void Run() {
+        current = this;
+        epoll_event ev[64];
+        while (running) {
+            int n = epoll_wait(epfd, ev, 64, timer.TimeToSleep());
+            for (int i = 0; i < n; i++) {
+                if (ev[i].data.fd == wakefd) {
+                    eventfd_t cnt;
+                    eventfd_read(wakefd, &cnt);
+                }
+                /* 其他 fd 的 I/O 事件 */
+            }
+            DrainInbox();
+            timer.HandleTimer(Timer::GetTick());
+        }
+        current = nullptr;
+    }
+
+    // 在新线程里跑 Run，并绑定到第 index % 核数 个 CPU 上
+    std::thread Start() {
+        std::thread t([this] { Run(); });
+        unsigned ncpu = std::thread::hardware_concurrency();
+        if (ncpu > 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(index % ncpu, &set);
+            pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+        }
+        return t;
+    }
+
+private:
+    struct Command {
+        enum Op { ADD, DEL, STOP } op;
+        TimerNodeBase node;
+        TimerNode::Callback func;
+        Command *next;
+    };
+
+    // 多生产者压栈，收件箱由空变非空时才唤醒
+    void Post(Command *cmd) {
+        Command *old = inbox.load(std::memory_order_relaxed);
+        do {
+            cmd->next = old;
+        } while (!inbox.compare_exchange_weak(old, cmd, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        if (old == nullptr) {
+            eventfd_write(wakefd, 1);
+        }
+    }
+
+    // 整条取下再反转，按投递顺序执行
+    void DrainInbox() {
+        Command *list = inbox.exchange(nullptr, std::memory_order_acquire);
+        Command *rev = nullptr;
+        while (list) {
+            Command *next = list->next;
+            list->next = rev;
+            rev = list;
+            list = next;
+        }
+        while (rev) {
+            Command *cmd = rev;
+            rev = rev->next;
+            switch (cmd->op) {
+            case Command::ADD:
+                timer.AddTimer(cmd->node, std::move(cmd->func));
+                break;
+            case Command::DEL:
+                timer.DelTimer(cmd->node);
+                break;
+            case Command::STOP:
+                running = false;
+                break;
+            }
+            delete cmd;
+        }
+    }
+
+    int index;
+    int epfd;
+    int wakefd;
+    bool running = true;
+    Timer timer;
+    std::atomic<Command *> inbox{nullptr};
+    static inline thread_local Reactor *current = nullptr;
+};
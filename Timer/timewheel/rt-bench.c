@@ -0,0 +1,103 @@
+#include "timer_rt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "timewheel.h"
+
+/*
+ * 触发精度：每个定时器到期后马上再加一个 1~5ms 的定时器，记录回调时刻比它所在毫秒刻度晚了多少，
+ * 后台线程不停申请、触碰、释放内存制造缺页和调度干扰。
+ * 先跑普通模式（epoll_wait 毫秒超时），再打开低延迟模式（绑核、SCHED_FIFO、mlockall、节点池、
+ * 睡眠 + 忙等），输出两种模式的延迟分位数（us）。
+ */
+
+#define SAMPLES 3000
+
+static int64_t late[SAMPLES];
+static int nsample;
+static uint64_t start_ms;     // 时间轮第 0 刻度对应的单调时钟毫秒数
+static volatile int stop_noise;
+
+static uint64_t
+now_ms() {
+    return timer_rt_now_ns() / 1000000;
+}
+
+static void
+on_fire(timer_node_t *node) {
+    uint64_t now = timer_rt_now_ns();
+    if (nsample < SAMPLES) {
+        late[nsample++] = (int64_t)(now - (start_ms + node->expire) * 1000000ull);
+        add_timer(1 + rand() % 5, on_fire, 0);
+    }
+}
+
+static void *
+noise(void *p) {
+    while (!stop_noise) {
+        size_t sz = 4 << 20;
+        char *buf = malloc(sz);
+        size_t i;
+        for (i = 0; i < sz; i += 4096) {
+            buf[i] = 1;
+        }
+        free(buf);
+        usleep(500);
+    }
+    return NULL;
+}
+
+static int
+cmp64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void
+run(const char *name) {
+    nsample = 0;
+    add_timer(1, on_fire, 0);
+    while (nsample < SAMPLES) {
+        expire_timer();
+        timer_wait(-1);
+    }
+    qsort(late, SAMPLES, sizeof(late[0]), cmp64);
+    printf("%-8s %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+        late[SAMPLES / 2] / 1e3, late[SAMPLES * 90 / 100] / 1e3, late[SAMPLES * 99 / 100] / 1e3,
+        late[SAMPLES * 999 / 1000] / 1e3, late[SAMPLES - 1] / 1e3);
+}
+
+int main() {
+    pthread_t tid;
+    uint64_t before;
+    // 在毫秒刚翻过时初始化，确保 start_ms 就是时间轮的起点
+    do {
+        before = now_ms();
+        while (now_ms() == before) {
+        }
+        before = now_ms();
+        init_timer();
+        start_ms = now_ms();
+        if (start_ms != before) {
+            clear_timer();
+        }
+    } while (start_ms != before);
+
+    pthread_create(&tid, NULL, noise, NULL);
+    printf("%-8s %10s %10s %10s %10s %10s\n", "mode", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+    run("normal");
+    int ret = timer_enable_rt(4096, 0, 50);
+    run("rt");
+    if (ret) {
+        printf("rt mode partly unavailable:%s%s%s\n", ret & TIMER_RT_NO_MLOCK ? " mlockall" : "",
+            ret & TIMER_RT_NO_PIN ? " pin" : "", ret & TIMER_RT_NO_FIFO ? " SCHED_FIFO" : "");
+    }
+    stop_noise = 1;
+    pthread_join(tid, NULL);
+    clear_timer();
+    return 0;
+}
+
+// gcc -O2 rt-bench.c timewheel.c -o rt-bench -I./ -I../common -lpthread
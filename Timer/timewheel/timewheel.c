@@ -1,8 +1,18 @@
+#if defined(__linux__)
+#include "timer_rt.h"  // 需要 _GNU_SOURCE，放在最前面；绑核、SCHED_FIFO、mlockall 只有 Linux 有
+#endif
 #include "spinlock.h"
 #include "timewheel.h"
+#include "timer_probe.h"
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 #if defined(__APPLE__)
 #include <AvailabilityMacros.h>
@@ -18,17 +28,40 @@ typedef struct link_list {
 	timer_node_t *tail;
 }link_list_t;
 
+#define SPREAD_RING 65536  // 记录最近 65 秒内每个刻度已经落了多少个定时器
+
+typedef struct spread_slot {
+	uint32_t tick;
+	uint32_t count;
+}spread_slot_t;
+
 typedef struct timer {
 	link_list_t near[TIME_NEAR];
 	link_list_t t[4][TIME_LEVEL];
 	struct spinlock lock;
+	handle_table_t handles; // 句柄槽位表，受 lock 保护
 	uint32_t time;
 	uint64_t current;
 	uint64_t current_point;
+	uint64_t start_point;  // 刻度 0 对应的毫秒时间，探针用它算触发延迟
+	int sleeping;       // 驱动线程是否在 timer_wait 中睡眠
+	uint32_t wake_tick; // 驱动线程预计醒来的刻度，更早的定时器需要唤醒它
+	int wakefd;         // eventfd，用于提前唤醒
+	int epfd;
+	int rt;             // 低延迟模式，见 timer_enable_rt
+	timer_node_t *pool, *pool_end; // 预分配并预先触碰过的节点池
+	timer_node_t *free_nodes;      // 节点池空闲链表，受 lock 保护
+	link_list_t pending;           // expire_into 已推进到、还没取走的节点，按到期顺序
+	int spread_cap;                // 每个刻度最多落多少个定时器，0 不限
+	int spread_shift;              // 超出的最多往后挪多少个刻度
+	spread_slot_t *spread;         // 按刻度取模的计数环，受 lock 保护
+	uint64_t spread_shifted;       // 被挪动过的定时器个数
 }s_timer_t;
 
 static s_timer_t * TI = NULL;
 
+uint64_t gettime();
+
 timer_node_t *
 link_clear(link_list_t *list) {
 	timer_node_t * ret = list->head.next;
@@ -39,7 +72,7 @@ link_clear(link_list_t *list) {
 }
 
 void
-link(link_list_t *list, timer_node_t *node) {
+link_node(link_list_t *list, timer_node_t *node) {
 	list->tail->next = node;
 	list->tail = node;
 	node->next=0;
@@ -49,46 +82,185 @@ void
 add_node(s_timer_t *T, timer_node_t *node) {
 	uint32_t time=node->expire;
 	uint32_t current_time=T->time;
-	uint32_t msec = time - current_time;
-	if (msec < TIME_NEAR) { //[0, 0x100)
-		link(&T->near[time&TIME_NEAR_MASK],node);
-	} else if (msec < (1 << (TIME_NEAR_SHIFT+TIME_LEVEL_SHIFT))) {//[0x100, 0x4000)
-		link(&T->t[0][((time>>TIME_NEAR_SHIFT) & TIME_LEVEL_MASK)],node);	
-	} else if (msec < (1 << (TIME_NEAR_SHIFT+2*TIME_LEVEL_SHIFT))) {//[0x4000, 0x100000)
-		link(&T->t[1][((time>>(TIME_NEAR_SHIFT + TIME_LEVEL_SHIFT)) & TIME_LEVEL_MASK)],node);	
-	} else if (msec < (1 << (TIME_NEAR_SHIFT+3*TIME_LEVEL_SHIFT))) {//[0x100000, 0x4000000)
-		link(&T->t[2][((time>>(TIME_NEAR_SHIFT + 2*TIME_LEVEL_SHIFT)) & TIME_LEVEL_MASK)],node);	
-	} else {//[0x4000000, 0xffffffff]
-		link(&T->t[3][((time>>(TIME_NEAR_SHIFT + 3*TIME_LEVEL_SHIFT)) & TIME_LEVEL_MASK)],node);	
+	// 按到期时间和当前时间的高位是否相同选层，不按差值：按差值放时，跨过上一层边界的定时器
+	// 会落进本层的 0 号槽，timer_shift 从不 cascade 各层的 0 号槽，定时器永远不触发
+	if ((time|TIME_NEAR_MASK)==(current_time|TIME_NEAR_MASK)) {
+		link_node(&T->near[time&TIME_NEAR_MASK],node);
+	} else {
+		int i;
+		uint32_t mask=TIME_NEAR << TIME_LEVEL_SHIFT;
+		for (i=0;i<3;i++) {
+			if ((time|(mask-1))==(current_time|(mask-1))) {
+				break;
+			}
+			mask <<= TIME_LEVEL_SHIFT;
+		}
+		link_node(&T->t[i][((time>>(TIME_NEAR_SHIFT + i*TIME_LEVEL_SHIFT)) & TIME_LEVEL_MASK)],node);
 	}
 }
 
-timer_node_t*
-add_timer(int time, handler_pt func, int threadid) {
-	timer_node_t *node = (timer_node_t *)malloc(sizeof(*node));
+// 优先从节点池取，池用完再 malloc；调用者持有锁
+static timer_node_t *
+node_alloc(s_timer_t *T) {
+	timer_node_t *node = T->free_nodes;
+	if (node) {
+		T->free_nodes = node->next;
+		return node;
+	}
+	return (timer_node_t *)malloc(sizeof(*node));
+}
+
+// 调用者持有锁
+static void
+node_free(s_timer_t *T, timer_node_t *node) {
+	if (node >= T->pool && node < T->pool_end) {
+		node->next = T->free_nodes;
+		T->free_nodes = node;
+	} else {
+		free(node);
+	}
+}
+
+// 从 expire 开始往后找第一个没满的刻度，窗口内都满了就挑最空的；调用者持有锁。
+// 计数只增不减（取消、触发都不回退），偏保守
+static uint32_t
+spread_pick(s_timer_t *T, uint32_t expire) {
+	uint32_t t = expire, best = expire, best_count = UINT32_MAX;
+	int i;
+	for (i = 0; i <= T->spread_shift; i++, t++) {
+		spread_slot_t *s = &T->spread[t & (SPREAD_RING - 1)];
+		if (s->tick != t) {
+			s->tick = t;
+			s->count = 0;
+		}
+		if (s->count < (uint32_t)T->spread_cap) {
+			best = t;
+			break;
+		}
+		if (s->count < best_count) {
+			best = t;
+			best_count = s->count;
+		}
+	}
+	T->spread[best & (SPREAD_RING - 1)].count++;
+	if (best != expire) {
+		T->spread_shifted++;
+	}
+	return best;
+}
+
+timer_handle_t
+add_group_timer(int time, handler_pt func, int threadid, timer_group_t *g) {
+	timer_handle_t handle;
 	spinlock_lock(&TI->lock);
+	timer_node_t *node = node_alloc(TI);
+	if (!node) {
+		spinlock_unlock(&TI->lock);
+		return TIMER_HANDLE_INVALID;
+	}
 	node->expire = time+TI->time;
 	node->callback = func;
 	node->id = threadid;
-	if (time <= 0) {
+	node->cancel = 0;
+	node->handle = TIMER_HANDLE_INVALID;
+	timer_group_link_init(&node->group);
+	if (time <= 0 && !func) {
+		node->expire = TI->time;  // 当前刻度的槽位在下一次推进时最先处理
+	} else if (time <= 0) {
 		spinlock_unlock(&TI->lock);
 		node->callback(node);
-		free(node);
-		return NULL;
+		spinlock_lock(&TI->lock);
+		node_free(TI, node);
+		spinlock_unlock(&TI->lock);
+		return TIMER_HANDLE_INVALID;
+	}
+	// 拿不到句柄就不挂上去，否则这个定时器永远取消不了
+	handle = node->handle = handle_alloc(&TI->handles, node);
+	if (handle == TIMER_HANDLE_INVALID) {
+		node_free(TI, node);
+		spinlock_unlock(&TI->lock);
+		return TIMER_HANDLE_INVALID;
 	}
+	if (time > 0 && TI->spread_cap > 0) {
+		node->expire = spread_pick(TI, node->expire);
+	}
+	timer_group_attach(g, &node->group);
 	add_node(TI, node);
+	TIMER_PROBE_ADD(handle, node->expire, TI->time);
+	int wake = TI->sleeping && (int32_t)(node->expire - TI->wake_tick) < 0;
+	if (wake) {
+		TI->wake_tick = node->expire; // 之后更晚的定时器不必再唤醒
+	}
+	spinlock_unlock(&TI->lock);
+#if defined(__linux__)
+	if (wake) {
+		uint64_t one = 1;
+		ssize_t n = write(TI->wakefd, &one, sizeof(one));
+		(void)n;
+	}
+#endif
+	return handle;
+}
+
+timer_handle_t
+add_timer(int time, handler_pt func, int threadid) {
+	return add_group_timer(time, func, threadid, NULL);
+}
+
+timer_handle_t
+add_jitter_timer(int time, int jitter, handler_pt func, int threadid) {
+	// 每个线程自己的 xorshift 状态，不需要加锁
+	static __thread uint32_t seed;
+	if (jitter > 0 && time > 0) {
+		if (seed == 0) {
+			seed = (uint32_t)(uintptr_t)&seed ^ (uint32_t)gettime() ^ 0x9e3779b9u;
+		}
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		time += (int)(seed % ((uint32_t)jitter + 1));
+	}
+	return add_group_timer(time, func, threadid, NULL);
+}
+
+int
+timer_set_spread(int max_per_tick, int max_shift) {
+	spread_slot_t *ring = NULL;
+	if (max_per_tick > 0) {
+		ring = (spread_slot_t *)calloc(SPREAD_RING, sizeof(spread_slot_t));
+		if (!ring) {
+			return -1;
+		}
+	}
+	spinlock_lock(&TI->lock);
+	spread_slot_t *old = TI->spread;
+	TI->spread = ring;
+	TI->spread_cap = max_per_tick;
+	TI->spread_shift = max_shift > 0 ? max_shift : 0;
 	spinlock_unlock(&TI->lock);
-	return node;
+	free(old);
+	return 0;
+}
+
+uint64_t
+timer_spread_shifted(void) {
+	spinlock_lock(&TI->lock);
+	uint64_t n = TI->spread_shifted;
+	spinlock_unlock(&TI->lock);
+	return n;
 }
 
 void
 move_list(s_timer_t *T, int level, int idx) {
 	timer_node_t *current = link_clear(&T->t[level][idx]);
+	uint32_t count = 0;
 	while (current) {
 		timer_node_t *temp=current->next;
 		add_node(T,current);
 		current=temp;
+		count++;
 	}
+	TIMER_PROBE_CASCADE(level, idx, count);
 }
 
 void
@@ -116,14 +288,40 @@ timer_shift(s_timer_t *T) {
 }
 
 void
-dispatch_list(timer_node_t *current) {
+dispatch_list(s_timer_t *T, timer_node_t *current) {
+	timer_node_t *list = current;
+	// 驱动线程落后墙上时钟的刻度数，expire_timer 一次追赶多个刻度时大于 0
+	uint32_t wall = (uint32_t)(T->current_point - T->start_point);
 	do {
 		timer_node_t * temp = current;
 		current=current->next;
-        if (temp->cancel == 0)
-            temp->callback(temp);
-		free(temp);
+		if (temp->cancel == 0) {
+			TIMER_PROBE_FIRE(temp->handle, temp->expire, (int32_t)(wall - temp->expire));
+			if (temp->callback)
+				temp->callback(temp);
+		}
 	} while (current);
+	// 回调全部执行完再归还节点，有节点池时一次加锁归还整条链表
+	if (T->pool) {
+		spinlock_lock(&T->lock);
+	}
+	while (list) {
+		timer_node_t *temp = list;
+		list = list->next;
+		node_free(T, temp);
+	}
+	if (T->pool) {
+		spinlock_unlock(&T->lock);
+	}
+}
+
+// 链表摘下后、解锁前让节点的句柄失效，之后 del_timer 不会再碰到将被 free 的节点
+void
+release_list(s_timer_t *T, timer_node_t *current) {
+	for (; current; current = current->next) {
+		handle_release(&T->handles, current->handle);
+		timer_group_detach(&current->group);
+	}
 }
 
 void
@@ -132,8 +330,9 @@ timer_execute(s_timer_t *T) {
 	
 	while (T->near[idx].head.next) {
 		timer_node_t *current = link_clear(&T->near[idx]);
+		release_list(T, current);
 		spinlock_unlock(&T->lock);
-		dispatch_list(current);
+		dispatch_list(T, current);
 		spinlock_lock(&T->lock);
 	}
 }
@@ -147,9 +346,188 @@ timer_update(s_timer_t *T) {
 	spinlock_unlock(&T->lock);
 }
 
+// 把当前刻度的槽位整条接到 pending 尾部，调用者持有锁
+static void
+collect_near(s_timer_t *T) {
+	link_list_t *list = &T->near[T->time & TIME_NEAR_MASK];
+	if (list->head.next) {
+		T->pending.tail->next = list->head.next;
+		T->pending.tail = list->tail;
+		link_clear(list);
+	}
+}
+
+int
+expire_into(timer_expired_t *out, int max) {
+	int n = 0;
+	uint32_t i;
+	spinlock_lock(&TI->lock);
+	uint64_t cp = gettime();
+	if (cp != TI->current_point) {
+		uint32_t diff = (uint32_t)(cp - TI->current_point);
+		TI->current_point = cp;
+		// 和 timer_update 的顺序一致：当前刻度、推进、新刻度
+		for (i = 0; i < diff; i++) {
+			collect_near(TI);
+			timer_shift(TI);
+			collect_near(TI);
+		}
+	}
+	while (n < max && TI->pending.head.next) {
+		timer_node_t *node = TI->pending.head.next;
+		TI->pending.head.next = node->next;
+		if (!node->next) {
+			TI->pending.tail = &TI->pending.head;
+		}
+		// 在 pending 里被取消的节点直接丢掉
+		if (!node->cancel) {
+			handle_release(&TI->handles, node->handle);
+			timer_group_detach(&node->group);
+			TIMER_PROBE_FIRE(node->handle, node->expire,
+				(int32_t)((uint32_t)(cp - TI->start_point) - node->expire));
+			out[n].handle = node->handle;
+			out[n].expire = node->expire;
+			n++;
+		}
+		node_free(TI, node);
+	}
+	spinlock_unlock(&TI->lock);
+	return n;
+}
+
+// 在 [from, from + TIME_LEVEL) 中找第一个非空槽，返回距离，没有返回 -1
+static int
+level_next(link_list_t *slots, uint32_t from) {
+	int i;
+	for (i = 0; i < TIME_LEVEL; i++) {
+		if (slots[(from + i) & TIME_LEVEL_MASK].head.next) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// 距离最近一个到期刻度还有多少个刻度，调用者持有锁
+static int64_t
+next_expire_ticks(s_timer_t *T) {
+	int64_t best = -1;
+	uint32_t i;
+	int level, d;
+	for (i = 0; i < TIME_NEAR; i++) {
+		if (T->near[(T->time + i) & TIME_NEAR_MASK].head.next) {
+			best = i;
+			break;
+		}
+	}
+	for (level = 0; level < 4; level++) {
+		int shift = TIME_NEAR_SHIFT + level * TIME_LEVEL_SHIFT;
+		uint32_t current = T->time >> shift;
+		d = level_next(T->t[level], current + 1);
+		if (d < 0) {
+			continue;
+		}
+		// 该槽在刻度 (current + 1 + d) << shift 时 cascade 到下层
+		int64_t ticks = ((int64_t)(current + 1 + d) << shift) - T->time;
+		// 高层的槽位也可能比低层第一个非空槽更早 cascade（低层那个槽在当前这一圈的后半段），每层都要看
+		if (best < 0 || ticks < best) {
+			best = ticks;
+		}
+	}
+	return best;
+}
+
+static int
+next_expire_ms(s_timer_t *T) {
+	if (T->pending.head.next) {
+		return 0;  // expire_into 还有没取完的
+	}
+	int64_t ticks = next_expire_ticks(T);
+	if (ticks < 0) {
+		return -1;
+	}
+	// 减去还没来得及推进的时间
+	ticks -= (int64_t)(gettime() - T->current_point);
+	if (ticks < 0) {
+		return 0;
+	}
+	return ticks > 0x7fffffff ? 0x7fffffff : (int)ticks;
+}
+
+int
+timer_next_expire(void) {
+	spinlock_lock(&TI->lock);
+	int ms = next_expire_ms(TI);
+	spinlock_unlock(&TI->lock);
+	return ms;
+}
+
+void
+timer_wait(int max_ms) {
+	spinlock_lock(&TI->lock);
+	int ms = next_expire_ms(TI);
+	if (max_ms >= 0 && (ms < 0 || ms > max_ms)) {
+		ms = max_ms;
+	}
+	if (ms == 0) {
+		spinlock_unlock(&TI->lock);
+		return;
+	}
+	TI->sleeping = 1;
+	uint64_t now = gettime();
+	TI->wake_tick = ms < 0 ? TI->time + 0x7fffffff
+		: TI->time + (uint32_t)(now - TI->current_point) + (uint32_t)ms;
+	spinlock_unlock(&TI->lock);
+
+#if defined(__linux__)
+	struct epoll_event ev;
+	int woken = 0;
+	// 低延迟模式：epoll_wait 只睡到截止前 1ms，剩下的用 clock_nanosleep + 忙等对准毫秒边界
+	int sleep_ms = TI->rt && ms > 0 ? ms - 1 : ms;
+	if (epoll_wait(TI->epfd, &ev, 1, sleep_ms) > 0) {
+		uint64_t cnt;
+		ssize_t n = read(TI->wakefd, &cnt, sizeof(cnt));
+		(void)n;
+		woken = 1;
+	}
+	if (TI->rt && ms > 0 && !woken) {
+		timer_rt_wait_until((now + ms) * 1000000ull, TIMER_RT_SPIN_NS);
+	}
+#else
+	usleep(ms < 0 || ms > 1 ? 1000 : 250);
+#endif
+
+	spinlock_lock(&TI->lock);
+	TI->sleeping = 0;
+	spinlock_unlock(&TI->lock);
+}
+
 void
-del_timer(timer_node_t *node) {
-    node->cancel = 1;
+del_timer(timer_handle_t handle) {
+	spinlock_lock(&TI->lock);
+	timer_node_t *node = handle_release(&TI->handles, handle);
+	if (node) {
+		TIMER_PROBE_DEL(handle, node->expire);
+		node->cancel = 1;
+		timer_group_detach(&node->group);
+	}
+	spinlock_unlock(&TI->lock);
+}
+
+unsigned
+cancel_group(timer_group_t *g) {
+	timer_group_link_t *l;
+	unsigned n = 0;
+	spinlock_lock(&TI->lock);
+	while ((l = timer_group_pop(g)) != NULL) {
+		timer_node_t *node = timer_group_entry(l, timer_node_t, group);
+		// 节点留在槽位里，到刻度时随链表一起释放
+		handle_release(&TI->handles, node->handle);
+		TIMER_PROBE_DEL(node->handle, node->expire);
+		node->cancel = 1;
+		n++;
+	}
+	spinlock_unlock(&TI->lock);
+	return n;
 }
 
 s_timer_t *
@@ -165,15 +543,23 @@ timer_create_timer() {
 			link_clear(&r->t[i][j]);
 		}
 	}
+	link_clear(&r->pending);
 	spinlock_init(&r->lock);
+	handle_table_init(&r->handles);
 	r->current = 0;
 	return r;
 }
 
+#ifdef TIMER_SIM_CLOCK
+uint64_t timer_sim_now;
+#endif
+
 uint64_t
 gettime() {
 	uint64_t t;
-#if !defined(__APPLE__) || defined(AVAILABLE_MAC_OS_X_VERSION_10_12_AND_LATER)
+#if defined(TIMER_SIM_CLOCK)
+	t = timer_sim_now;
+#elif !defined(__APPLE__) || defined(AVAILABLE_MAC_OS_X_VERSION_10_12_AND_LATER)
 	struct timespec ti;
 	clock_gettime(CLOCK_MONOTONIC, &ti);
 	t = (uint64_t)ti.tv_sec * 1000;
@@ -204,19 +590,27 @@ expire_timer(void) {
 void 
 init_timer(void) {
 	TI = timer_create_timer();
-	TI->current_point = gettime();
+	TI->current_point = TI->start_point = gettime();
+	TI->wakefd = TI->epfd = -1;
+#if defined(__linux__)
+	TI->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	TI->epfd = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event ev = { .events = EPOLLIN };
+	epoll_ctl(TI->epfd, EPOLL_CTL_ADD, TI->wakefd, &ev);
+#endif
 }
 
 void
 clear_timer() {
 	int i,j;
+	spinlock_lock(&TI->lock);
 	for (i=0;i<TIME_NEAR;i++) {
 		link_list_t * list = &TI->near[i];
 		timer_node_t* current = list->head.next;
 		while(current) {
 			timer_node_t * temp = current;
 			current = current->next;
-			free(temp);
+			node_free(TI, temp);
 		}
 		link_clear(&TI->near[i]);
 	}
@@ -227,9 +621,75 @@ clear_timer() {
 			while (current) {
 				timer_node_t * temp = current;
 				current = current->next;
-				free(temp);
+				node_free(TI, temp);
 			}
 			link_clear(&TI->t[i][j]);
 		}
 	}
+	timer_node_t *current = link_clear(&TI->pending);
+	while (current) {
+		timer_node_t *temp = current;
+		current = current->next;
+		node_free(TI, temp);
+	}
+	handle_table_free(&TI->handles);
+	free(TI->spread);
+	TI->spread = NULL;
+	TI->spread_cap = 0;
+	free(TI->pool);
+	TI->pool = TI->pool_end = TI->free_nodes = NULL;
+	spinlock_unlock(&TI->lock);
+	if (TI->epfd >= 0) {
+		close(TI->epfd);
+		close(TI->wakefd);
+		TI->epfd = TI->wakefd = -1;
+	}
+}
+
+#if defined(__linux__)
+int
+timer_enable_rt(int pool_size, int cpu, int fifo_prio) {
+	int ret = 0;
+	int i;
+	timer_node_t *pool = NULL;
+	if (pool_size > 0) {
+		pool = (timer_node_t *)malloc(sizeof(timer_node_t) * pool_size);
+		if (!pool) {
+			return -1;
+		}
+		memset(pool, 0, sizeof(timer_node_t) * pool_size); // 预先触碰每一页
+	}
+	if (timer_rt_lock_memory() < 0) {
+		ret |= TIMER_RT_NO_MLOCK;
+	}
+	if (cpu >= 0 && timer_rt_pin(cpu) < 0) {
+		ret |= TIMER_RT_NO_PIN;
+	}
+	if (fifo_prio > 0 && timer_rt_fifo(fifo_prio) < 0) {
+		ret |= TIMER_RT_NO_FIFO;
+	}
+	spinlock_lock(&TI->lock);
+	if (pool && !TI->pool) {
+		TI->pool = pool;
+		TI->pool_end = pool + pool_size;
+		for (i = pool_size - 1; i >= 0; i--) {
+			pool[i].next = TI->free_nodes;
+			TI->free_nodes = &pool[i];
+		}
+		pool = NULL;
+	}
+	TI->rt = 1;
+	spinlock_unlock(&TI->lock);
+	free(pool);
+	return ret;
+}
+#else
+// 其他平台不支持低延迟模式，timer_wait 照常按毫秒睡
+int
+timer_enable_rt(int pool_size, int cpu, int fifo_prio) {
+	(void)pool_size;
+	(void)cpu;
+	(void)fifo_prio;
+	return -1;
 }
+#endif
@@ -2,6 +2,9 @@
 #define _MARK_TIMEWHEEL_
 
 #include <stdint.h>
+#include "timer_handle.h"
+#include "timer_group.h"
+#include "timer_expired.h"
 
 #define TIME_NEAR_SHIFT 8
 #define TIME_NEAR (1 << TIME_NEAR_SHIFT)
@@ -19,13 +22,60 @@ struct timer_node {
     handler_pt callback;
     uint8_t cancel;
 	int id; // 此时携带参数
+	timer_handle_t handle;
+	timer_group_link_t group; // 所属的定时器组，受锁保护
 };
 
-timer_node_t* add_timer(int time, handler_pt func, int threadid);
+// 返回定时器句柄；time <= 0 时立即回调，返回 TIMER_HANDLE_INVALID；内存不足时不添加，也返回 TIMER_HANDLE_INVALID；
+// func 为 NULL 表示只用 expire_into 批量取，time <= 0 时在下一个刻度取出
+timer_handle_t add_timer(int time, handler_pt func, int threadid);
+
+// 同 add_timer，并把定时器挂到组 g 里（g 为 NULL 不入组）；time <= 0 立即回调，不入组
+timer_handle_t add_group_timer(int time, handler_pt func, int threadid, timer_group_t *g);
+
+// 到期时间在 [time, time + jitter] 内随机，错开同时建立的连接、周期性重新添加的定时器，只会推迟不会提前
+timer_handle_t add_jitter_timer(int time, int jitter, handler_pt func, int threadid);
+
+// 削峰：之后添加的定时器，每个刻度最多落 max_per_tick 个，超出的往后挪，最多挪 max_shift 个刻度
+// （窗口内都满了就放在最空的刻度）；max_per_tick 为 0 关闭。内存不足返回 -1
+int timer_set_spread(int max_per_tick, int max_shift);
+
+// 因削峰被挪动过的定时器个数
+uint64_t timer_spread_shifted(void);
 
 void expire_timer(void);
 
-void del_timer(timer_node_t* node);
+#ifdef TIMER_SIM_CLOCK
+// 模拟时钟（ms）：编译时定义 TIMER_SIM_CLOCK，时间轮不再读单调时钟，
+// 由调用者改写它后调用 expire_timer，回放录制文件时全速推进时间
+extern uint64_t timer_sim_now;
+#endif
+
+// 不执行回调：推进时间，按到期顺序取出最多 max 个到期定时器写入 out，返回个数，
+// 没取完的留到下一次。整个过程持有锁，可以在任意一个线程里作为唯一的消费者调用；
+// 同一个时间轮只用 expire_timer 和 expire_into 中的一种驱动
+int expire_into(timer_expired_t *out, int max);
+
+// 根据槽位内容计算距离最近一个定时器到期的毫秒数，没有定时器返回 -1；
+// 高层槽位中的定时器按该槽 cascade 的时刻估计（不晚于真实到期时间）
+int timer_next_expire(void);
+
+// 睡眠直到最近的定时器到期，max_ms 为睡眠上限（-1 不限）；
+// 其他线程添加了更早到期的定时器时通过 eventfd 提前唤醒
+void timer_wait(int max_ms);
+
+// 可在任意线程调用；句柄已失效（已触发、已取消）时为空操作
+void del_timer(timer_handle_t handle);
+
+// 取消组里的所有定时器，只加一次锁，沿组链表逐个让句柄失效并打上取消标记；
+// 可在任意线程调用，组对象要活到组里的定时器全部触发或取消。返回取消的个数
+unsigned cancel_group(timer_group_t *g);
+
+// 低延迟模式，在驱动线程（调用 expire_timer / timer_wait 的线程）上调用：
+// 预分配 pool_size 个节点并预先触碰，mlockall，绑到 cpu（-1 不绑），fifo_prio > 0 时切到 SCHED_FIFO；
+// timer_wait 改为 epoll_wait 睡到截止前 1ms，再 clock_nanosleep + 忙等对准毫秒边界。
+// 返回 0 全部成功，-1 节点池分配失败或不是 Linux（不支持），否则为 TIMER_RT_NO_* 的组合（没有权限的项被跳过）
+int timer_enable_rt(int pool_size, int cpu, int fifo_prio);
 
 void init_timer(void);
 
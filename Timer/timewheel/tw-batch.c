@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "timewheel.h"
+
+/*
+ * 批量取到期定时器：主线程给每个连接加一个保活定时器（NULL 回调），
+ * 单独的发送线程睡到最近的定时器到期，用 expire_into 一次取出一批，
+ * 按句柄找到连接，整批一起"发送"（真实场景里就是一次 sendmmsg），再重新加上保活定时器。
+ */
+
+#define CONNS    1000
+#define BATCH    64
+#define INTERVAL 200
+
+static timer_handle_t keepalive[CONNS];  // 连接 -> 保活定时器句柄
+static volatile int quit;
+
+// 演示用的线性查找，真实场景里句柄可以存在连接对象里，或者按句柄槽位下标建表
+static int
+conn_of(timer_handle_t h) {
+    int i;
+    for (i = 0; i < CONNS; i++) {
+        if (keepalive[i] == h) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void *
+sender(void *p) {
+    timer_expired_t out[BATCH];
+    int conns[BATCH];
+    long batches = 0, sent = 0;
+    while (!quit) {
+        int n = expire_into(out, BATCH);
+        if (n == 0) {
+            timer_wait(100);
+            continue;
+        }
+        int i, m = 0;
+        for (i = 0; i < n; i++) {
+            int c = conn_of(out[i].handle);
+            if (c >= 0) {
+                conns[m++] = c;
+            }
+        }
+        // 这里用一次 sendmmsg 把 m 个保活包发出去
+        for (i = 0; i < m; i++) {
+            keepalive[conns[i]] = add_timer(INTERVAL, NULL, conns[i]);
+        }
+        batches++;
+        sent += m;
+    }
+    printf("sender: %ld pings in %ld batches, %.1f per batch\n", sent, batches,
+        batches ? (double)sent / batches : 0.0);
+    return NULL;
+}
+
+int main() {
+    pthread_t tid;
+    int i;
+    init_timer();
+    for (i = 0; i < CONNS; i++) {
+        keepalive[i] = add_timer(1 + rand() % INTERVAL, NULL, i);
+    }
+    pthread_create(&tid, NULL, sender, NULL);
+    sleep(2);
+    quit = 1;
+    pthread_join(tid, NULL);
+    clear_timer();
+    return 0;
+}
+
+// gcc tw-batch.c timewheel.c -o tw-batch -I./ -I../common -lpthread
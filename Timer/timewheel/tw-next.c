@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timewheel.h"
+
+/*
+ * timer_next_expire 的检查，模拟时钟下跑（编译时定义 TIMER_SIM_CLOCK）：
+ *   1. 16384ms 的定时器在第 1 层，推进到 16383 再加一个 300ms 的（落在第 0 层），
+ *      最近的应该是 1ms 后，曾经只看第一个非空的层，返回 257，timer_wait 多睡 256ms；
+ *   2. 随机添加 / 推进，每一步估计值都不能晚于真实的最近到期时间，并且每个定时器都按时触发
+ *      （add_node 曾经按差值选层，跨过上一层边界的定时器落进 0 号槽，永远不会 cascade）。
+ */
+
+#define N 20000
+
+static uint64_t expire_at[N];
+static int fired[N], late;
+
+static void
+on_fire(timer_node_t *node) {
+    if (timer_sim_now != expire_at[node->id]) {
+        late++;
+    }
+    fired[node->id] = 1;
+}
+
+static void
+advance_to(uint64_t t) {
+    while (timer_sim_now < t) {
+        timer_sim_now++;
+        expire_timer();
+    }
+}
+
+int main() {
+    int ok = 1, i, n = 0, bad = 0, missed = 0;
+    uint64_t last = 0;
+
+    timer_sim_now = 0;
+    init_timer();
+    expire_at[n] = 16384;
+    add_timer(16384, on_fire, n++);
+    advance_to(16383);
+    expire_at[n] = 16383 + 300;
+    add_timer(300, on_fire, n++);
+    int ms = timer_next_expire();
+    printf("level 1 slot before level 0 slot: next expire %d ms (want 1)\n", ms);
+    ok = ok && ms == 1;
+    advance_to(16383 + 300);
+    clear_timer();
+
+    srand(1);
+    timer_sim_now = 0;
+    init_timer();
+    memset(fired, 0, sizeof(fired));
+    late = 0;
+    n = 0;
+    for (;;) {
+        int k = rand() % 4;
+        for (i = 0; i < k && n < N; i++, n++) {
+            // 跨越各层：1ms ~ 4M ms
+            int t = 1 + rand() % (1 << (1 + rand() % 22));
+            expire_at[n] = timer_sim_now + t;
+            last = expire_at[n] > last ? expire_at[n] : last;
+            add_timer(t, on_fire, n);
+        }
+        uint64_t best = UINT64_MAX;
+        for (i = 0; i < n; i++) {
+            if (!fired[i] && expire_at[i] < best) {
+                best = expire_at[i];
+            }
+        }
+        // 全部触发，或者已经过了最晚的到期时间还有没触发的
+        if ((n == N && best == UINT64_MAX) || timer_sim_now > last) {
+            break;
+        }
+        ms = timer_next_expire();
+        if (best != UINT64_MAX && (ms < 0 || timer_sim_now + ms > best)) {
+            bad++;
+        }
+        // 按估计值推进，模拟 timer_wait 睡到那个时刻
+        advance_to(timer_sim_now + (ms > 0 ? ms : 1));
+    }
+    for (i = 0; i < N; i++) {
+        missed += !fired[i];
+    }
+    printf("random: %d timers, %d estimates later than the real expiry, %d late fires, %d never fired\n",
+        N, bad, late, missed);
+    ok = ok && !bad && !late && !missed;
+    clear_timer();
+    printf(ok ? "check ok\n" : "check FAILED\n");
+    return !ok;
+}
+
+// gcc -O2 -DTIMER_SIM_CLOCK tw-next.c timewheel.c -o tw-next -I./ -I../common -lpthread
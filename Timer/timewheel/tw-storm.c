@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "timewheel.h"
+
+/*
+ * 定时器风暴回放：发布后所有客户端在 STORM_MS 内重连，每个连接一个 IDLE_MS 的空闲定时器，
+ * 到期后原样重新添加（周期性定时器），一共 ROUNDS 轮。按刻度统计每个刻度触发的个数，
+ * 对比三种方式每一轮的峰值：
+ *   - plain ：add_timer，风暴的形状一轮一轮原样保留；
+ *   - jitter：add_jitter_timer，每轮再叠加 [0, JITTER] 的随机推迟，峰值逐轮摊平；
+ *   - spread：timer_set_spread，每个刻度最多 CAP 个，超出的往后挪，第一轮就削平。
+ */
+
+#define CONNS     200000
+#define STORM_MS  20
+#define IDLE_MS   1000
+#define ROUNDS    3
+#define JITTER    200
+#define CAP       500
+#define MAX_SHIFT 1000
+#define HORIZON   (STORM_MS + ROUNDS * (IDLE_MS + JITTER + MAX_SHIFT) + 100)
+
+static int mode;           // 0 plain 1 jitter 2 spread
+static uint32_t base;      // 第一批定时器添加时的刻度
+static int per_tick[ROUNDS][HORIZON];
+static int round_of[CONNS];
+static long fired;
+
+static void on_idle(timer_node_t *node);
+
+static void
+arm(int id, int msec) {
+    if (mode == 1) {
+        add_jitter_timer(msec, JITTER, on_idle, id);
+    } else {
+        add_timer(msec, on_idle, id);
+    }
+}
+
+static void
+on_idle(timer_node_t *node) {
+    uint32_t t = node->expire - base;
+    if (t < HORIZON) {
+        per_tick[round_of[node->id]][t]++;
+    }
+    fired++;
+    if (++round_of[node->id] < ROUNDS) {
+        arm(node->id, IDLE_MS);
+    }
+}
+
+static void
+run(const char *name) {
+    int i, r;
+    memset(per_tick, 0, sizeof(per_tick));
+    memset(round_of, 0, sizeof(round_of));
+    fired = 0;
+    init_timer();
+    if (mode == 2) {
+        timer_set_spread(CAP, MAX_SHIFT);
+    }
+    base = 0;  // init_timer 之后时间轮刻度从 0 开始
+    // 重连风暴：CONNS 个连接均匀落在 STORM_MS 内
+    for (i = 0; i < CONNS; i++) {
+        arm(i, IDLE_MS + (int)((long)i * STORM_MS / CONNS));
+    }
+    while (fired < (long)CONNS * ROUNDS) {
+        timer_wait(-1);
+        expire_timer();
+    }
+    printf("%-7s", name);
+    for (r = 0; r < ROUNDS; r++) {
+        int peak = 0, busy = 0;
+        for (i = 0; i < HORIZON; i++) {
+            if (per_tick[r][i] > peak) peak = per_tick[r][i];
+            if (per_tick[r][i]) busy++;
+        }
+        printf("  round %d peak %6d/tick over %4d ticks", r + 1, peak, busy);
+    }
+    if (mode == 2) {
+        printf("  shifted %llu", (unsigned long long)timer_spread_shifted());
+    }
+    printf("\n");
+    clear_timer();
+}
+
+int main() {
+    printf("%d connections reconnect within %dms, idle timeout %dms, %d rounds\n",
+        CONNS, STORM_MS, IDLE_MS, ROUNDS);
+    mode = 0;
+    run("plain");
+    mode = 1;
+    run("jitter");
+    mode = 2;
+    run("spread");
+    return 0;
+}
+
+// gcc -O2 tw-storm.c timewheel.c -o tw-storm -I./ -I../common -lpthread
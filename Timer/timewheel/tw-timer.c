@@ -4,6 +4,7 @@
 #include <pthread.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #include "timewheel.h"
 
 struct context {
@@ -20,7 +21,8 @@ static struct context ctx = {0};
 
 void do_timer(timer_node_t *node) {
     printf("do_timer expired:%d - thread-id:%d\n", node->expire, node->id);
-    add_timer(100, do_timer, node->id);
+    // 周期性重新添加时加一点抖动，多个线程的定时器不会一直锁在同一个相位上
+    add_jitter_timer(100, 10, do_timer, node->id);
 }
 
 void do_clock(timer_node_t *node) {
@@ -47,14 +49,26 @@ void do_quit(timer_node_t * node) {
     ctx.quit = 1;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     srand(time(NULL));
     ctx.thread = 2;
     pthread_t pid[ctx.thread];
 
     init_timer();
+    // ./tw --rt：驱动线程绑到 0 号核，能切 SCHED_FIFO 就切，节点预分配
+    if (argc > 1 && strcmp(argv[1], "--rt") == 0) {
+        int ret = timer_enable_rt(4096, 0, 50);
+        printf("rt mode enabled, unavailable flags = %d\n", ret);
+    }
     add_timer(6000, do_quit, 100);
     add_timer(0, do_clock, 100);
+    // 一个连接的几个定时器放在同一组，关闭连接时一次加锁全部取消
+    timer_group_t conn;
+    timer_group_init(&conn);
+    add_group_timer(1000, do_quit, 101, &conn);
+    add_group_timer(2000, do_quit, 101, &conn);
+    add_group_timer(3000, do_quit, 101, &conn);
+    printf("cancel_group: %u timers\n", cancel_group(&conn));
     struct thread_param task_thread_p[ctx.thread];
     int i;
     for (i = 0; i < ctx.thread; i++) {
@@ -68,7 +82,8 @@ int main() {
 
     while (!ctx.quit) {
         expire_timer();
-        usleep(250);
+        // 睡到最近的定时器到期，工作线程加入更早的定时器时会被 eventfd 唤醒
+        timer_wait(-1);
     }
     clear_timer();
     for (i = 0; i < ctx.thread; i++) {
@@ -78,4 +93,4 @@ int main() {
     return 0;
 }
 
-// gcc tw-timer.c timewheel.c -o tw -I./ -lpthread 
\ No newline at end of file
+// gcc tw-timer.c timewheel.c -o tw -I./ -I../common -lpthread 
\ No newline at end of file